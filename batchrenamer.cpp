@@ -1,25 +1,222 @@
 #include "batchrenamer.h"
 
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
 QString Extension::Pic = "jpeg|jpg|png|bmp|webp|raw|avif|gif";
 QString Extension::Vid = "mp4|flv|gif|f4v|mov|m4v|avi|mpg|mpeg|wmv";
 QString Extension::Doc = "txt|md|doc|pdf|ppt|docx|pptx|xls|xlsx|rtf|csv";
 
+namespace
+{
+    // 以下函数与QFileInfo对不含路径的文件名的处理一致，但不构造QFileInfo，只返回指向原名称的视图
+
+    // 最后一个点号之前的部分，同QFileInfo::completeBaseName()
+    QStringView completeBaseNameOf(QStringView fileName)
+    {
+        qsizetype dot = fileName.lastIndexOf('.');
+        return dot < 0 ? fileName : fileName.left(dot);
+    }
+
+    // 第一个点号之前的部分，同QFileInfo::baseName()
+    QStringView baseNameOf(QStringView fileName)
+    {
+        qsizetype dot = fileName.indexOf('.');
+        return dot < 0 ? fileName : fileName.left(dot);
+    }
+
+    // 最后一个点号之后的部分，同QFileInfo::suffix()
+    QStringView suffixOf(QStringView fileName)
+    {
+        qsizetype dot = fileName.lastIndexOf('.');
+        return dot < 0 ? QStringView() : fileName.mid(dot + 1);
+    }
+
+    // 并行分类时每块的文件数
+    const int classifyChunkSize = 4096;
+} // namespace
+
 BatchRenamer::BatchRenamer() {}
 
-QString BatchRenamer::renameFiles(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter)
+void BatchRenamer::setProgressCallback(std::function<void(const Progress&)> callback)
+{
+    progressCallback = std::move(callback);
+}
+
+void BatchRenamer::setContentSniffing(bool enabled)
+{
+    contentSniffing = enabled;
+}
+
+void BatchRenamer::setNumberingIndex(bool enabled)
+{
+    numberingIndex = enabled;
+}
+
+void BatchRenamer::setNumberingOrder(FileOrder::Key key)
+{
+    numberingOrder = key;
+}
+
+void BatchRenamer::setRenameBackend(DirectoryRenamer::Backend backend)
+{
+    renameBackend = backend;
+}
+
+void BatchRenamer::setQueueDepth(int depth)
+{
+    queueDepth = qMax(1, depth);
+}
+
+void BatchRenamer::setMatchThreads(int threads)
+{
+    matchThreads = qMax(0, threads);
+}
+
+void BatchRenamer::setDuplicateMode(DuplicateMode mode)
+{
+    duplicateMode = mode;
+}
+
+RunStats& BatchRenamer::stats()
+{
+    return runStats;
+}
+
+void BatchRenamer::setStorage(StorageBackend* backend)
+{
+    storage = backend;
+}
+
+StorageBackend* BatchRenamer::storageBackend() const
 {
-    QDir dir(directory);
-    if(!dir.exists())
+    return storage;
+}
+
+void BatchRenamer::copySettings(const BatchRenamer& other)
+{
+    storage = other.storage;
+    contentSniffing = other.contentSniffing;
+    numberingIndex = other.numberingIndex;
+    numberingOrder = other.numberingOrder;
+    renameBackend = other.renameBackend;
+    queueDepth = other.queueDepth;
+    matchThreads = other.matchThreads;
+    duplicateMode = other.duplicateMode;
+}
+
+void BatchRenamer::cancel()
+{
+    cancelRequested.storeRelaxed(1);
+}
+
+void BatchRenamer::resetCancel()
+{
+    cancelRequested.storeRelaxed(0);
+}
+
+void BatchRenamer::reportProgress()
+{
+    if(progressCallback)
+    {
+        progressCallback(progress);
+    }
+}
+
+QString BatchRenamer::renameFiles(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter,
+                                  RenamePlan* executed)
+{
+    RenamePlan renamePlan = plan(format, replacements, directory, extensionFilter);
+    QString feedback = renamePlan.error.isEmpty() ? executePlan(renamePlan) : renamePlan.error;
+    if(executed)
+    {
+        *executed = renamePlan;
+    }
+    return feedback;
+}
+
+QString BatchRenamer::renameTree(const QString& rulesPath, const QString& root)
+{
+    RuleSet rules;
+    QString error;
+    if(!rules.load(rulesPath, &error))
+    {
+        qWarning() << error;
+        return error;
+    }
+    QVector<RenamePlan> plans = planTree(rules, root);
+    if(plans.size() == 1 && !plans.front().error.isEmpty())
+    {
+        return plans.front().error;
+    }
+    // 各目录分别记日志，可在对应目录中单独撤销、续做
+    int folderCount = 0;
+    int failedFolders = 0;
+    QString firstError;
+    for(RenamePlan& renamePlan : plans)
+    {
+        if(cancelRequested.loadRelaxed())
+        {
+            break;
+        }
+        QString feedback = executePlan(renamePlan);
+        folderCount++;
+        // 与递归模式相同：有条目失败的目录计入汇总，并给出第一个目录的结果
+        int failed = renamePlan.count(RenamePlan::Status::Failed);
+        if(failed > 0)
+        {
+            failedFolders++;
+            if(firstError.isEmpty())
+            {
+                firstError = renamePlan.directory + ": " + feedback + " " + QString::number(failed) + " failed.";
+            }
+        }
+    }
+    if(cancelRequested.loadRelaxed())
+    {
+        qWarning() << "Rename cancelled.";
+        return "Cancelled after renaming " + QString::number(progress.renamed) + " file(s).";
+    }
+    QString result = "Successfully renamed " + QString::number(progress.renamed) + " file(s) in "
+                     + QString::number(folderCount) + " folder(s)";
+    if(failedFolders > 0)
+    {
+        result += ", " + QString::number(failedFolders) + " folder(s) with errors (first: " + firstError + ")";
+    }
+    return result + ".";
+}
+
+RenamePlan BatchRenamer::plan(const QString& format, const QVector<QString> &replacements, const QString& directory,
+                              const QString& extensionFilter, bool caseInsensitive, QStringList* subdirectories)
+{
+    return buildPlan(format, replacements, directory, extensionFilter, caseInsensitive, nullptr, subdirectories);
+}
+
+RenamePlan BatchRenamer::buildPlan(const QString& format, const QVector<QString> &replacements, const QString& directory,
+                                   const QString& extensionFilter, bool caseInsensitive, WatchState* watchState,
+                                   QStringList* subdirectories)
+{
+    progress = Progress();
+    RenamePlan result;
+    result.directory = directory;
+    result.caseInsensitive = caseInsensitive;
+    // 远程存储的目录是否存在由列目录的结果判断
+    if(!storage && !QDir(directory).exists())
     {
         qWarning() << "Directory does not exist: " << directory;
-        return "Directory does not exist: " + directory;
+        result.error = "Directory does not exist: " + directory;
+        return result;
     }
+    runStats.setContext(directory);
     // 解析格式字符串
+    qint64 parseStart = RunStats::now();
     ParsedFormat parsed = parseFormat(format);
     if(parsed.placeholders.isEmpty())
     {
         qWarning() << "Invalid format string: " << format;
-        return "Invalid format string: " + format;
+        result.error = "Invalid format string: " + format;
+        return result;
     }
     // 检查占位符数量是否匹配
     int regularPlaceholders = 0;
@@ -30,70 +227,836 @@ QString BatchRenamer::renameFiles(const QString& format, const QVector<QString>
     if(regularPlaceholders != replacements.size())
     {
         qWarning() << "Number of replacements does not match number of regular placeholders.";
-        return "Number of replacements does not match number of regular placeholders.";
+        result.error = "Number of replacements does not match number of regular placeholders.";
+        return result;
+    }
+    // 编译格式和扩展名过滤器
+    CompiledFormat compiled = compileFormat(parsed, replacements);
+    ExtensionClassifier classifier(extensionFilter);
+    runStats.addSpan(RunStats::Phase::Parse, parseStart, RunStats::now() - parseStart);
+    if(storage && compiled.usesMetadata)
+    {
+        result.error = "Metadata placeholders need local files and are not supported for remote libraries.";
+        return result;
+    }
+    // 编号索引：目录修改时间须在枚举之前读取，扫描期间的改动才会在下次被发现（远程存储不使用）
+    bool useIndex = numberingIndex && !storage;
+    NumberingIndex index(directory, NumberingIndex::makeKey(format, replacements, extensionFilter, contentSniffing));
+    bool indexed = useIndex && index.load();
+    qint64 stamp = useIndex ? NumberingIndex::directoryStamp(directory) : -1;
+    ScanResult scan;
+    // 目录未变化且上次没有待重命名的文件：计划必然为空，不必扫描（按文件头识别时内容可能已变，不跳过；
+    // 增量重命名需要完整的已占用名称，递归时需要子文件夹，也不跳过）
+    if(indexed && !contentSniffing && !watchState && !subdirectories && index.isUpToDate(stamp))
+    {
+        progress.scanned = index.scannedCount();
+        progress.matched = index.matchedCount();
+        scan.maxNumber = index.maxNumber();
+    }
+    else
+    {
+        // 流式扫描目录，随枚举随筛选、分类
+        scan = scanDirectory(directory, classifier, compiled, caseInsensitive, indexed ? &index : nullptr, subdirectories);
+        if(scan.cancelled)
+        {
+            qWarning() << "Rename cancelled.";
+            result.error = "Cancelled after renaming 0 file(s).";
+            return result;
+        }
+        if(!scan.error.isEmpty())
+        {
+            qWarning() << scan.error;
+            result.error = scan.error;
+            return result;
+        }
+        if(useIndex)
+        {
+            index.save(stamp, scan.conforming, progress.scanned, progress.matched, scan.candidates.size(), scan.maxNumber);
+        }
+    }
+    if(progress.matched == 0 && !watchState && !subdirectories)
+    {
+        qWarning() << "No files match the extension filter: " << extensionFilter;
+        result.error = "No files match the extension filter: " + extensionFilter;
+        return result;
+    }
+    // 最大编号（如果有数字占位符）已在扫描中得到
+    int maxNumber = -1;
+    if(parsed.hasNumberPlaceholder)
+    {
+        maxNumber = scan.maxNumber;
+    }
+    TupleNumbering tuples;
+    if(compiled.usesMetadata)
+    {
+        for(auto it = scan.conforming.cbegin(); it != scan.conforming.cend(); ++it)
+        {
+            noteConforming(it.key(), compiled, &tuples);
+        }
+    }
+    QHash<QString, QString> duplicates;
+    QVector<RenamePlan::Entry> moves = generateMoves(directory, compiled, &scan.candidates, &maxNumber, &tuples, &duplicates);
+    // 安排执行顺序：目标是本批次其他文件原名称的条目排在其后，环经临时名称完成，其余被占用的目标判为冲突
+    result.entries = scheduleMoves(moves, &scan.occupied);
+    progress.failed += result.count(RenamePlan::Status::Conflict);
+    markDuplicates(&result.entries, scan.candidates, duplicates);
+    // 保留编译后的格式和计划执行后的目录状态，之后的批次不再扫描
+    if(watchState)
+    {
+        watchState->directory = directory;
+        watchState->compiled = compiled;
+        watchState->classifier = classifier;
+        watchState->occupied = scan.occupied;
+        watchState->caseInsensitive = caseInsensitive;
+        watchState->maxNumber = maxNumber;
+        watchState->tuples = tuples;
+    }
+    reportProgress();
+    return result;
+}
+
+QVector<RenamePlan> BatchRenamer::planTree(const RuleSet& rules, const QString& root, bool caseInsensitive)
+{
+    progress = Progress();
+    auto failure = [](const QString& error)
+    {
+        RenamePlan plan;
+        plan.error = error;
+        return QVector<RenamePlan>{plan};
+    };
+    if(storage)
+    {
+        return failure("Rule sets are not supported for remote libraries.");
+    }
+    QDir rootDir(root);
+    if(!rootDir.exists())
+    {
+        qWarning() << "Directory does not exist: " << root;
+        return failure("Directory does not exist: " + root);
+    }
+    runStats.setContext(root);
+    // 规则只编译一次，之后逐文件复用
+    qint64 parseStart = RunStats::now();
+    const QVector<RenameRule>& ruleList = rules.rules();
+    QVector<CompiledFormat> compiled;
+    QVector<ExtensionClassifier> classifiers;
+    for(const RenameRule& rule : ruleList)
+    {
+        ParsedFormat parsed = parseFormat(rule.format);
+        if(parsed.placeholders.isEmpty())
+        {
+            return failure("Invalid format string in " + rule.name + ": " + rule.format);
+        }
+        int regularPlaceholders = 0;
+        for(const auto& ph : parsed.placeholders)
+        {
+            if(ph.type == PlaceholderType::Regular || ph.type == PlaceholderType::RegularExpression) { regularPlaceholders++; }
+        }
+        if(regularPlaceholders != rule.replacements.size())
+        {
+            return failure("Number of replacements does not match number of regular placeholders in " + rule.name + ".");
+        }
+        compiled.append(compileFormat(parsed, rule.replacements));
+        classifiers.append(ExtensionClassifier(rule.extensionFilter));
+    }
+    runStats.addSpan(RunStats::Phase::Parse, parseStart, RunStats::now() - parseStart);
+    /**
+     * @brief 一个目录中交给某条规则的文件
+     */
+    struct RuleBucket
+    {
+        QStringList candidates;         // 需要重命名的文件
+        int maxNumber = -1;             // 已符合格式的文件中的最大编号
+        TupleNumbering tuples;          // 各组的最大编号（含元数据占位符时使用）
+    };
+    /**
+     * @brief 枚举过程中的目录状态
+     */
+    struct TreeDirectory
+    {
+        NameIndex occupied;
+        QVector<int> rules;             // 适用的规则
+        QVector<RuleBucket> buckets;    // 与rules一一对应
+    };
+    QMap<QString, TreeDirectory> directories;   // 按相对路径排序
+    const QString rootPath = rootDir.absolutePath();
+    // 逐个目录枚举整个目录树：所有名称记入所在目录的已占用集合，文件随枚举交给规则分类。
+    // 与递归模式相同，不进入隐藏目录和指向目录的符号链接，其中的文件不参与重命名，也不必读取
+    QStringList pending{QString()};
+    qint64 scanStart = RunStats::now();
+    while(!pending.isEmpty())
+    {
+        QString relative = pending.takeLast();
+        TreeDirectory* current = &directories[relative];
+        current->occupied = NameIndex(caseInsensitive);
+        current->rules = rules.rulesFor(relative);
+        current->buckets.resize(current->rules.size());
+        QDirIterator it(relative.isEmpty() ? rootPath : rootPath + "/" + relative,
+                        QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        while(it.hasNext())
+        {
+            if(cancelRequested.loadRelaxed())
+            {
+                qWarning() << "Rename cancelled.";
+                return failure("Cancelled after renaming 0 file(s).");
+            }
+            it.next();
+            QFileInfo info = it.fileInfo();
+            QString fileName = it.fileName();
+            runStats.add(RunStats::Counter::Enumerated);
+            runStats.add(RunStats::Counter::NameBytes, fileName.size() * qint64(sizeof(QChar)));
+            current->occupied.insert(fileName);
+            if(info.isDir() && !info.isSymLink() && !info.isHidden())
+            {
+                pending.append(relative.isEmpty() ? fileName : relative + "/" + fileName);
+                continue;
+            }
+            if(!info.isFile() || info.isHidden() || RenameScheduler::isTemporaryName(fileName))
+            {
+                continue;
+            }
+            progress.scanned++;
+            for(int k = 0; k < current->rules.size(); k++)
+            {
+                int rule = current->rules[k];
+                if(!matchesExtension(fileName, classifiers[rule]))
+                {
+                    continue;
+                }
+                progress.matched++;
+                runStats.add(RunStats::Counter::Filtered);
+                RuleBucket& bucket = current->buckets[k];
+                FileMatch match = classifyFile(fileName, compiled[rule]);
+                if(!match.conforming)
+                {
+                    runStats.add(RunStats::Counter::Candidates);
+                    bucket.candidates.append(fileName);
+                }
+                else
+                {
+                    runStats.add(RunStats::Counter::Conforming);
+                    bucket.maxNumber = qMax(bucket.maxNumber, match.number);
+                    if(compiled[rule].usesMetadata)
+                    {
+                        noteConforming(fileName, compiled[rule], &bucket.tuples);
+                    }
+                }
+                break;
+            }
+            reportProgress();
+        }
+    }
+    runStats.addSpan(RunStats::Phase::Enumerate, scanStart, RunStats::now() - scanStart);
+    // 逐个目录生成计划：各规则分别编号，同一目录的条目一起安排执行顺序、检测冲突
+    QVector<RenamePlan> result;
+    for(auto dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        TreeDirectory& state = dir.value();
+        RenamePlan plan;
+        plan.directory = dir.key().isEmpty() ? rootPath : rootPath + "/" + dir.key();
+        plan.caseInsensitive = caseInsensitive;
+        QVector<RenamePlan::Entry> moves;
+        QStringList candidates;
+        QHash<QString, QString> duplicates;
+        for(int k = 0; k < state.rules.size(); k++)
+        {
+            RuleBucket& bucket = state.buckets[k];
+            if(bucket.candidates.isEmpty())
+            {
+                continue;
+            }
+            const CompiledFormat& format = compiled[state.rules[k]];
+            int maxNumber = format.parsed.hasNumberPlaceholder ? bucket.maxNumber : -1;
+            QHash<QString, QString> bucketDuplicates;
+            moves += generateMoves(plan.directory, format, &bucket.candidates, &maxNumber, &bucket.tuples, &bucketDuplicates);
+            candidates += bucket.candidates;
+            duplicates.insert(bucketDuplicates);
+        }
+        if(candidates.isEmpty())
+        {
+            continue;
+        }
+        plan.entries = scheduleMoves(moves, &state.occupied);
+        progress.failed += plan.count(RenamePlan::Status::Conflict);
+        markDuplicates(&plan.entries, candidates, duplicates);
+        result.append(plan);
+    }
+    if(progress.matched == 0)
+    {
+        qWarning() << "No files match any rule in: " << root;
+        return failure("No files match any rule in: " + root);
+    }
+    reportProgress();
+    return result;
+}
+
+QString BatchRenamer::apply(RenamePlan& plan)
+{
+    progress = Progress();
+    progress.matched = plan.entries.size();
+    progress.failed = plan.count(RenamePlan::Status::Conflict);
+    if(!plan.error.isEmpty())
+    {
+        return plan.error;
+    }
+    return executePlan(plan);
+}
+
+QString BatchRenamer::undo(const QString& directory)
+{
+    progress = Progress();
+    if(storage)
+    {
+        return "Undo is not supported for remote libraries.";
+    }
+    RenameJournal journal(directory);
+    RenamePlan plan;
+    RenameJournal::Phase phase;
+    if(!journal.load(&plan, &phase) || phase == RenameJournal::Phase::Undone)
+    {
+        qWarning() << "Nothing to undo in: " << directory;
+        return "Nothing to undo in: " + directory;
+    }
+    if(!journal.open())
+    {
+        return "Failed to open rename journal for: " + directory;
+    }
+    journal.markUndoStarted();
+    progress.matched = plan.count(RenamePlan::Status::Renamed) + plan.count(RenamePlan::Status::Pending);
+    DirectoryRenamer renamer(plan.directory, renameBackend);
+    int restoredCount = 0;
+    // 逆序撤销，保证名称先后依赖的条目能依次复原
+    for(int i = plan.entries.size() - 1; i >= 0; i--)
+    {
+        const RenamePlan::Entry& entry = plan.entries[i];
+        bool renamed = entry.status == RenamePlan::Status::Renamed;
+        // 最后一组记录可能未落盘：原文件已不在而新文件存在，说明已重命名
+        if(entry.status == RenamePlan::Status::Pending && !renamer.exists(entry.oldName) && renamer.exists(entry.newName))
+        {
+            renamed = true;
+        }
+        if(!renamed)
+        {
+            continue;
+        }
+        if(cancelRequested.loadRelaxed())
+        {
+            qWarning() << "Undo cancelled.";
+            return "Cancelled after restoring " + QString::number(restoredCount) + " file(s).";
+        }
+        // 上次撤销被中断时，撤销记录可能未落盘，此时文件已经复原
+        int error = renamer.rename(entry.newName, entry.oldName);
+        if(error == 0 || (!renamer.exists(entry.newName) && renamer.exists(entry.oldName)))
+        {
+            journal.markUndone(i);
+            restoredCount++;
+            progress.renamed++;
+        }
+        else
+        {
+            qWarning() << "Failed to restore: " << entry.newName << " to " << entry.oldName
+                       << DirectoryRenamer::errorString(error);
+            progress.failed++;
+        }
+        reportProgress();
+    }
+    journal.finishUndo();
+    return "Successfully restored " + QString::number(restoredCount) + " file(s).";
+}
+
+QString BatchRenamer::resume(const QString& directory)
+{
+    progress = Progress();
+    if(storage)
+    {
+        return "Resume is not supported for remote libraries.";
+    }
+    RenameJournal journal(directory);
+    RenamePlan plan;
+    RenameJournal::Phase phase;
+    if(!journal.load(&plan, &phase) || phase != RenameJournal::Phase::Running)
+    {
+        qWarning() << "No interrupted batch to resume in: " << directory;
+        return "No interrupted batch to resume in: " + directory;
+    }
+    if(!journal.open())
+    {
+        return "Failed to open rename journal for: " + directory;
+    }
+    // 日志不记录比较方式，按不区分大小写安排先后：只会多出依赖，不会漏掉
+    plan.caseInsensitive = true;
+    progress.matched = plan.entries.size();
+    progress.renamed = plan.count(RenamePlan::Status::Renamed);
+    progress.failed = plan.count(RenamePlan::Status::Conflict) + plan.count(RenamePlan::Status::Failed);
+    return executePlan(plan, journal, true);
+}
+
+QString BatchRenamer::startWatch(const QString& format, const QVector<QString> &replacements, const QString& directory,
+                                 const QString& extensionFilter, bool caseInsensitive, RenamePlan* plan)
+{
+    watch = WatchState();
+    if(storage)
+    {
+        plan->error = "Watching is not supported for remote libraries.";
+        return plan->error;
+    }
+    *plan = buildPlan(format, replacements, directory, extensionFilter, caseInsensitive, &watch, nullptr);
+    if(!plan->error.isEmpty())
+    {
+        watch = WatchState();
+        return plan->error;
+    }
+    watch.active = true;
+    QString feedback = executePlan(*plan);
+    restoreFailedNames(*plan);
+    return feedback;
+}
+
+QString BatchRenamer::renameArrived(const QStringList& fileNames, RenamePlan* plan)
+{
+    progress = Progress();
+    *plan = RenamePlan();
+    plan->directory = watch.directory;
+    plan->caseInsensitive = watch.caseInsensitive;
+    if(!watch.active)
+    {
+        plan->error = "Not watching any directory.";
+        return plan->error;
+    }
+    QDir dir(watch.directory);
+    // 每个文件只做一次stat和一次分类，与目录中已有的文件数无关
+    QStringList candidates;
+    for(const QString& fileName : fileNames)
+    {
+        QFileInfo info(dir.filePath(fileName));
+        if(!info.isFile() || info.isHidden() || RenameScheduler::isTemporaryName(fileName))
+        {
+            continue;
+        }
+        if(!watch.occupied.contains(fileName))
+        {
+            watch.occupied.insert(fileName);
+        }
+        progress.scanned++;
+        if(!matchesExtension(fileName, watch.classifier)
+           && !(contentSniffing && !watch.classifier.matchesAll()
+                && watch.classifier.matchFileHeaders(watch.directory, QStringList{fileName}, 1).front()))
+        {
+            continue;
+        }
+        progress.matched++;
+        FileMatch match = classifyFile(fileName, watch.compiled);
+        if(match.conforming)
+        {
+            // 外部放入的已编号文件推进计数器，避免之后的编号与之重复
+            if(watch.compiled.usesMetadata)
+            {
+                noteConforming(fileName, watch.compiled, &watch.tuples);
+            }
+            else
+                if(watch.compiled.parsed.hasNumberPlaceholder && match.number > watch.maxNumber)
+                {
+                    watch.maxNumber = match.number;
+                }
+            continue;
+        }
+        candidates.append(fileName);
+    }
+    // 同一批内按编号顺序排序，与事件到达的先后无关；只能发现同一批内的重复文件
+    QHash<QString, QString> duplicates;
+    QVector<RenamePlan::Entry> moves = generateMoves(watch.directory, watch.compiled, &candidates, &watch.maxNumber,
+                                                     &watch.tuples, &duplicates);
+    plan->entries = scheduleMoves(moves, &watch.occupied);
+    progress.failed += plan->count(RenamePlan::Status::Conflict);
+    markDuplicates(&plan->entries, candidates, duplicates);
+    reportProgress();
+    QString feedback = executePlan(*plan);
+    restoreFailedNames(*plan);
+    return feedback;
+}
+
+void BatchRenamer::forgetRemoved(const QStringList& fileNames)
+{
+    for(const QString& fileName : fileNames)
+    {
+        watch.occupied.remove(fileName);
+    }
+}
+
+void BatchRenamer::stopWatch()
+{
+    watch = WatchState();
+}
+
+bool BatchRenamer::isWatching() const
+{
+    return watch.active;
+}
+
+QVector<RenamePlan::Entry> BatchRenamer::generateMoves(const QString& directory, const CompiledFormat& compiled,
+                                                       QStringList* candidates, int* maxNumber, TupleNumbering* tuples,
+                                                       QHash<QString, QString>* duplicates)
+{
+    {
+        RunStats::Scope scope(&runStats, RunStats::Phase::Sort);
+        // 远程存储只按名称排序，不读取本地文件属性
+        FileOrder::Key order = numberingOrder;
+        if(storage && order != FileOrder::Key::Name && order != FileOrder::Key::NaturalName)
+        {
+            order = FileOrder::Key::Name;
+        }
+        FileOrder::sort(directory, candidates, order);
+    }
+    // 含元数据占位符时并行读取待重命名文件的文件头（已符合格式的文件不读），按代入后的占位符分组编号
+    QVector<MediaMetadata> metadata;
+    if(compiled.usesMetadata)
+    {
+        RunStats::Scope scope(&runStats, RunStats::Phase::Metadata);
+        metadata = MetadataReader::readAll(directory, *candidates);
+    }
+    // 内容相同的文件按编号顺序以第一个为原件，跳过时其余文件不占用编号
+    *duplicates = findDuplicates(directory, *candidates);
+    RunStats::Scope scope(&runStats, RunStats::Phase::Generate);
+    QVector<RenamePlan::Entry> moves;
+    moves.reserve(candidates->size());
+    for(int i = 0; i < candidates->size(); i++)
+    {
+        const QString& fileName = candidates->at(i);
+        if(duplicateMode == DuplicateMode::Skip && duplicates->contains(fileName))
+        {
+            continue;
+        }
+        RenamePlan::Entry entry;
+        entry.oldName = fileName;
+        entry.newName = compiled.usesMetadata ? generateTupleFileName(fileName, compiled, metadata[i], tuples)
+                                              : generateFileName(fileName, compiled, ++*maxNumber);
+        runStats.add(RunStats::Counter::NameBytes, entry.newName.size() * qint64(sizeof(QChar)));
+        moves.append(entry);
+    }
+    return moves;
+}
+
+QHash<QString, QString> BatchRenamer::findDuplicates(const QString& directory, const QStringList& candidates)
+{
+    QHash<QString, QString> result;
+    // 远程存储不下载文件内容
+    if(duplicateMode == DuplicateMode::Off || storage)
+    {
+        return result;
+    }
+    RunStats::Scope scope(&runStats, RunStats::Phase::Duplicates);
+    QVector<int> original = DuplicateFinder::find(directory, candidates);
+    for(int i = 0; i < candidates.size(); i++)
+    {
+        if(original[i] >= 0)
+        {
+            result.insert(candidates[i], candidates[original[i]]);
+        }
+    }
+    return result;
+}
+
+QVector<RenamePlan::Entry> BatchRenamer::scheduleMoves(const QVector<RenamePlan::Entry>& moves, NameIndex* occupied)
+{
+    RunStats::Scope scope(&runStats, RunStats::Phase::Schedule);
+    QVector<RenamePlan::Entry> entries = RenameScheduler::schedule(moves, occupied);
+    for(const RenamePlan::Entry& entry : std::as_const(entries))
+    {
+        if(entry.status == RenamePlan::Status::Conflict)
+        {
+            runStats.add(RunStats::Counter::Conflicts);
+        }
+    }
+    return entries;
+}
+
+void BatchRenamer::markDuplicates(QVector<RenamePlan::Entry>* entries, const QStringList& candidates,
+                                  const QHash<QString, QString> &duplicates)
+{
+    if(duplicates.isEmpty())
+    {
+        return;
+    }
+    if(duplicateMode == DuplicateMode::Report)
+    {
+        for(RenamePlan::Entry& entry : *entries)
+        {
+            auto it = duplicates.constFind(entry.oldName);
+            if(it != duplicates.constEnd())
+            {
+                entry.duplicateOf = it.value();
+            }
+        }
+        return;
+    }
+    // 按编号顺序追加，计划与目录的枚举顺序无关
+    for(const QString& fileName : candidates)
+    {
+        auto it = duplicates.constFind(fileName);
+        if(it == duplicates.constEnd())
+        {
+            continue;
+        }
+        RenamePlan::Entry entry;
+        entry.oldName = fileName;
+        entry.status = RenamePlan::Status::Duplicate;
+        entry.duplicateOf = it.value();
+        entries->append(entry);
+    }
+}
+
+void BatchRenamer::restoreFailedNames(const RenamePlan& plan)
+{
+    for(const RenamePlan::Entry& entry : plan.entries)
+    {
+        // 取消后未执行的条目同样仍是原名称
+        if(entry.status == RenamePlan::Status::Failed || entry.status == RenamePlan::Status::Pending)
+        {
+            watch.occupied.remove(entry.newName);
+            watch.occupied.insert(entry.oldName);
+        }
+    }
+}
+
+QString BatchRenamer::executePlan(RenamePlan& plan)
+{
+    runStats.setContext(plan.directory);
+    if(storage)
+    {
+        return executeRemote(plan);
+    }
+    RenameJournal journal(plan.directory);
+    // 没有要执行的条目时保留上一个批次的日志，以便撤销
+    qint64 journalStart = RunStats::now();
+    if(plan.count(RenamePlan::Status::Pending) > 0 && !journal.begin(plan))
+    {
+        qWarning() << "Renaming without a journal: " << plan.directory;
+    }
+    runStats.addSpan(RunStats::Phase::Journal, journalStart, RunStats::now() - journalStart);
+    QString result = executePlan(plan, journal, false);
+    // 有文件被重命名而日志不可用时告知调用者：本批次无法撤销
+    if(plan.count(RenamePlan::Status::Renamed) > 0 && !journal.isValid())
+    {
+        result += " The rename journal could not be written; this batch cannot be undone.";
+    }
+    return result;
+}
+
+QString BatchRenamer::executePlan(RenamePlan& plan, RenameJournal& journal, bool recovering)
+{
+    DirectoryRenamer renamer(plan.directory, renameBackend);
+    // 队列深度大于1时互不依赖的条目同时提交；QDir方式没有不覆盖的原子重命名，始终逐个执行
+    std::unique_ptr<PipelinedRenamer> pipeline;
+    if(queueDepth > 1 && renamer.usesDirectoryHandle())
+    {
+        pipeline.reset(new PipelinedRenamer(plan.directory, queueDepth));
+    }
+    int successCount = 0;
+    // 区间覆盖整个循环，阶段耗时扣除其中写日志的部分
+    qint64 renameStart = RunStats::now();
+    qint64 journalTime = 0;
+    auto finishStats = [&]()
+    {
+        runStats.addSpan(RunStats::Phase::Rename, renameStart, RunStats::now() - renameStart);
+        runStats.addTime(RunStats::Phase::Rename, -journalTime);
+        runStats.addTime(RunStats::Phase::Journal, journalTime);
+        runStats.add(RunStats::Counter::Syscalls, renamer.callCount() + (pipeline ? pipeline->callCount() : 0));
+    };
+    auto cancelled = [&]()
+    {
+        qWarning() << "Rename cancelled.";
+        journal.commit();
+        finishStats();
+        return "Cancelled after renaming " + QString::number(successCount) + " file(s).";
+    };
+    // 记录一个条目的结果（并发执行时按完成顺序）
+    auto complete = [&](int i, int error)
+    {
+        RenamePlan::Entry& entry = plan.entries[i];
+        entry.error = error;
+        bool renamed = entry.error == 0;
+        // 续做时最后一组记录可能未落盘：原文件已不在而新文件存在，说明已重命名
+        if(!renamed && recovering && !renamer.exists(entry.oldName) && renamer.exists(entry.newName))
+        {
+            renamed = true;
+            entry.error = 0;
+        }
+        qint64 markStart = RunStats::now();
+        if(renamed)
+        {
+            entry.status = RenamePlan::Status::Renamed;
+            journal.markCompleted(i);
+            journalTime += RunStats::now() - markStart;
+            successCount++;
+            progress.renamed++;
+        }
+        else
+        {
+            qWarning() << "Failed to rename: " << entry.oldName << " to " << entry.newName
+                       << DirectoryRenamer::errorString(entry.error);
+            entry.status = RenamePlan::Status::Failed;
+            journal.markFailed(i);
+            journalTime += RunStats::now() - markStart;
+            progress.failed++;
+        }
+        reportProgress();
+    };
+    if(!pipeline)
+    {
+        for(int i = 0; i < plan.entries.size(); i++)
+        {
+            if(plan.entries[i].status != RenamePlan::Status::Pending)
+            {
+                continue;
+            }
+            // 在文件之间响应取消请求，已完成的记录落盘后可续做
+            if(cancelRequested.loadRelaxed())
+            {
+                return cancelled();
+            }
+            // 冲突已在计划中排除，计划之后才出现的同名文件也不会被覆盖
+            complete(i, renamer.rename(plan.entries[i].oldName, plan.entries[i].newName));
+        }
+    }
+    else
+    {
+        // 链和环中的条目等前一个完成后才提交；前一个失败时照常提交，由RENAME_NOREPLACE给出与逐个执行相同的结果
+        QVector<QVector<int>> dependencies = RenameScheduler::dependencies(plan.entries, plan.caseInsensitive);
+        QVector<QVector<int>> dependents(plan.entries.size());
+        QVector<int> remaining(plan.entries.size(), 0);
+        std::deque<int> ready;
+        for(int i = 0; i < plan.entries.size(); i++)
+        {
+            remaining[i] = dependencies[i].size();
+            for(int dependency : std::as_const(dependencies[i]))
+            {
+                dependents[dependency].append(i);
+            }
+            if(plan.entries[i].status == RenamePlan::Status::Pending && remaining[i] == 0)
+            {
+                ready.push_back(i);
+            }
+        }
+        while(true)
+        {
+            while(!cancelRequested.loadRelaxed() && !ready.empty() && pipeline->pending() < pipeline->depth())
+            {
+                int i = ready.front();
+                ready.pop_front();
+                pipeline->submit(i, plan.entries[i].oldName, plan.entries[i].newName);
+            }
+            if(pipeline->pending() == 0)
+            {
+                break;
+            }
+            pipeline->reap([&](int i, int error)
+            {
+                complete(i, error);
+                for(int dependent : std::as_const(dependents[i]))
+                {
+                    if(--remaining[dependent] == 0)
+                    {
+                        ready.push_back(dependent);
+                    }
+                }
+            });
+        }
+        // 取消时已提交的重命名都已取回结果
+        if(cancelRequested.loadRelaxed())
+        {
+            return cancelled();
+        }
     }
-    // 获取目录中所有文件
-    QFileInfoList allFiles = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
-    // 根据扩展名过滤文件
-    QFileInfoList files = filterFilesByExtension(allFiles, extensionFilter);
-    if(files.isEmpty())
+    finishStats();
     {
-        qWarning() << "No files match the extension filter: " << extensionFilter;
-        return "No files match the extension filter: " + extensionFilter;
+        RunStats::Scope scope(&runStats, RunStats::Phase::Journal);
+        journal.finish();
     }
-    // 查找最大编号（如果有数字占位符）
-    int maxNumber = -1;
-    if(parsed.hasNumberPlaceholder)
+    int duplicateCount = plan.count(RenamePlan::Status::Duplicate);
+    if(duplicateCount > 0)
     {
-        maxNumber = findMaxNumber(files, parsed, replacements);
+        return "Successfully renamed " + QString::number(successCount) + " file(s), skipped "
+               + QString::number(duplicateCount) + " duplicate(s).";
     }
-    // 重命名文件
+    return "Successfully renamed " + QString::number(successCount) + " file(s).";
+}
+
+QString BatchRenamer::executeRemote(RenamePlan& plan)
+{
+    // 远程存储不写本地日志（服务器保留文件历史），执行顺序的依赖由存储后端保证
     int successCount = 0;
-    for(const QFileInfo& fileInfo : files)
+    QStringList stranded;
+    qint64 renameStart = RunStats::now();
+    qint64 requests = storage->renameAll(plan.directory, &plan.entries, plan.caseInsensitive, cancelRequested, [&](int i)
     {
-        // 跳过已经符合格式的文件
-        if(matchesFormat(fileInfo.fileName(), parsed, replacements))
-        {
-            continue;
-        }
-        // 生成新文件名
-        QString newName = generateFileName(fileInfo.fileName(), parsed, replacements, ++maxNumber);
-        QString newPath = dir.absoluteFilePath(newName);
-        // 检查新文件名是否已存在
-        if(QFile::exists(newPath))
-        {
-            qWarning() << "Target file already exists: " << newPath;
-            continue;
-        }
-        // 重命名文件
-        if(dir.rename(fileInfo.fileName(), newName))
+        if(plan.entries[i].status == RenamePlan::Status::Renamed)
         {
             successCount++;
+            progress.renamed++;
         }
         else
         {
-            qWarning() << "Failed to rename: " << fileInfo.fileName() << " to " << newName;
+            qWarning() << "Failed to rename: " << plan.entries[i].oldName << " to " << plan.entries[i].newName
+                       << DirectoryRenamer::errorString(plan.entries[i].error);
+            progress.failed++;
         }
+        reportProgress();
+    }, &stranded);
+    runStats.addSpan(RunStats::Phase::Rename, renameStart, RunStats::now() - renameStart);
+    runStats.add(RunStats::Counter::Syscalls, requests);
+    // 没有日志可续做，留在临时名称下的文件须告知用户
+    QString strandedNote;
+    if(!stranded.isEmpty())
+    {
+        strandedNote = " " + QString::number(stranded.size()) + " file(s) could not be moved back and remain under "
+                       "temporary names: " + stranded.join(", ") + ".";
     }
-    return "Successfully renamed " + QString::number(successCount) + " file(s).";
+    if(cancelRequested.loadRelaxed())
+    {
+        qWarning() << "Rename cancelled.";
+        return "Cancelled after renaming " + QString::number(successCount) + " file(s)." + strandedNote;
+    }
+    int duplicateCount = plan.count(RenamePlan::Status::Duplicate);
+    if(duplicateCount > 0)
+    {
+        return "Successfully renamed " + QString::number(successCount) + " file(s), skipped "
+               + QString::number(duplicateCount) + " duplicate(s)." + strandedNote;
+    }
+    return "Successfully renamed " + QString::number(successCount) + " file(s)." + strandedNote;
 }
 
 BatchRenamer::ParsedFormat BatchRenamer::parseFormat(const QString& format)
 {
     ParsedFormat result;
+    // 空格式没有占位符，视为无效
+    if(format.isEmpty())
+    {
+        return result;
+    }
     // 先判断重命名模式
     if(format.front() == '?')
     {
         result.mode = RenameMode::RegularExpression;
         result.rawFormat = format.mid(1);
-        if(QRegularExpression(result.rawFormat).isValid())
-        {
-            Placeholder ph;
-            ph.type = PlaceholderType::RegularExpression;
-            ph.index = 1;
-            ph.position = 0;
-            ph.length = 1;
-            result.placeholders.append(ph);
+        // 可以有多条以“;;”分隔的规则，全部有效时格式才有效；每条规则对应一项替换内容
+        QStringList patterns = RegexRuleList::split(result.rawFormat);
+        bool valid = true;
+        for(const QString& pattern : std::as_const(patterns))
+        {
+            runStats.add(RunStats::Counter::RegexCompiles);
+            valid = valid && QRegularExpression(pattern).isValid();
+        }
+        if(valid)
+        {
+            for(int i = 0; i < patterns.size(); i++)
+            {
+                Placeholder ph;
+                ph.type = PlaceholderType::RegularExpression;
+                ph.index = i + 1;
+                ph.position = 0;
+                ph.length = 1;
+                result.placeholders.append(ph);
+            }
             result.hasNumberPlaceholder = false;
         }
         return result;
@@ -119,6 +1082,7 @@ BatchRenamer::ParsedFormat BatchRenamer::parseFormat(const QString& format)
     result.rawFormat = format;
     result.rawFormat.remove('*');
     // 再搜索占位符
+    runStats.add(RunStats::Counter::RegexCompiles);
     QRegularExpression regex(R"(\\(\d+)|(\\d(\d+)))");
     auto matches = regex.globalMatch(result.rawFormat);
     while(matches.hasNext())
@@ -159,8 +1123,8 @@ QString BatchRenamer::buildRegexPattern(const ParsedFormat& parsed, const QVecto
         {
             if(ph.index > 0 && ph.index <= replacements.size())
             {
-                // 普通占位符：在严格模式下匹配具体的替换文本
-                if(strictMode)
+                // 普通占位符：在严格模式下匹配具体的替换文本（按文件代入元数据的除外）
+                if(strictMode && !MetadataReader::hasTokens(replacements[ph.index - 1]))
                 {
                     replacement = (replacements[ph.index - 1]);
                 }
@@ -182,96 +1146,482 @@ QString BatchRenamer::buildRegexPattern(const ParsedFormat& parsed, const QVecto
         }
         pattern.replace(ph.position, ph.length, replacement);
     }
-    switch(parsed.mode)
+    return anchorPattern(pattern, parsed.mode);
+}
+
+QString BatchRenamer::buildGroupPattern(const ParsedFormat& parsed, const QVector<QString> &replacements)
+{
+    if(parsed.mode == RenameMode::RegularExpression)
+    { return parsed.rawFormat; }
+    QString pattern;
+    QVector<bool> captured(replacements.size(), false);
+    bool numberCaptured = false;
+    int last = 0;
+    for(const auto& ph : parsed.placeholders)
+    {
+        pattern += parsed.rawFormat.mid(last, ph.position - last);
+        if(ph.type == PlaceholderType::Regular)
+        {
+            bool valid = ph.index > 0 && ph.index <= replacements.size();
+            if(valid && !MetadataReader::hasTokens(replacements[ph.index - 1]))
+            {
+                pattern += replacements[ph.index - 1];
+            }
+            else
+                if(valid && !captured[ph.index - 1])
+                {
+                    // 同一替换内容再次出现时代入的文本相同，只取第一处
+                    pattern += QString("(?<v%1>[^_]+)").arg(ph.index);
+                    captured[ph.index - 1] = true;
+                }
+                else
+                {
+                    pattern += "[^_]+";
+                }
+        }
+        else
+        {
+            pattern += QString(numberCaptured ? "\\d{%1}" : "(?<n>\\d{%1})").arg(ph.index);
+            numberCaptured = true;
+        }
+        last = ph.position + ph.length;
+    }
+    pattern += parsed.rawFormat.mid(last);
+    return anchorPattern(pattern, parsed.mode);
+}
+
+QString BatchRenamer::anchorPattern(const QString& pattern, RenameMode mode)
+{
+    switch(mode)
     {
         case RenameMode::Strict:
-            pattern = "^" + pattern + "$";
-            break;
+            return "^" + pattern + "$";
         case RenameMode::Append:
-            pattern = pattern + "$";
-            break;
+            return pattern + "$";
         case RenameMode::Prepend:
-            pattern = "^" + pattern;
-            break;
+            return "^" + pattern;
         case RenameMode::Regular:
-            break;
         default:
-            break;
+            return pattern;
+    }
+}
+
+FormatMatcher BatchRenamer::buildMatcher(const ParsedFormat& parsed, const QVector<QString> &replacements, bool strictMode)
+{
+    FormatMatcher matcher;
+    // 正则表达式模式不使用专用匹配器
+    if(parsed.mode == RenameMode::RegularExpression)
+    { return matcher; }
+    // 与buildRegexPattern逐段对应
+    int last = 0;
+    for(const auto& ph : parsed.placeholders)
+    {
+        matcher.addLiteral(parsed.rawFormat.mid(last, ph.position - last));
+        if(ph.type == PlaceholderType::Regular)
+        {
+            if(strictMode && ph.index > 0 && ph.index <= replacements.size()
+               && !MetadataReader::hasTokens(replacements[ph.index - 1]))
+            {
+                matcher.addLiteral(replacements[ph.index - 1]);
+            }
+            else
+            {
+                matcher.addField();
+            }
+        }
+        else
+        {
+            matcher.addDigits(ph.index);
+        }
+        last = ph.position + ph.length;
     }
-    return pattern;
+    matcher.addLiteral(parsed.rawFormat.mid(last));
+    matcher.setAnchors(parsed.mode == RenameMode::Strict || parsed.mode == RenameMode::Prepend,
+                       parsed.mode == RenameMode::Strict || parsed.mode == RenameMode::Append);
+    return matcher;
+}
+
+bool BatchRenamer::matchesExtension(QStringView fileName, const ExtensionClassifier& classifier)
+{
+    return classifier.matchesSuffix(suffixOf(fileName));
 }
 
-QFileInfoList BatchRenamer::filterFilesByExtension(const QFileInfoList& files, const QString& extensionFilter)
+BatchRenamer::ScanResult BatchRenamer::scanDirectory(const QString& directory, const ExtensionClassifier& classifier,
+                                                     const CompiledFormat& compiled, bool caseInsensitive,
+                                                     const NumberingIndex* index, QStringList* subdirectories)
 {
-    QFileInfoList result;
-    QRegularExpression regex(extensionFilter, QRegularExpression::CaseInsensitiveOption);
-    if(!regex.isValid())
+    ScanResult result;
+    result.occupied = NameIndex(caseInsensitive);
+    // 逐文件的过滤只累加耗时，枚举阶段的耗时扣除这一部分
+    qint64 filterTime = 0;
+    // 记录分类结果：已符合格式的文件只贡献编号，不再保留
+    auto record = [&](QStringView fileName, const FileMatch& match)
+    {
+        runStats.add(match.conforming ? RunStats::Counter::Conforming : RunStats::Counter::Candidates);
+        if((numberingIndex || compiled.usesMetadata) && match.conforming)
+        {
+            result.conforming.insert(fileName.toString(), match.number);
+        }
+        if(!match.conforming)
+        {
+            result.candidates.append(fileName.toString());
+        }
+        else
+            if(match.number > result.maxNumber)
+            {
+                result.maxNumber = match.number;
+            }
+    };
+    // 需要分类的文件先存入名称表，枚举结束后统一分类
+    FileTable matchQueue;
+    auto accept = [&](const FileTable& files, int row, const QString& fileName)
+    {
+        progress.matched++;
+        runStats.add(RunStats::Counter::Filtered);
+        // 索引中已有的文件直接取上次的分类结果
+        FileMatch match;
+        if(index && index->lookup(fileName, &match.number))
+        {
+            match.conforming = true;
+            record(fileName, match);
+        }
+        else
+        {
+            matchQueue.append(files.name(row));
+        }
+    };
+    // 扩展名未通过、需要读取文件头判断的文件（远程存储不读取文件内容）
+    FileTable sniffQueue;
+    // 不区分大小写时，与已有名称只差大小写的名称不进入已占用集合的名称表，单独存放
+    FileTable aliases;
+    bool sniffing = contentSniffing && !storage && !classifier.matchesAll();
+    qint64 scanStart = RunStats::now();
+    auto finishScan = [&]()
+    {
+        runStats.addSpan(RunStats::Phase::Enumerate, scanStart, RunStats::now() - scanStart);
+        runStats.addTime(RunStats::Phase::Enumerate, -filterTime);
+        runStats.addTime(RunStats::Phase::Filter, filterTime);
+    };
+    // 处理一个目录项：所有名称都记入已占用集合，只有普通的非隐藏文件参与重命名
+    auto visit = [&](const QString& fileName, bool isFile, bool isHidden, bool isTraversableDir)
+    {
+        runStats.add(RunStats::Counter::Enumerated);
+        runStats.add(RunStats::Counter::NameBytes, fileName.size() * qint64(sizeof(QChar)));
+        int row = result.occupied.insert(fileName);
+        const FileTable* files = &result.occupied.names();
+        if(files->name(row) != fileName)
+        {
+            row = aliases.append(fileName);
+            files = &aliases;
+        }
+        // 子文件夹随同一次枚举收集
+        if(subdirectories && isTraversableDir && !isHidden)
+        {
+            subdirectories->append(fileName);
+        }
+        // 中断后残留的临时名称留给续做处理
+        if(!isFile || isHidden || RenameScheduler::isTemporaryName(fileName))
+        {
+            return;
+        }
+        progress.scanned++;
+        qint64 filterStart = RunStats::now();
+        bool passed = classifier.matchesSuffix(files->suffix(row));
+        filterTime += RunStats::now() - filterStart;
+        if(passed)
+        {
+            accept(*files, row, fileName);
+        }
+        else
+            if(sniffing)
+            {
+                sniffQueue.append(fileName);
+            }
+        reportProgress();
+    };
+    if(storage)
+    {
+        // 远程存储：目录列表一次取回，其中已带有类型，不再逐项访问
+        QVector<StorageEntry> entries;
+        if(!storage->list(directory, &entries, &result.error))
+        {
+            finishScan();
+            return result;
+        }
+        for(const StorageEntry& entry : std::as_const(entries))
+        {
+            if(cancelRequested.loadRelaxed())
+            {
+                finishScan();
+                result.cancelled = true;
+                return result;
+            }
+            visit(entry.name, !entry.isDirectory, entry.name.startsWith('.'), entry.isDirectory);
+        }
+    }
+    else
+    {
+        QDirIterator it(directory, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        while(it.hasNext())
+        {
+            if(cancelRequested.loadRelaxed())
+            {
+                finishScan();
+                result.cancelled = true;
+                return result;
+            }
+            it.next();
+            QFileInfo info = it.fileInfo();
+            // 不跟随符号链接以免成环
+            visit(it.fileName(), info.isFile(), info.isHidden(), subdirectories && info.isDir() && !info.isSymLink());
+        }
+    }
+    finishScan();
+    // 只对扩展名未通过的文件并行读取文件头
+    if(!sniffQueue.isEmpty())
     {
-        qWarning() << "Invalid regex pattern in extension filter:" << extensionFilter;
-        return files; // 返回所有文件作为降级处理
+        QStringList sniffNames;
+        sniffNames.reserve(sniffQueue.size());
+        for(int i = 0; i < sniffQueue.size(); i++)
+        {
+            sniffNames.append(sniffQueue.name(i).toString());
+        }
+        qint64 sniffStart = RunStats::now();
+        QVector<char> sniffed = classifier.matchFileHeaders(directory, sniffNames);
+        runStats.addSpan(RunStats::Phase::Filter, sniffStart, RunStats::now() - sniffStart);
+        for(int i = 0; i < sniffQueue.size(); i++)
+        {
+            if(sniffed[i])
+            {
+                accept(sniffQueue, i, sniffNames[i]);
+            }
+        }
+        reportProgress();
     }
-    for(const QFileInfo& fileInfo : files)
+    // 分块并行分类，再按枚举顺序逐个记录，结果与逐个分类相同
+    if(!matchQueue.isEmpty())
     {
-        QString ext = fileInfo.suffix();
-        if(regex.match(ext).hasMatch())
+        qint64 matchStart = RunStats::now();
+        QVector<FileMatch> matches = classifyFiles(matchQueue, compiled);
+        if(cancelRequested.loadRelaxed())
+        {
+            runStats.addSpan(RunStats::Phase::Match, matchStart, RunStats::now() - matchStart);
+            result.cancelled = true;
+            return result;
+        }
+        for(int i = 0; i < matchQueue.size(); i++)
         {
-            result.append(fileInfo);
+            record(matchQueue.name(i), matches[i]);
         }
+        runStats.addSpan(RunStats::Phase::Match, matchStart, RunStats::now() - matchStart);
     }
+    // 与QDir默认的排序（按名称、忽略大小写）一致，保证编号顺序不变
+    RunStats::Scope scope(&runStats, RunStats::Phase::Sort);
+    FileOrder::sort(directory, &result.candidates, FileOrder::Key::Name);
     return result;
 }
 
-int BatchRenamer::findMaxNumber(const QFileInfoList& files, const ParsedFormat& parsed, const QVector<QString> &replacements)
+BatchRenamer::FileMatch BatchRenamer::classifyFile(QStringView fileName, const CompiledFormat& compiled)
 {
-    int maxNumber = -1;
-    for(const QFileInfo& fileInfo : files)
+    FileMatch result;
+    // 只匹配文件名（不含扩展名）
+    QStringView baseName = completeBaseNameOf(fileName);
+    result.conforming = matchesFormat(baseName, compiled);
+    if(result.conforming && compiled.parsed.hasNumberPlaceholder)
+    {
+        result.number = extractNumber(baseName, compiled);
+    }
+    return result;
+}
+
+BatchRenamer::FileMatch BatchRenamer::classifyFile(const FileTable& files, int i, const CompiledFormat& compiled)
+{
+    FileMatch result;
+    QStringView baseName = files.completeBaseName(i);
+    result.conforming = matchesFormat(baseName, compiled);
+    if(result.conforming && compiled.parsed.hasNumberPlaceholder)
+    {
+        result.number = extractNumber(baseName, compiled);
+    }
+    return result;
+}
+
+QVector<BatchRenamer::FileMatch> BatchRenamer::classifyFiles(const FileTable& files, const CompiledFormat& compiled)
+{
+    QVector<FileMatch> result(files.size());
+    FileMatch* matches = result.data();
+    // 各块写入互不重叠的下标，不需要加锁；编译结果只读，各线程共用
+    forEachChunk(files.size(), [this, &files, &compiled, matches](int begin, int end)
+    {
+        for(int i = begin; i < end; i++)
+        {
+            matches[i] = classifyFile(files, i, compiled);
+        }
+    });
+    return result;
+}
+
+bool BatchRenamer::forEachChunk(int count, const std::function<void(int, int)>& work)
+{
+    int chunks = (count + classifyChunkSize - 1) / classifyChunkSize;
+    int threads = qMin(chunks, matchThreads > 0 ? matchThreads : QThread::idealThreadCount());
+    // 各线程依次领取下一块，处理快的线程多领；每块之间响应取消请求
+    QAtomicInt next;
+    auto run = [this, &work, &next, count, chunks]()
+    {
+        for(int chunk = next.fetchAndAddRelaxed(1); chunk < chunks && !cancelRequested.loadRelaxed();
+            chunk = next.fetchAndAddRelaxed(1))
+        {
+            int begin = chunk * classifyChunkSize;
+            work(begin, qMin(begin + classifyChunkSize, count));
+        }
+    };
+    // 当前线程也领取；全局线程池没有空闲线程时不等待，剩下的块由已有的线程处理完
+    QSemaphore done;
+    int started = 0;
+    for(int t = 1; t < threads; t++)
+    {
+        if(!QThreadPool::globalInstance()->tryStart([&run, &done]()
+        {
+            run();
+            done.release();
+        }))
+        {
+            break;
+        }
+        started++;
+    }
+    run();
+    done.acquire(started);
+    return !cancelRequested.loadRelaxed();
+}
+
+BatchRenamer::CompiledFormat BatchRenamer::compileFormat(const ParsedFormat& parsed, const QVector<QString> &replacements)
+{
+    CompiledFormat compiled;
+    compiled.parsed = parsed;
+    compiled.replacements = replacements;
+    for(const QString& replacement : replacements)
+    {
+        compiled.usesMetadata = compiled.usesMetadata || MetadataReader::hasTokens(replacement);
+    }
+    // 正则表达式模式：各条规则只编译一次，匹配和替换都经过规则列表
+    if(parsed.mode == RenameMode::RegularExpression)
+    {
+        QStringList patterns = RegexRuleList::split(parsed.rawFormat);
+        compiled.rules.compile(patterns, replacements);
+        runStats.add(RunStats::Counter::RegexCompiles, patterns.size());
+        return compiled;
+    }
+    compiled.lenientRegex.setPattern(buildRegexPattern(parsed, replacements, false));
+    compiled.lenientRegex.setPatternOptions(QRegularExpression::DontCaptureOption);
+    compiled.strictRegex.setPattern(buildRegexPattern(parsed, replacements, true));
+    runStats.add(RunStats::Counter::RegexCompiles, 2);
+    // 预先编译（支持时使用JIT），避免逐文件编译
+    if(compiled.lenientRegex.isValid())
+    {
+        compiled.lenientRegex.optimize();
+    }
+    else
+    {
+        qWarning() << "Invalid regex pattern:" << compiled.lenientRegex.pattern();
+    }
+    if(compiled.strictRegex.isValid())
+    {
+        compiled.strictRegex.optimize();
+    }
+    else
+    {
+        qWarning() << "Invalid regex pattern for extraction:" << compiled.strictRegex.pattern();
+    }
+    // 占位符格式优先使用专用匹配器，文本中含正则元字符时才退回正则表达式
+    compiled.lenientMatcher = buildMatcher(parsed, replacements, false);
+    compiled.strictMatcher = buildMatcher(parsed, replacements, true);
+    // 含元数据占位符时，已符合格式的文件按代入的文本归入各组
+    if(compiled.usesMetadata && parsed.hasNumberPlaceholder)
+    {
+        compiled.groupRegex.setPattern(buildGroupPattern(parsed, replacements));
+        runStats.add(RunStats::Counter::RegexCompiles);
+        if(compiled.groupRegex.isValid())
+        {
+            compiled.groupRegex.optimize();
+        }
+    }
+    // 预先代入普通占位符，只在编号占位符处切分
+    QString segment;
+    int last = 0;
+    for(const auto& ph : parsed.placeholders)
     {
-        if(matchesFormat(fileInfo.fileName(), parsed, replacements))
+        segment += parsed.rawFormat.mid(last, ph.position - last);
+        if(ph.type == PlaceholderType::Regular)
         {
-            // 提取数字部分
-            int number = extractNumber(fileInfo.fileName(), parsed, replacements);
-            if(number > maxNumber)
+            if(ph.index > 0 && ph.index <= replacements.size())
+            {
+                segment += replacements[ph.index - 1];
+            }
+            else
             {
-                maxNumber = number;
+                segment += "unknown";
             }
         }
+        else
+        {
+            compiled.segments.append(segment);
+            compiled.numberWidths.append(ph.index);
+            segment.clear();
+        }
+        last = ph.position + ph.length;
     }
-    return maxNumber;
+    segment += parsed.rawFormat.mid(last);
+    compiled.segments.append(segment);
+    return compiled;
 }
 
-bool BatchRenamer::matchesFormat(const QString& fileName, const ParsedFormat& parsed, const QVector<QString> &replacements)
+bool BatchRenamer::matchesFormat(QStringView baseName, const CompiledFormat& compiled)
 {
-    // 构建正则表达式模式
-    QString patternStr = buildRegexPattern(parsed, replacements, false);
-    QRegularExpression regex(patternStr);
-    if(!regex.isValid())
+    // 正则表达式模式下没有规则匹配的文件视为已符合格式
+    if(compiled.parsed.mode == RenameMode::RegularExpression)
+    {
+        return compiled.rules.isValid() && !compiled.rules.matches(baseName.toString());
+    }
+    if(compiled.lenientMatcher.isValid())
+    {
+        bool matched = compiled.lenientMatcher.matches(baseName);
+#ifdef RENAMER_VERIFY_MATCHER
+        // 与正则表达式的结果逐一对照
+        Q_ASSERT_X(matched == compiled.lenientRegex.match(baseName.toString()).hasMatch(), "matchesFormat",
+                   qPrintable(baseName.toString()));
+#endif
+        return matched;
+    }
+    if(!compiled.lenientRegex.isValid())
     {
-        qWarning() << "Invalid regex pattern:" << patternStr;
         return false;
     }
-    // 只匹配文件名（不含扩展名）
-    QFileInfo info(fileName);
-    QString baseName = info.completeBaseName(); // 包含所有点号的基本名称
-    QRegularExpressionMatch match = regex.match(baseName);
-    if(parsed.mode == RenameMode::RegularExpression)
-    { return !match.hasMatch(); }
-    return match.hasMatch();
+    // 只有无法用专用匹配器处理的格式才需要构造字符串
+    return compiled.lenientRegex.match(baseName.toString()).hasMatch();
+}
+
+int BatchRenamer::extractNumber(QStringView baseName, const CompiledFormat& compiled)
+{
+    if(compiled.strictMatcher.isValid())
+    {
+        int number = compiled.strictMatcher.extractNumber(baseName);
+#ifdef RENAMER_VERIFY_MATCHER
+        Q_ASSERT_X(number == extractNumberByRegex(baseName, compiled), "extractNumber", qPrintable(baseName.toString()));
+#endif
+        return number;
+    }
+    return extractNumberByRegex(baseName, compiled);
 }
 
-int BatchRenamer::extractNumber(const QString& fileName, const ParsedFormat& parsed, const QVector<QString> &replacements)
+int BatchRenamer::extractNumberByRegex(QStringView baseName, const CompiledFormat& compiled)
 {
-    // 构建正则表达式
-    QString patternStr = buildRegexPattern(parsed, replacements);
-    QRegularExpression regex(patternStr);
-    if(!regex.isValid())
+    if(!compiled.strictRegex.isValid())
     {
-        qWarning() << "Invalid regex pattern for extraction:" << patternStr;
         return -1;
     }
-    // 只匹配文件名（不含扩展名）
-    QFileInfo info(fileName);
-    QString baseName = info.completeBaseName();
-    QRegularExpressionMatch match = regex.match(baseName);
+    QRegularExpressionMatch match = compiled.strictRegex.match(baseName.toString());
     if(match.hasMatch())
     {
         // 查找数字捕获组
@@ -289,53 +1639,95 @@ int BatchRenamer::extractNumber(const QString& fileName, const ParsedFormat& par
     return -1;
 }
 
-QString BatchRenamer::generateFileName(const QString& oldName, const ParsedFormat& parsed,
-                                       const QVector<QString> &replacements, int number)
+QString BatchRenamer::generateTupleFileName(const QString& oldName, const CompiledFormat& compiled,
+                                            const MediaMetadata& metadata, TupleNumbering* numbering)
 {
-    if(parsed.mode == RenameMode::RegularExpression)
+    QVector<QString> values;
+    values.reserve(compiled.replacements.size());
+    for(const QString& replacement : compiled.replacements)
     {
-        QRegularExpression regex(parsed.rawFormat);
-        QFileInfo info(oldName);
-        QString result = info.baseName().replace(regex, replacements.front()) + '.' + info.suffix();
-        return result;
+        values.append(MetadataReader::expand(replacement, metadata));
     }
-    QString result = parsed.rawFormat;
-    // 从后向前替换，避免位置变化影响
-    for(int i = parsed.placeholders.size() - 1; i >= 0; i--)
+    QString key = QStringList(values.begin(), values.end()).join(QChar(0x1f));
+    auto it = numbering->formats.find(key);
+    if(it == numbering->formats.end())
     {
-        const auto& ph = parsed.placeholders[i];
-        QString replacement;
-        if(ph.type == PlaceholderType::Regular)
-        {
-            if(ph.index > 0 && ph.index <= replacements.size())
-            {
-                replacement = replacements[ph.index - 1];
-            }
-            else
-            {
-                replacement = "unknown";
-            }
-        }
-        else
+        // 新的一组：按代入后的占位符编译格式，最大编号已在记入已符合格式的文件时按组归并
+        it = numbering->formats.insert(key, compileFormat(compiled.parsed, values));
+    }
+    auto maxNumber = numbering->maxNumbers.find(key);
+    if(maxNumber == numbering->maxNumbers.end())
+    {
+        maxNumber = numbering->maxNumbers.insert(key, -1);
+    }
+    return generateFileName(oldName, it.value(), ++maxNumber.value());
+}
+
+void BatchRenamer::noteConforming(const QString& fileName, const CompiledFormat& compiled, TupleNumbering* numbering)
+{
+    if(!compiled.groupRegex.isValid() || compiled.groupRegex.pattern().isEmpty())
+    {
+        return;
+    }
+    QRegularExpressionMatch match = compiled.groupRegex.match(completeBaseNameOf(fileName).toString());
+    if(!match.hasMatch())
+    {
+        return;
+    }
+    // 键与generateTupleFileName()相同：不随文件变化的替换内容取其本身，其余取文件名中代入的文本
+    QStringList values;
+    values.reserve(compiled.replacements.size());
+    for(int i = 0; i < compiled.replacements.size(); i++)
+    {
+        const QString& replacement = compiled.replacements[i];
+        values.append(MetadataReader::hasTokens(replacement) ? match.captured(QString("v%1").arg(i + 1)) : replacement);
+    }
+    QString key = values.join(QChar(0x1f));
+    bool ok = false;
+    int number = match.captured("n").toInt(&ok);
+    if(!ok)
+    {
+        return;
+    }
+    auto it = numbering->maxNumbers.find(key);
+    if(it == numbering->maxNumbers.end())
+    {
+        numbering->maxNumbers.insert(key, number);
+    }
+    else
+        if(number > it.value())
         {
-            // 数字占位符，格式化为指定位数的数字
-            replacement = QString("%1").arg(number, ph.index, 10, QChar('0'));
+            it.value() = number;
         }
-        result.replace(ph.position, ph.length, replacement);
+}
+
+QString BatchRenamer::generateFileName(QStringView oldName, const CompiledFormat& compiled, int number)
+{
+    const ParsedFormat& parsed = compiled.parsed;
+    if(parsed.mode == RenameMode::RegularExpression)
+    {
+        return compiled.rules.apply(baseNameOf(oldName).toString()).append('.').append(suffixOf(oldName));
+    }
+    // 依次拼接固定片段和编号
+    QString result = compiled.segments.front();
+    for(int i = 0; i < compiled.numberWidths.size(); i++)
+    {
+        // 数字占位符，格式化为指定位数的数字
+        result += QString("%1").arg(number, compiled.numberWidths[i], 10, QChar('0'));
+        result += compiled.segments[i + 1];
     }
-    // 保留原文件扩展名
-    QFileInfo info(oldName);
+    // 保留原文件扩展名，各部分直接从原名称的视图追加
     switch(parsed.mode)
     {
         case RenameMode::Prepend:
-            result = result + "_" + oldName;
+            result.append('_').append(oldName);
             break;
         case RenameMode::Append:
-            result = info.baseName() + "_" + result + "." + info.suffix();
+            result = baseNameOf(oldName).toString().append('_').append(result).append('.').append(suffixOf(oldName));
             break;
         case RenameMode::Regular:
         case RenameMode::Strict:
-            result = result + "." + info.suffix();
+            result.append('.').append(suffixOf(oldName));
         default:
             break;
     }
@@ -11,11 +11,31 @@
  *****************************************************************************/
 
 #include <QDir>
+#include <QDirIterator>
 #include <QFileInfo>
+#include <QMap>
 #include <QRegularExpression>
 #include <QString>
 #include <QVector>
 #include <QDebug>
+#include <QAtomicInt>
+#include <deque>
+#include <functional>
+#include <memory>
+#include "directoryrenamer.h"
+#include "duplicatefinder.h"
+#include "extensionclassifier.h"
+#include "fileorder.h"
+#include "formatmatcher.h"
+#include "mediametadata.h"
+#include "numberingindex.h"
+#include "pipelinedrenamer.h"
+#include "regexrulelist.h"
+#include "renameplan.h"
+#include "renamejournal.h"
+#include "ruleset.h"
+#include "runstats.h"
+#include "storagebackend.h"
 
 namespace Extension
 {
@@ -30,18 +50,229 @@ namespace Extension
  */
 class BatchRenamer
 {
+    // 性能测试需要分阶段调用内部步骤
+    friend class RenameBenchmark;
+
 public:
+    /**
+     * @brief 进度信息
+     */
+    struct Progress
+    {
+        int scanned = 0;    // 目录中扫描到的文件数
+        int matched = 0;    // 通过扩展名筛选的文件数
+        int renamed = 0;    // 重命名成功的文件数
+        int failed = 0;     // 目标已存在或重命名失败的文件数
+    };
+
+    /**
+     * @brief 重复文件（与本批次中另一个待重命名文件内容相同）的处理方式
+     */
+    enum class DuplicateMode
+    {
+        Off,        // 不检查
+        Report,     // 照常编号，在计划条目中注明原件
+        Skip        // 不重命名、不占用编号
+    };
+
     BatchRenamer();
 
+    /**
+     * @brief 设置进度回调，回调在执行重命名的线程中调用
+     * @param callback          回调函数
+     */
+    void setProgressCallback(std::function<void(const Progress&)> callback);
+
+    /**
+     * @brief 设置是否按文件头识别扩展名错误或缺失的文件
+     * @param enabled           开启时，扩展名未通过过滤器的文件会再读取文件头判断
+     */
+    void setContentSniffing(bool enabled);
+
+    /**
+     * @brief 设置是否使用编号索引
+     * @param enabled           开启时，对同一目录以相同格式、占位符重复运行只分类新出现的文件，
+     *                          目录未变化时直接跳过扫描
+     */
+    void setNumberingIndex(bool enabled);
+
+    /**
+     * @brief 设置编号顺序
+     * @param key               待重命名文件按此依据排序后依次编号，默认按名称
+     */
+    void setNumberingOrder(FileOrder::Key key);
+
+    /**
+     * @brief 设置重命名的实现方式
+     * @param backend           默认在支持时通过目录句柄重命名，Portable始终使用QDir
+     */
+    void setRenameBackend(DirectoryRenamer::Backend backend);
+
+    /**
+     * @brief 设置同时在途的重命名数
+     *
+     * 大于1时不再逐个等待每次重命名：互不依赖的条目通过io_uring（不可用时为线程池）同时提交，
+     * 适合每次重命名都要等待往返的FUSE、SMB挂载。日志照常逐条记录，撤销和续做不受影响。
+     * @param depth             同时在途的重命名数，默认1（逐个执行）；使用QDir重命名时忽略
+     */
+    void setQueueDepth(int depth);
+
+    /**
+     * @brief 设置对文件分类的线程数
+     *
+     * 扫描结束后把待分类的文件分块，由多个线程同时匹配格式、提取编号，每个线程使用各自复制的
+     * 正则表达式和匹配器；结果按原顺序汇总，编号分配和重命名与单线程完全相同。
+     * @param threads           线程数，默认0（使用全部核心）；文件较少时始终在当前线程分类
+     */
+    void setMatchThreads(int threads);
+
+    /**
+     * @brief 设置重复文件的处理方式
+     * @param mode              处理方式，默认不检查
+     */
+    void setDuplicateMode(DuplicateMode mode);
+
+    /**
+     * @brief 设置远程存储
+     *
+     * 设置后目录为存储中的路径：列目录和重命名都通过存储后端进行。远程存储不读取文件内容，
+     * 不支持按文件头识别、元数据占位符、重复文件检查、编号索引、撤销、续做和监视；
+     * 按修改时间、大小或拍摄时间编号时退回按名称编号。
+     * @param backend           存储后端（不转移所有权，可被多个线程共用），为空时使用本地文件系统
+     */
+    void setStorage(StorageBackend* backend);
+
+    /**
+     * @brief 当前的远程存储，使用本地文件系统时为空
+     */
+    StorageBackend* storageBackend() const;
+
+    /**
+     * @brief 各阶段的计数和耗时，跨调用累加，需要时调用reset()清空
+     */
+    RunStats& stats();
+
+    /**
+     * @brief 复制另一个重命名对象的选项（不含进度回调）
+     * @param other             选项来源
+     */
+    void copySettings(const BatchRenamer& other);
+
+    /**
+     * @brief 请求取消当前批次，可从其他线程调用，在处理完当前文件后生效
+     */
+    void cancel();
+
+    /**
+     * @brief 清除取消请求，在排队新任务时调用；任务开始前的取消请求因此不会丢失
+     */
+    void resetCancel();
+
     /**
      * @brief 批量重命名函数
      * @param format            命名格式
      * @param replacements      占位符
      * @param directory         重命名目录
      * @param extensionFilter   扩展名过滤器（正则表达式）
+     * @param executed          非空时保存执行后的计划
      * @return 操作结果信息
      */
-    QString renameFiles(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter = ".*");
+    QString renameFiles(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter = ".*",
+                        RenamePlan* executed = nullptr);
+
+    /**
+     * @brief 按规则文件重命名整个目录树
+     * @param rulesPath         规则文件（JSON）路径
+     * @param root              根目录
+     * @return 操作结果信息
+     */
+    QString renameTree(const QString& rulesPath, const QString& root);
+
+    /**
+     * @brief 生成重命名计划（不修改文件），冲突在内存中检测
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param directory         重命名目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     * @param caseInsensitive   按不区分大小写的方式检测冲突（用于不区分大小写的云盘挂载）
+     * @param subdirectories    非空时在同一次枚举中收集子文件夹（不含隐藏文件夹和符号链接），
+     *                          此时目录中没有匹配的文件不算错误
+     * @return 重命名计划，失败时error非空
+     */
+    RenamePlan plan(const QString& format, const QVector<QString> &replacements, const QString& directory,
+                    const QString& extensionFilter = ".*", bool caseInsensitive = false,
+                    QStringList* subdirectories = nullptr);
+
+    /**
+     * @brief 按规则集为整个目录树生成重命名计划（不修改文件）
+     *
+     * 只递归枚举一次目录树，规则在枚举前编译；每个文件交给所在目录适用的第一条扩展名匹配的规则，
+     * 编号在同一目录、同一规则内连续。不跟随符号链接，跳过隐藏目录；不支持按文件头识别。
+     * @param rules             规则集
+     * @param root              根目录
+     * @param caseInsensitive   按不区分大小写的方式检测冲突
+     * @return 每个有待处理文件的目录一个计划，按目录路径排序；无法生成时只有一个error非空的计划
+     */
+    QVector<RenamePlan> planTree(const RuleSet& rules, const QString& root, bool caseInsensitive = false);
+
+    /**
+     * @brief 执行重命名计划
+     * @param plan              重命名计划，执行后更新各条目的状态
+     * @return 操作结果信息
+     */
+    QString apply(RenamePlan& plan);
+
+    /**
+     * @brief 按日志逆序撤销目录中最近一个批次
+     * @param directory         重命名目录
+     * @return 操作结果信息
+     */
+    QString undo(const QString& directory);
+
+    /**
+     * @brief 按日志续做目录中被中断的批次，不重新扫描和编号
+     * @param directory         重命名目录
+     * @return 操作结果信息
+     */
+    QString resume(const QString& directory);
+
+    /**
+     * @brief 开始增量重命名：先按计划重命名目录中已有的文件，之后保留编译后的格式、
+     *        编号计数器和已占用名称，供renameArrived逐批使用
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param directory         重命名目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     * @param caseInsensitive   按不区分大小写的方式检测冲突
+     * @param plan              初始批次的计划，无法开始时error非空
+     * @return 操作结果信息
+     */
+    QString startWatch(const QString& format, const QVector<QString> &replacements, const QString& directory,
+                       const QString& extensionFilter, bool caseInsensitive, RenamePlan* plan);
+
+    /**
+     * @brief 重命名新出现的文件，只分类给出的文件，编号从内存中的计数器继续
+     * @param fileNames         新出现（或被改写）的文件名
+     * @param plan              本批次的计划
+     * @return 操作结果信息
+     */
+    QString renameArrived(const QStringList& fileNames, RenamePlan* plan);
+
+    /**
+     * @brief 记录文件已被删除或移出目录，释放其名称
+     * @param fileNames         文件名
+     */
+    void forgetRemoved(const QStringList& fileNames);
+
+    /**
+     * @brief 结束增量重命名
+     */
+    void stopWatch();
+
+    /**
+     * @brief 是否处于增量重命名中
+     */
+    bool isWatching() const;
 
 private:
     /**
@@ -88,6 +319,129 @@ private:
         bool hasNumberPlaceholder = false;
     };
 
+    /**
+     * @brief 编译后的格式，每批次构建一次，逐文件复用
+     */
+    struct CompiledFormat
+    {
+        ParsedFormat parsed;
+        QVector<QString> replacements;
+        QRegularExpression lenientRegex;    // 宽松匹配，判断是否符合格式
+        QRegularExpression strictRegex;     // 严格匹配，提取编号
+        FormatMatcher lenientMatcher;       // 宽松匹配的专用匹配器，不可用时退回正则表达式
+        FormatMatcher strictMatcher;        // 严格匹配的专用匹配器，不可用时退回正则表达式
+        QVector<QString> segments;          // 编号占位符之间的固定片段（普通占位符已代入）
+        QVector<int> numberWidths;          // 各编号占位符的位数
+        bool usesMetadata = false;          // 占位符中含有元数据占位符，需按文件代入
+        RegexRuleList rules;                // 正则表达式模式的规则列表
+        QRegularExpression groupRegex;      // 含元数据占位符时从已符合格式的文件名中取出代入的文本和编号
+    };
+
+    /**
+     * @brief 单个文件的分类结果
+     */
+    struct FileMatch
+    {
+        bool conforming = false;    // 是否已符合格式
+        int number = -1;            // 符合格式时提取到的编号
+    };
+
+    /**
+     * @brief 目录扫描结果
+     */
+    struct ScanResult
+    {
+        QStringList candidates;     // 需要重命名的文件名（已排序）
+        int maxNumber = -1;         // 已符合格式的文件中的最大编号
+        bool cancelled = false;     // 扫描是否被取消
+        NameIndex occupied;         // 目录中已占用的全部名称（含隐藏文件和文件夹）
+        QHash<QString, int> conforming; // 符合格式的文件及其编号（仅在使用编号索引或元数据占位符时记录）
+        QString error;              // 无法列出目录时的错误信息
+    };
+
+    /**
+     * @brief 含元数据占位符时按代入后的占位符分组编号，与占位符不同的文件分别编号的规则一致
+     */
+    struct TupleNumbering
+    {
+        QHash<QString, CompiledFormat> formats;     // 各组编译后的格式，键为代入后的占位符
+        QHash<QString, int> maxNumbers;             // 各组已使用的最大编号，已符合格式的文件记入时即按组归并
+    };
+
+    /**
+     * @brief 增量重命名的常驻状态
+     */
+    struct WatchState
+    {
+        bool active = false;
+        QString directory;
+        CompiledFormat compiled;
+        ExtensionClassifier classifier;
+        NameIndex occupied;         // 目录中已占用的全部名称，随每批次更新
+        bool caseInsensitive = false;   // 名称按大小写折叠后比较
+        int maxNumber = -1;         // 已使用的最大编号
+        TupleNumbering tuples;      // 含元数据占位符时各组的编号
+    };
+
+    /**
+     * @brief 生成重命名计划
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param directory         重命名目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     * @param caseInsensitive   按不区分大小写的方式检测冲突
+     * @param watchState        非空时保存扫描和计划后的状态，用于增量重命名（此时目录中没有匹配的文件不算错误）
+     * @param subdirectories    非空时收集子文件夹（此时目录中没有匹配的文件不算错误）
+     * @return 重命名计划，失败时error非空
+     */
+    RenamePlan buildPlan(const QString& format, const QVector<QString> &replacements, const QString& directory,
+                         const QString& extensionFilter, bool caseInsensitive, WatchState* watchState,
+                         QStringList* subdirectories);
+
+    /**
+     * @brief 按编号顺序排序待重命名文件并生成新名称（尚未安排执行顺序、检测冲突）
+     * @param directory         目录
+     * @param compiled          编译后的格式
+     * @param candidates        待重命名文件，按编号顺序原地排序
+     * @param maxNumber         已使用的最大编号，随编号推进
+     * @param tuples            含元数据占位符时各组的编号
+     * @param duplicates        返回重复文件的原名称到原件原名称的映射
+     * @return 按编号顺序排列的条目
+     */
+    QVector<RenamePlan::Entry> generateMoves(const QString& directory, const CompiledFormat& compiled, QStringList* candidates,
+                                             int* maxNumber, TupleNumbering* tuples, QHash<QString, QString>* duplicates);
+
+    /**
+     * @brief 查找待重命名文件中的重复文件
+     * @param directory         目录
+     * @param candidates        按编号顺序排列的待重命名文件，靠前的视为原件
+     * @return 重复文件的原名称到原件原名称的映射，不检查时为空
+     */
+    QHash<QString, QString> findDuplicates(const QString& directory, const QStringList& candidates);
+
+    /**
+     * @brief 安排执行顺序并检测冲突，计入统计
+     * @param moves             待执行的重命名
+     * @param occupied          目录中已占用的名称，按执行后的状态更新
+     * @return 计划条目
+     */
+    QVector<RenamePlan::Entry> scheduleMoves(const QVector<RenamePlan::Entry>& moves, NameIndex* occupied);
+
+    /**
+     * @brief 在安排好的计划中注明重复文件，跳过时追加未参与编号的重复文件条目
+     * @param entries           安排好的计划条目
+     * @param candidates        按编号顺序排列的待重命名文件
+     * @param duplicates        重复文件的原名称到原件原名称的映射
+     */
+    void markDuplicates(QVector<RenamePlan::Entry>* entries, const QStringList& candidates,
+                        const QHash<QString, QString> &duplicates);
+
+    /**
+     * @brief 执行失败或未执行的条目仍使用原名称，同步到增量重命名的已占用名称中
+     * @param plan              已执行的计划
+     */
+    void restoreFailedNames(const RenamePlan& plan);
+
     /**
      * @brief 解析格式字符串
      * @param format            格式字符串
@@ -105,50 +459,193 @@ private:
     QString buildRegexPattern(const ParsedFormat& parsed, const QVector<QString> &replacements, bool strictMode = true);
 
     /**
-     * @brief 根据扩展名过滤文件
-     * @param file              文件列表
-     * @param extensionFilter   扩展名过滤器（正则表达式）
-     * @return 过滤后的文件列表
+     * @brief 构建分组用的正则表达式
+     *
+     * 与严格模式相同，但含元数据占位符的替换内容第一次出现处为命名捕获组v1、v2……（序号为替换内容的序号），
+     * 第一个数字占位符为命名捕获组n。
+     * @param parsed            解析后的命名格式
+     * @param replacements      占位符
+     * @return 正则表达式字符串
      */
-    QFileInfoList filterFilesByExtension(const QFileInfoList& files, const QString& extensionFilter);
+    QString buildGroupPattern(const ParsedFormat& parsed, const QVector<QString> &replacements);
 
     /**
-     * @brief 查找最大编号
-     * @param files             文件列表
-     * @param parsed            解析后的格式
+     * @brief 按重命名模式给正则表达式加上锚点
+     * @param pattern           正则表达式
+     * @param mode              重命名模式
+     * @return 加上锚点后的正则表达式
+     */
+    static QString anchorPattern(const QString& pattern, RenameMode mode);
+
+    /**
+     * @brief 构建专用匹配器
+     * @param parsed            解析后的命名格式
      * @param replacements      占位符
-     * @return 文件列表中符合格式的文件名的最大编号
+     * @param strictMode        严格模式，严格模式下准确匹配占位符
+     * @return 匹配器，格式中含正则元字符时返回的匹配器不可用
      */
-    int findMaxNumber(const QFileInfoList& files, const ParsedFormat& parsed, const QVector<QString> &replacements);
+    FormatMatcher buildMatcher(const ParsedFormat& parsed, const QVector<QString> &replacements, bool strictMode = true);
 
     /**
-     * @brief 检查文件名是否符合格式
-     * @param fileName          文件名
-     * @param parsed            解析后的格式
+     * @brief 编译格式
+     * @param parsed            解析后的命名格式
      * @param replacements      占位符
+     * @return 编译后的格式
+     */
+    CompiledFormat compileFormat(const ParsedFormat& parsed, const QVector<QString> &replacements);
+
+    /**
+     * @brief 检查文件扩展名是否通过过滤器
+     * @param fileName          文件名
+     * @param classifier        扩展名分类器
+     * @return 通过时返回true
+     */
+    bool matchesExtension(QStringView fileName, const ExtensionClassifier& classifier);
+
+    /**
+     * @brief 流式扫描目录，逐项筛选扩展名，枚举结束后分块并行分类，只保留需要重命名的文件
+     * @param directory         重命名目录
+     * @param classifier        扩展名分类器
+     * @param compiled          编译后的格式
+     * @param caseInsensitive   已占用名称是否按大小写折叠
+     * @param index             编号索引，为空时不使用
+     * @param subdirectories    非空时收集子文件夹（不含隐藏文件夹和符号链接）
+     * @return 扫描结果
+     */
+    ScanResult scanDirectory(const QString& directory, const ExtensionClassifier& classifier,
+                             const CompiledFormat& compiled, bool caseInsensitive, const NumberingIndex* index,
+                             QStringList* subdirectories);
+
+    /**
+     * @brief 对单个文件分类
+     * @param fileName          文件名
+     * @param compiled          编译后的格式
+     * @return 分类结果
+     */
+    FileMatch classifyFile(QStringView fileName, const CompiledFormat& compiled);
+
+    /**
+     * @brief 对名称表中的文件分类，直接使用表中预先算好的基本名位置
+     * @param files             名称表
+     * @param i                 文件在名称表中的序号
+     * @param compiled          编译后的格式
+     * @return 分类结果
+     */
+    FileMatch classifyFile(const FileTable& files, int i, const CompiledFormat& compiled);
+
+    /**
+     * @brief 并行对名称表中的全部文件分类
+     * @param files             名称表
+     * @param compiled          编译后的格式
+     * @return 与名称表一一对应的分类结果，被取消时未处理的部分为默认值
+     */
+    QVector<FileMatch> classifyFiles(const FileTable& files, const CompiledFormat& compiled);
+
+    /**
+     * @brief 把[0, count)分块，由当前线程和全局线程池中的空闲线程一起处理
+     *
+     * 块数不足两块或只用一个线程时在当前线程依次处理。每块之间检查取消请求，取消后其余的块不再处理。
+     * @param count             元素个数
+     * @param work              处理一块：参数为起止下标（不含止）
+     * @return 全部处理完时返回true，被取消时返回false
+     */
+    bool forEachChunk(int count, const std::function<void(int, int)>& work);
+
+    /**
+     * @brief 检查文件名是否符合格式
+     * @param baseName          文件名（不含扩展名）
+     * @param compiled          编译后的格式
      * @return 符合格式时返回true
      */
-    bool matchesFormat(const QString& fileName, const ParsedFormat& parsed, const QVector<QString> &replacements);
+    bool matchesFormat(QStringView baseName, const CompiledFormat& compiled);
 
     /**
      * @brief 提取编号
-     * @param fileName          文件名
-     * @param parsed            解析后的格式
-     * @param replacements      占位符
+     * @param baseName          文件名（不含扩展名）
+     * @param compiled          编译后的格式
+     * @return 符合格式的文件名中的编号
+     */
+    int extractNumber(QStringView baseName, const CompiledFormat& compiled);
+
+    /**
+     * @brief 用正则表达式提取编号
+     * @param baseName          文件名（不含扩展名）
+     * @param compiled          编译后的格式
      * @return 符合格式的文件名中的编号
      */
-    int extractNumber(const QString& fileName, const ParsedFormat& parsed, const QVector<QString> &replacements);
+    int extractNumberByRegex(QStringView baseName, const CompiledFormat& compiled);
 
     /**
      * @brief 生成新的文件名
      * @param oldName           旧文件名
-     * @param parsed            解析后的格式
-     * @param replacements      占位符
+     * @param compiled          编译后的格式
      * @param number            编号
      * @return 新文件名
      */
-    QString generateFileName(const QString& oldName, const ParsedFormat& parsed,
-                             const QVector<QString> &replacements, int number);
+    QString generateFileName(QStringView oldName, const CompiledFormat& compiled, int number);
+
+    /**
+     * @brief 代入文件的元数据后生成新的文件名，编号在代入后占位符相同的一组内连续
+     * @param oldName           旧文件名
+     * @param compiled          编译后的格式（占位符中含元数据占位符）
+     * @param metadata          文件的元数据
+     * @param numbering         各组的格式和编号
+     * @return 新文件名
+     */
+    QString generateTupleFileName(const QString& oldName, const CompiledFormat& compiled,
+                                  const MediaMetadata& metadata, TupleNumbering* numbering);
+
+    /**
+     * @brief 记入已符合格式的文件，推进其所属组的编号
+     *
+     * 组的键直接从文件名中代入元数据的位置取出，每个文件只匹配一次，与已出现的组数无关。
+     * @param fileName          文件名
+     * @param compiled          编译后的格式（占位符中含元数据占位符）
+     * @param numbering         各组的格式和编号
+     */
+    void noteConforming(const QString& fileName, const CompiledFormat& compiled, TupleNumbering* numbering);
+
+    /**
+     * @brief 执行重命名计划（不重置进度和取消请求），写入新日志
+     * @param plan              重命名计划
+     * @return 操作结果信息
+     */
+    QString executePlan(RenamePlan& plan);
+
+    /**
+     * @brief 通过远程存储执行计划
+     * @param plan              重命名计划，执行后更新各条目的状态
+     * @return 操作结果信息
+     */
+    QString executeRemote(RenamePlan& plan);
+
+    /**
+     * @brief 执行重命名计划并记录到日志
+     * @param plan              重命名计划
+     * @param journal           已打开的日志
+     * @param recovering        是否在续做中断的批次（需核对未落盘的记录）
+     * @return 操作结果信息
+     */
+    QString executePlan(RenamePlan& plan, RenameJournal& journal, bool recovering);
+
+    /**
+     * @brief 调用进度回调
+     */
+    void reportProgress();
+
+    std::function<void(const Progress&)> progressCallback;  // 进度回调
+    Progress progress;                                      // 当前批次的进度
+    RunStats runStats;                                      // 各阶段的计数和耗时
+    StorageBackend* storage = nullptr;                      // 远程存储，为空时使用本地文件系统
+    QAtomicInt cancelRequested;                             // 取消请求
+    bool contentSniffing = false;                           // 按文件头识别
+    bool numberingIndex = false;                            // 使用编号索引
+    FileOrder::Key numberingOrder = FileOrder::Key::Name;   // 编号顺序
+    DirectoryRenamer::Backend renameBackend = DirectoryRenamer::Backend::Auto;  // 重命名的实现方式
+    int queueDepth = 1;                                     // 同时在途的重命名数
+    int matchThreads = 0;                                   // 分类文件的线程数，0为核心数
+    DuplicateMode duplicateMode = DuplicateMode::Off;       // 重复文件的处理方式
+    WatchState watch;                                       // 增量重命名状态
 
 };
 
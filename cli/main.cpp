@@ -0,0 +1,519 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <memory>
+#include "batchrenamer.h"
+#include "formatpreset.h"
+#include "renamebenchmark.h"
+#include "renamewatcher.h"
+#include "storagebackend.h"
+#include "treerenamer.h"
+#ifdef RENAMER_SEAFILE
+#include "seafilestorage.h"
+#endif
+
+namespace
+{
+    /**
+     * @brief 以JSON Lines格式向标准输出逐行写入结果
+     */
+    class JsonLineWriter
+    {
+    public:
+        JsonLineWriter()
+        {
+            out.open(stdout, QIODevice::WriteOnly);
+        }
+
+        void write(const QJsonObject& object)
+        {
+            out.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+            out.write("\n");
+        }
+
+        void flush()
+        {
+            out.flush();
+        }
+
+    private:
+        QFile out;
+    };
+
+    QString statusName(RenamePlan::Status status)
+    {
+        switch(status)
+        {
+            case RenamePlan::Status::Pending:
+                return "planned";
+            case RenamePlan::Status::Conflict:
+                return "conflict";
+            case RenamePlan::Status::Renamed:
+                return "renamed";
+            case RenamePlan::Status::Failed:
+                return "failed";
+            case RenamePlan::Status::Duplicate:
+                return "duplicate";
+        }
+        return QString();
+    }
+
+    // 写出计划中的各条目和目录汇总，返回该目录是否成功
+    bool writePlan(JsonLineWriter& writer, const QString& directory, const RenamePlan& plan, const QString& result,
+                   const RunStats* stats = nullptr)
+    {
+        for(const RenamePlan::Entry& entry : plan.entries)
+        {
+            QJsonObject line;
+            line["type"] = "file";
+            line["directory"] = directory;
+            line["old"] = entry.oldName;
+            line["new"] = entry.newName;
+            line["status"] = statusName(entry.status);
+            if(!entry.duplicateOf.isEmpty())
+            {
+                line["duplicateOf"] = entry.duplicateOf;
+            }
+            if(entry.error != 0)
+            {
+                line["errno"] = entry.error;
+                line["error"] = DirectoryRenamer::errorString(entry.error);
+            }
+            writer.write(line);
+        }
+        int failed = plan.count(RenamePlan::Status::Failed);
+        bool ok = plan.error.isEmpty() && failed == 0;
+        QJsonObject summary;
+        summary["type"] = "directory";
+        summary["directory"] = directory;
+        summary["ok"] = ok;
+        summary["result"] = result;
+        summary["renamed"] = plan.count(RenamePlan::Status::Renamed);
+        summary["conflicts"] = plan.count(RenamePlan::Status::Conflict);
+        summary["failed"] = failed;
+        summary["duplicates"] = plan.count(RenamePlan::Status::Duplicate);
+        if(stats)
+        {
+            summary["stats"] = stats->toJson();
+        }
+        writer.write(summary);
+        writer.flush();
+        return ok;
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    // 与图形界面共用应用数据目录，两者的重命名日志可以互相撤销、续做
+    QCoreApplication::setApplicationName("CloudRenamer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch-rename files in one or more directories.\n"
+                                     "Results are written to stdout as JSON lines, one per file and one per directory.");
+    parser.addHelpOption();
+    QCommandLineOption presetOption({"p", "preset"}, "Start from the named preset (custom, activity, artwork).", "name");
+    QCommandLineOption formatOption({"f", "format"}, "Naming format, overrides the preset.", "format");
+    QCommandLineOption contentOption({"c", "content"}, "Naming content, overrides the preset.", "content");
+    QCommandLineOption typeOption({"t", "type"}, "Comma-separated file types: pic, vid, doc.", "types");
+    QCommandLineOption extensionOption({"e", "extension"}, "Custom extension filter (regular expression).", "regex");
+    QCommandLineOption dryRunOption({"n", "dry-run"}, "Only plan the renames, do not touch any file.");
+    QCommandLineOption sniffOption("sniff", "Also match files whose extension is wrong or missing by reading their header.");
+    QCommandLineOption indexOption("index", "Keep a numbering index per directory so that reruns only classify new files.");
+    QCommandLineOption orderOption("order", "Order in which new files are numbered: name (default), natural, mtime, size, capture.",
+                                   "key");
+    QCommandLineOption queueDepthOption("queue-depth", "Keep up to this many renames in flight (io_uring, or a thread "
+                                        "pool where unavailable) instead of one at a time; for FUSE/SMB mounts.", "count");
+    QCommandLineOption portableOption("portable-rename", "Rename through QDir instead of renameat2 on a directory handle.");
+    QCommandLineOption duplicatesOption("duplicates", "Find files with identical content among the files to rename: "
+                                        "report (number them but mark the copies) or skip (leave the copies alone).", "mode");
+    QCommandLineOption rulesOption("rules", "Rename each directory tree by the rules in the given JSON file "
+                                   "instead of a single format.", "file");
+    QCommandLineOption recursiveOption({"r", "recursive"}, "Also rename in every subfolder; each folder is numbered "
+                                       "separately and folders are processed in parallel.");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Number of folders processed at once with --recursive "
+                                  "(default: number of cores).", "count");
+    QCommandLineOption traceOption("trace", "Write a Chrome trace (chrome://tracing, Perfetto) of the renaming phases "
+                                   "to the given file.", "file");
+#ifdef RENAMER_SEAFILE
+    QCommandLineOption seafileOption("seafile", "Rename in a Seafile library through the web API at the given server URL "
+                                     "instead of the local file system; directories are paths inside the library.", "url");
+    QCommandLineOption repoOption("repo", "Seafile library ID, used with --seafile.", "id");
+    QCommandLineOption tokenOption("token", "Seafile API token (default: the SEAFILE_TOKEN environment variable).", "token");
+    QCommandLineOption concurrencyOption("concurrency", "Number of Seafile requests in flight per folder (default and maximum 6).", "count");
+    parser.addOptions({seafileOption, repoOption, tokenOption, concurrencyOption});
+#endif
+    QCommandLineOption caseOption("case-insensitive", "Detect name conflicts case-insensitively.");
+    QCommandLineOption undoOption("undo", "Undo the last batch in each directory.");
+    QCommandLineOption resumeOption("resume", "Resume the interrupted batch in each directory.");
+    QCommandLineOption watchOption("watch", "After renaming, keep watching each directory and rename files as they arrive.");
+    QCommandLineOption benchmarkOption("benchmark", "Time each renaming phase on generated temporary directories "
+                                       "of the given comma-separated sizes, e.g. 1000,100000,1000000.", "sizes");
+    parser.addOptions({presetOption, formatOption, contentOption, typeOption, extensionOption,
+                       dryRunOption, sniffOption, indexOption, orderOption, queueDepthOption, portableOption, duplicatesOption, rulesOption, recursiveOption, jobsOption, traceOption, caseOption, undoOption, resumeOption, watchOption, benchmarkOption});
+    parser.addPositionalArgument("directories", "Directories to rename in. Use - to read directories from stdin, one per line.",
+                                 "<directory>...");
+    parser.process(a);
+
+    JsonLineWriter writer;
+    // 性能测试模式
+    if(parser.isSet(benchmarkOption))
+    {
+        RenameBenchmark benchmark([&writer](const QJsonObject& result)
+        {
+            writer.write(result);
+            writer.flush();
+        });
+        for(const QString& size : parser.value(benchmarkOption).split(',', Qt::SkipEmptyParts))
+        {
+            bool ok;
+            int fileCount = size.trimmed().toInt(&ok);
+            if(!ok || fileCount <= 0 || !benchmark.run(fileCount))
+            {
+                qCritical().noquote() << "Benchmark failed for size:" << size;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // 先取预设，再由单独给出的参数覆盖
+    QString format;
+    QString content;
+    int type = 0;
+    QString customType;
+    if(parser.isSet(presetOption))
+    {
+        QString name = parser.value(presetOption);
+        int index = FormatPreset::indexOf(name);
+        if(index < 0)
+        {
+            qCritical().noquote() << "Unknown preset:" << name;
+            return 2;
+        }
+        format = preset[index].getFormat();
+        content = preset[index].getDefaultContent();
+        type = preset[index].getType();
+        customType = preset[index].getCustomType();
+    }
+    if(parser.isSet(formatOption))
+    { format = parser.value(formatOption); }
+    if(parser.isSet(contentOption))
+    { content = parser.value(contentOption); }
+    if(parser.isSet(typeOption) && !FormatPreset::parseTypes(parser.value(typeOption), &type))
+    {
+        qCritical().noquote() << "Unknown file type in:" << parser.value(typeOption);
+        return 2;
+    }
+    if(parser.isSet(extensionOption))
+    { customType = parser.value(extensionOption); }
+    FileOrder::Key order = FileOrder::Key::Name;
+    if(parser.isSet(orderOption) && !FileOrder::fromString(parser.value(orderOption), &order))
+    {
+        qCritical().noquote() << "Unknown numbering order:" << parser.value(orderOption);
+        return 2;
+    }
+    DirectoryRenamer::Backend backend = parser.isSet(portableOption) ? DirectoryRenamer::Backend::Portable
+                                                                     : DirectoryRenamer::Backend::Auto;
+    int queueDepth = 1;
+    if(parser.isSet(queueDepthOption))
+    {
+        bool ok;
+        queueDepth = parser.value(queueDepthOption).toInt(&ok);
+        if(!ok || queueDepth <= 0 || queueDepth > 4096)
+        {
+            qCritical().noquote() << "Invalid queue depth (1-4096):" << parser.value(queueDepthOption);
+            return 2;
+        }
+    }
+    BatchRenamer::DuplicateMode duplicateMode = BatchRenamer::DuplicateMode::Off;
+    if(parser.isSet(duplicatesOption))
+    {
+        QString mode = parser.value(duplicatesOption).trimmed().toLower();
+        if(mode == "report")
+        { duplicateMode = BatchRenamer::DuplicateMode::Report; }
+        else
+            if(mode == "skip")
+            { duplicateMode = BatchRenamer::DuplicateMode::Skip; }
+            else
+            {
+                qCritical().noquote() << "Unknown duplicate handling:" << parser.value(duplicatesOption);
+                return 2;
+            }
+    }
+    bool undo = parser.isSet(undoOption);
+    bool resume = parser.isSet(resumeOption);
+    bool useRules = parser.isSet(rulesOption);
+    if(format.isEmpty() && !undo && !resume && !useRules)
+    {
+        qCritical().noquote() << "No format given, use --preset, --format or --rules.";
+        return 2;
+    }
+    if(useRules && (undo || resume || parser.isSet(watchOption)))
+    {
+        qCritical().noquote() << "--rules cannot be combined with --undo, --resume or --watch.";
+        return 2;
+    }
+    bool recursive = parser.isSet(recursiveOption);
+    if(recursive && (undo || resume || useRules || parser.isSet(watchOption)))
+    {
+        qCritical().noquote() << "--recursive cannot be combined with --undo, --resume, --rules or --watch.";
+        return 2;
+    }
+    int jobs = 0;
+    if(parser.isSet(jobsOption))
+    {
+        bool ok;
+        jobs = parser.value(jobsOption).toInt(&ok);
+        if(!ok || jobs <= 0)
+        {
+            qCritical().noquote() << "Invalid job count:" << parser.value(jobsOption);
+            return 2;
+        }
+    }
+    // 远程资料库：目录和重命名都经过Web API
+    std::unique_ptr<StorageBackend> storage;
+#ifdef RENAMER_SEAFILE
+    if(parser.isSet(seafileOption))
+    {
+        if(undo || resume || useRules || parser.isSet(watchOption))
+        {
+            qCritical().noquote() << "--seafile cannot be combined with --undo, --resume, --rules or --watch.";
+            return 2;
+        }
+        SeafileStorage::Options options;
+        options.server = QUrl(parser.value(seafileOption));
+        options.repo = parser.value(repoOption);
+        options.token = parser.isSet(tokenOption) ? parser.value(tokenOption) : qEnvironmentVariable("SEAFILE_TOKEN");
+        if(!options.server.isValid() || options.server.scheme().isEmpty() || options.repo.isEmpty() || options.token.isEmpty())
+        {
+            qCritical().noquote() << "--seafile needs a server URL, --repo and --token (or SEAFILE_TOKEN).";
+            return 2;
+        }
+        if(parser.isSet(concurrencyOption))
+        {
+            bool ok;
+            options.concurrency = parser.value(concurrencyOption).toInt(&ok);
+            if(!ok || options.concurrency <= 0)
+            {
+                qCritical().noquote() << "Invalid concurrency:" << parser.value(concurrencyOption);
+                return 2;
+            }
+        }
+        storage.reset(new SeafileStorage(options));
+    }
+#endif
+    // 各目录的跟踪区间，全部处理完后一次写出
+    QJsonArray traceEvents;
+    auto addTrace = [&traceEvents](const RunStats& stats)
+    {
+        for(const QJsonValue& event : stats.traceEvents())
+        {
+            traceEvents.append(event);
+        }
+    };
+    auto writeTrace = [&parser, &traceOption, &traceEvents]()
+    {
+        QString error;
+        if(parser.isSet(traceOption) && !RunStats::writeTrace(parser.value(traceOption), traceEvents, &error))
+        {
+            qCritical().noquote() << error;
+            return false;
+        }
+        return true;
+    };
+    RuleSet rules;
+    QString rulesError;
+    if(useRules && !rules.load(parser.value(rulesOption), &rulesError))
+    {
+        qCritical().noquote() << rulesError;
+        return 2;
+    }
+
+    // 收集目录，“-”表示从标准输入逐行读取
+    QStringList directories;
+    for(const QString& argument : parser.positionalArguments())
+    {
+        if(argument != "-")
+        {
+            directories.append(argument);
+            continue;
+        }
+        QTextStream in(stdin);
+        QString line;
+        while(in.readLineInto(&line))
+        {
+            if(!line.trimmed().isEmpty())
+            { directories.append(line); }
+        }
+    }
+    if(directories.isEmpty())
+    {
+        parser.showHelp(2);
+    }
+
+    QVector<QString> replacements = FormatPreset::parseContent(content, format);
+    QString extensionFilter = FormatPreset::buildExtensionFilter(type, customType);
+    if(parser.isSet(watchOption) && (undo || resume || parser.isSet(dryRunOption)))
+    {
+        qCritical().noquote() << "--watch cannot be combined with --undo, --resume or --dry-run.";
+        return 2;
+    }
+
+    // 监视模式：每个目录先重命名已有文件，之后每处理一批新文件输出一次
+    if(parser.isSet(watchOption))
+    {
+        int watching = 0;
+        for(const QString& directory : directories)
+        {
+            RenameWatcher *watcher = new RenameWatcher(&a);
+            watcher->renamer().setContentSniffing(parser.isSet(sniffOption));
+            watcher->renamer().setNumberingIndex(parser.isSet(indexOption));
+            watcher->renamer().setNumberingOrder(order);
+            watcher->renamer().setRenameBackend(backend);
+            watcher->renamer().setQueueDepth(queueDepth);
+            watcher->renamer().setDuplicateMode(duplicateMode);
+            QObject::connect(watcher, &RenameWatcher::batchFinished, &a,
+                             [&writer, directory, watcher](const RenamePlan& plan, const QString& feedback)
+            {
+                writePlan(writer, directory, plan, feedback, &watcher->renamer().stats());
+            });
+            QObject::connect(watcher, &RenameWatcher::stopped, &a, [&writer, &watching, directory](const QString& reason)
+            {
+                RenamePlan stoppedPlan;
+                stoppedPlan.error = reason;
+                writePlan(writer, directory, stoppedPlan, reason);
+                // 所有目录都停止监视后退出
+                if(--watching == 0)
+                {
+                    QCoreApplication::exit(1);
+                }
+            });
+            RenamePlan plan;
+            QString result = watcher->start(format, replacements, directory, extensionFilter, parser.isSet(caseOption));
+            if(!watcher->isActive())
+            {
+                plan.error = result;
+            }
+            writePlan(writer, directory, plan, result);
+            if(watcher->isActive())
+            {
+                watching++;
+            }
+        }
+        if(watching == 0)
+        {
+            return 1;
+        }
+        return a.exec();
+    }
+
+    // 递归模式：各文件夹并行处理，处理完一个输出一组结果（顺序不固定）
+    if(recursive)
+    {
+        TreeRenamer tree;
+        tree.renamer().setContentSniffing(parser.isSet(sniffOption));
+        tree.renamer().setNumberingIndex(parser.isSet(indexOption));
+        tree.renamer().setNumberingOrder(order);
+        tree.renamer().setRenameBackend(backend);
+        tree.renamer().setQueueDepth(queueDepth);
+        tree.renamer().setDuplicateMode(duplicateMode);
+        tree.renamer().setStorage(storage.get());
+        tree.setMaxThreads(jobs);
+        tree.setDryRun(parser.isSet(dryRunOption));
+        tree.setResultCallback([&writer](const TreeRenamer::DirectoryResult& result)
+        {
+            writePlan(writer, result.directory, result.plan, result.feedback);
+        });
+        int exitCode = 0;
+        for(const QString& directory : directories)
+        {
+            TreeRenamer::Summary summary = tree.run(format, replacements, directory, extensionFilter, parser.isSet(caseOption));
+            QJsonObject line;
+            line["type"] = "tree";
+            line["directory"] = directory;
+            line["ok"] = summary.failedDirectories == 0;
+            line["result"] = tree.describe(summary);
+            line["folders"] = summary.directories;
+            line["changedFolders"] = summary.changed;
+            line["failedFolders"] = summary.failedDirectories;
+            line["scanned"] = summary.progress.scanned;
+            line["matched"] = summary.progress.matched;
+            line["renamed"] = summary.progress.renamed;
+            line["failed"] = summary.progress.failed;
+            line["stats"] = summary.stats.toJson();
+            addTrace(summary.stats);
+            writer.write(line);
+            writer.flush();
+            if(summary.failedDirectories > 0)
+            {
+                exitCode = 1;
+            }
+        }
+        return writeTrace() ? exitCode : 1;
+    }
+
+    BatchRenamer renamer;
+    renamer.setContentSniffing(parser.isSet(sniffOption));
+    renamer.setNumberingIndex(parser.isSet(indexOption));
+    renamer.setNumberingOrder(order);
+    renamer.setRenameBackend(backend);
+    renamer.setQueueDepth(queueDepth);
+    renamer.setDuplicateMode(duplicateMode);
+    renamer.setStorage(storage.get());
+    int exitCode = 0;
+    for(const QString& directory : directories)
+    {
+        if(undo || resume)
+        {
+            QJsonObject summary;
+            summary["type"] = "directory";
+            summary["directory"] = directory;
+            summary["result"] = undo ? renamer.undo(directory) : renamer.resume(directory);
+            writer.write(summary);
+            writer.flush();
+            continue;
+        }
+        renamer.stats().reset();
+        // 规则模式：整个目录树一次枚举，每个有待处理文件的子目录输出一组结果
+        if(useRules)
+        {
+            for(RenamePlan& plan : renamer.planTree(rules, directory, parser.isSet(caseOption)))
+            {
+                QString result = plan.error;
+                if(plan.error.isEmpty())
+                {
+                    if(parser.isSet(dryRunOption))
+                    { result = "Planned " + QString::number(plan.count(RenamePlan::Status::Pending)) + " rename(s)."; }
+                    else
+                    { result = renamer.apply(plan); }
+                }
+                if(!writePlan(writer, plan.directory.isEmpty() ? directory : plan.directory, plan, result))
+                {
+                    exitCode = 1;
+                }
+            }
+            addTrace(renamer.stats());
+            continue;
+        }
+        RenamePlan plan = renamer.plan(format, replacements, directory, extensionFilter, parser.isSet(caseOption));
+        QString result = plan.error;
+        if(plan.error.isEmpty())
+        {
+            if(parser.isSet(dryRunOption))
+            { result = "Planned " + QString::number(plan.count(RenamePlan::Status::Pending)) + " rename(s)."; }
+            else
+            { result = renamer.apply(plan); }
+        }
+        if(!writePlan(writer, directory, plan, result, &renamer.stats()))
+        {
+            exitCode = 1;
+        }
+        addTrace(renamer.stats());
+    }
+    return writeTrace() ? exitCode : 1;
+}
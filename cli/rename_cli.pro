@@ -0,0 +1,69 @@
+QT       = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = rename_cli
+
+# The renaming core is shared with the GUI and only depends on QtCore.
+INCLUDEPATH += ..
+
+SOURCES += \
+    ../batchrenamer.cpp \
+    ../directoryrenamer.cpp \
+    ../duplicatefinder.cpp \
+    ../extensionclassifier.cpp \
+    ../fileorder.cpp \
+    ../filetable.cpp \
+    ../formatmatcher.cpp \
+    ../formatpreset.cpp \
+    ../mediametadata.cpp \
+    ../numberingindex.cpp \
+    ../pipelinedrenamer.cpp \
+    ../regexrulelist.cpp \
+    ../renamejournal.cpp \
+    ../renameplan.cpp \
+    ../renamewatcher.cpp \
+    ../ruleset.cpp \
+    ../runstats.cpp \
+    ../treerenamer.cpp \
+    main.cpp \
+    renamebenchmark.cpp
+
+HEADERS += \
+    ../batchrenamer.h \
+    ../directoryrenamer.h \
+    ../duplicatefinder.h \
+    ../extensionclassifier.h \
+    ../fileorder.h \
+    ../filetable.h \
+    ../formatmatcher.h \
+    ../formatpreset.h \
+    ../mediametadata.h \
+    ../numberingindex.h \
+    ../pipelinedrenamer.h \
+    ../regexrulelist.h \
+    ../renamejournal.h \
+    ../renameplan.h \
+    ../renamewatcher.h \
+    ../ruleset.h \
+    ../runstats.h \
+    ../storagebackend.h \
+    ../treerenamer.h \
+    renamebenchmark.h
+
+# Seafile web API backend (--seafile), which needs QtNetwork: qmake CONFIG+=seafile
+seafile {
+    QT += network
+    DEFINES += RENAMER_SEAFILE
+    SOURCES += ../seafilestorage.cpp
+    HEADERS += ../seafilestorage.h
+}
+
+# Peak memory for the benchmark report.
+win32: LIBS += -lpsapi
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,370 @@
+#include "renamebenchmark.h"
+#include "batchrenamer.h"
+#include "formatpreset.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    // 使用activity预设的格式
+    const QString benchFormat = "\\1_\\2_\\d3";
+    const QVector<QString> benchReplacements = {"0929", "张三"};
+
+    // 格式解析的重复次数
+    const int parseIterations = 10000;
+
+    // 模拟高延迟挂载时每次重命名的延迟（微秒）、参与的文件数和队列深度
+    const int mountLatency = 2000;
+    const int latencyFiles = 1000;
+    const int latencyDepth = 32;
+
+    // 去掉最后一个点号及之后的部分
+    QString completeBaseName(const QString& fileName)
+    {
+        int dot = fileName.lastIndexOf('.');
+        return dot < 0 ? fileName : fileName.left(dot);
+    }
+} // namespace
+
+RenameBenchmark::RenameBenchmark(std::function<void(const QJsonObject&)> report)
+    : report(std::move(report))
+{}
+
+QStringList RenameBenchmark::generateNames(int fileCount)
+{
+    QRandomGenerator random(20251007);
+    QStringList extensions = Extension::Pic.split('|') + Extension::Vid.split('|') + Extension::Doc.split('|');
+    extensions << "JPG" << "MP4" << "heic" << "tmp" << "zip" << "";
+    const QStringList people = {"张三", "李四", "王五"};
+    QStringList names;
+    names.reserve(fileCount);
+    for(int i = 0; i < fileCount; i++)
+    {
+        // 每个文件名都带序号，保证互不相同
+        QString base;
+        switch(random.bounded(5))
+        {
+            case 0:     // 已符合格式，占位符相同
+                base = QString("0929_张三_%1_%2").arg(i % 1000, 3, 10, QChar('0')).arg(i);
+                break;
+            case 1:     // 已符合格式，占位符不同
+                base = QString("1001_%1_%2_%3").arg(people[random.bounded(int(people.size()))])
+                       .arg(i % 1000, 3, 10, QChar('0')).arg(i);
+                break;
+            case 2:     // 相机导出
+                base = QString("IMG_%1").arg(i, 8, 10, QChar('0'));
+                break;
+            case 3:     // 聊天软件导出
+                base = QString("微信图片_2025%1").arg(i, 10, 10, QChar('0'));
+                break;
+            default:    // 手动复制
+                base = QString("活动合影 副本 (%1)").arg(i);
+                break;
+        }
+        QString extension = extensions[random.bounded(int(extensions.size()))];
+        names.append(extension.isEmpty() ? base : base + "." + extension);
+    }
+    return names;
+}
+
+bool RenameBenchmark::run(int fileCount)
+{
+    this->fileCount = fileCount;
+    QTemporaryDir temp;
+    if(!temp.isValid())
+    {
+        qWarning() << "Failed to create a temporary directory:" << temp.errorString();
+        return false;
+    }
+    QElapsedTimer timer;
+    // 生成测试目录
+    timer.start();
+    QStringList names = generateNames(fileCount);
+    for(const QString& name : names)
+    {
+        QFile file(temp.filePath(name));
+        if(!file.open(QIODevice::WriteOnly))
+        {
+            qWarning() << "Failed to create fixture file:" << file.fileName();
+            return false;
+        }
+    }
+    reportPhase("createFixture", names.size(), timer.nsecsElapsed());
+
+    BatchRenamer renamer;
+    // 解析格式
+    timer.restart();
+    int placeholderCount = 0;
+    for(int i = 0; i < parseIterations; i++)
+    {
+        placeholderCount += renamer.parseFormat(benchFormat).placeholders.size();
+    }
+    reportPhase("parseFormat", parseIterations, timer.nsecsElapsed(), {{"placeholders", placeholderCount / parseIterations}});
+    BatchRenamer::ParsedFormat parsed = renamer.parseFormat(benchFormat);
+    BatchRenamer::CompiledFormat compiled = renamer.compileFormat(parsed, benchReplacements);
+    QString extensionFilter = FormatPreset::buildExtensionFilter(TYPE_PIC | TYPE_VID, "");
+    ExtensionClassifier classifier(extensionFilter);
+
+    // 扩展名过滤
+    timer.restart();
+    QStringList filtered;
+    for(const QString& name : names)
+    {
+        if(renamer.matchesExtension(name, classifier))
+        {
+            filtered.append(name);
+        }
+    }
+    reportPhase("filterFilesByExtension", names.size(), timer.nsecsElapsed(), {{"matched", filtered.size()}});
+
+    // 已占用名称集合：名称连续存放在名称表中，报告其占用的内存
+    timer.restart();
+    NameIndex occupied;
+    for(const QString& name : names)
+    {
+        occupied.insert(name);
+    }
+    reportPhase("nameIndex", names.size(), timer.nsecsElapsed(), {{"bytes", occupied.memoryUsage()}});
+    QStringList baseNames;
+    baseNames.reserve(filtered.size());
+    for(const QString& name : filtered)
+    {
+        baseNames.append(completeBaseName(name));
+    }
+
+    // 格式匹配：专用匹配器与正则表达式分别计时
+    timer.restart();
+    int conforming = 0;
+    for(const QString& baseName : baseNames)
+    {
+        conforming += renamer.matchesFormat(baseName, compiled) ? 1 : 0;
+    }
+    reportPhase("matchesFormat", baseNames.size(), timer.nsecsElapsed(), {{"conforming", conforming}});
+    timer.restart();
+    int regexConforming = 0;
+    for(const QString& baseName : baseNames)
+    {
+        regexConforming += compiled.lenientRegex.match(baseName).hasMatch() ? 1 : 0;
+    }
+    reportPhase("matchesFormatRegex", baseNames.size(), timer.nsecsElapsed(), {{"conforming", regexConforming}});
+
+    // 专用匹配器与正则表达式逐一对照
+    timer.restart();
+    int mismatches = 0;
+    for(const QString& baseName : baseNames)
+    {
+        bool matched = compiled.lenientRegex.match(baseName).hasMatch();
+        if(matched != renamer.matchesFormat(baseName, compiled)
+           || (matched && renamer.extractNumber(baseName, compiled) != renamer.extractNumberByRegex(baseName, compiled)))
+        {
+            qWarning() << "Matcher differs from regex on:" << baseName;
+            mismatches++;
+        }
+    }
+    reportPhase("matcherDifferential", baseNames.size(), timer.nsecsElapsed(), {{"mismatches", mismatches}});
+
+    // 查找最大编号（逐个分类后取最大值）
+    timer.restart();
+    int maxNumber = -1;
+    QStringList candidates;
+    for(const QString& name : filtered)
+    {
+        BatchRenamer::FileMatch match = renamer.classifyFile(name, compiled);
+        if(!match.conforming)
+        {
+            candidates.append(name);
+        }
+        else
+            if(match.number > maxNumber)
+            {
+                maxNumber = match.number;
+            }
+    }
+    reportPhase("findMaxNumber", filtered.size(), timer.nsecsElapsed(), {{"maxNumber", maxNumber}});
+
+    // 同样的分类分块并行进行，结果须与逐个分类相同
+    FileTable filteredTable;
+    for(const QString& name : filtered)
+    {
+        filteredTable.append(name);
+    }
+    timer.restart();
+    QVector<BatchRenamer::FileMatch> matches = renamer.classifyFiles(filteredTable, compiled);
+    int parallelMaxNumber = -1;
+    int parallelCandidates = 0;
+    for(const BatchRenamer::FileMatch& match : std::as_const(matches))
+    {
+        if(!match.conforming)
+        {
+            parallelCandidates++;
+        }
+        else
+            if(match.number > parallelMaxNumber)
+            {
+                parallelMaxNumber = match.number;
+            }
+    }
+    reportPhase("findMaxNumberParallel", filtered.size(), timer.nsecsElapsed(),
+                {{"maxNumber", parallelMaxNumber},
+                 {"identical", parallelMaxNumber == maxNumber && parallelCandidates == candidates.size()}});
+
+    // 生成新文件名
+    timer.restart();
+    qint64 nameLength = 0;
+    int number = maxNumber;
+    for(const QString& name : candidates)
+    {
+        nameLength += renamer.generateFileName(name, compiled, ++number).size();
+    }
+    reportPhase("generateFileName", candidates.size(), timer.nsecsElapsed(), {{"nameChars", nameLength}});
+
+    // 端到端重命名
+    timer.restart();
+    QString result = renamer.renameFiles(benchFormat, benchReplacements, temp.path(), extensionFilter);
+    reportPhase("renameFiles", names.size(), timer.nsecsElapsed(), {{"result", result}});
+
+    // 重命名后端：同一批文件先用QDir改名，再用目录句柄改回，比较耗时和每个文件的调用数
+    QDir backendDir(temp.path());
+    if(!backendDir.mkdir("backend"))
+    {
+        qWarning() << "Failed to create fixture directory:" << backendDir.filePath("backend");
+        return false;
+    }
+    backendDir.cd("backend");
+    for(int i = 0; i < fileCount; i++)
+    {
+        QFile file(backendDir.filePath(QString("a%1").arg(i)));
+        if(!file.open(QIODevice::WriteOnly))
+        {
+            qWarning() << "Failed to create fixture file:" << file.fileName();
+            return false;
+        }
+    }
+    const struct
+    {
+        const char* phase;
+        DirectoryRenamer::Backend backend;
+        const char* from;
+        const char* to;
+    } backendRuns[] = {{"applyPortable", DirectoryRenamer::Backend::Portable, "a%1", "b%1"},
+                       {"applyDirectoryHandle", DirectoryRenamer::Backend::Auto, "b%1", "a%1"}};
+    for(const auto& backendRun : backendRuns)
+    {
+        timer.restart();
+        DirectoryRenamer directoryRenamer(backendDir.path(), backendRun.backend);
+        int failures = 0;
+        for(int i = 0; i < fileCount; i++)
+        {
+            if(directoryRenamer.rename(QString(backendRun.from).arg(i), QString(backendRun.to).arg(i)) != 0)
+            {
+                failures++;
+            }
+        }
+        reportPhase(backendRun.phase, fileCount, timer.nsecsElapsed(),
+                    {{"failed", failures}, {"directoryHandle", directoryRenamer.usesDirectoryHandle()},
+                     {"callsPerFile", double(directoryRenamer.callCount()) / fileCount}});
+    }
+
+    // 模拟高延迟挂载：每次重命名前注入固定延迟，比较逐个执行与io_uring、线程池并发提交的吞吐量
+    const int latencyCount = qMin(fileCount, latencyFiles);
+    const struct
+    {
+        const char* phase;
+        PipelinedRenamer::Engine engine;
+        int depth;
+        const char* from;
+        const char* to;
+    } latencyRuns[] = {{"applyLatencySerial", PipelinedRenamer::Engine::Serial, 1, "a%1", "b%1"},
+                       {"applyLatencyThreads", PipelinedRenamer::Engine::Threads, latencyDepth, "b%1", "a%1"},
+                       {"applyLatencyIoUring", PipelinedRenamer::Engine::IoUring, latencyDepth, "a%1", "b%1"}};
+    for(const auto& latencyRun : latencyRuns)
+    {
+        timer.restart();
+        PipelinedRenamer pipeline(backendDir.path(), latencyRun.depth, latencyRun.engine);
+        pipeline.setLatency(mountLatency);
+        int failures = 0;
+        auto collect = [&failures](int, int error)
+        {
+            if(error != 0)
+            {
+                failures++;
+            }
+        };
+        for(int i = 0; i < latencyCount; i++)
+        {
+            if(pipeline.pending() >= pipeline.depth())
+            {
+                pipeline.reap(collect);
+            }
+            pipeline.submit(i, QString(latencyRun.from).arg(i), QString(latencyRun.to).arg(i));
+        }
+        while(pipeline.pending() > 0)
+        {
+            pipeline.reap(collect);
+        }
+        reportPhase(latencyRun.phase, latencyCount, timer.nsecsElapsed(),
+                    {{"failed", failures}, {"engine", PipelinedRenamer::engineName(pipeline.engine())},
+                     {"depth", pipeline.depth()}, {"latencyUs", mountLatency},
+                     {"callsPerFile", double(pipeline.callCount()) / latencyCount}});
+    }
+
+    // 使用编号索引重新计划：第一次分类全部文件并写入索引，第二次只查索引
+    renamer.setNumberingIndex(true);
+    timer.restart();
+    RenamePlan coldPlan = renamer.plan(benchFormat, benchReplacements, temp.path(), extensionFilter);
+    reportPhase("indexedPlanCold", names.size(), timer.nsecsElapsed(), {{"entries", int(coldPlan.entries.size())}});
+    timer.restart();
+    RenamePlan warmPlan = renamer.plan(benchFormat, benchReplacements, temp.path(), extensionFilter);
+    reportPhase("indexedPlanWarm", names.size(), timer.nsecsElapsed(), {{"entries", int(warmPlan.entries.size())}});
+    // 临时目录的日志和索引没有保留的必要
+    QFile::remove(RenameJournal::journalPath(temp.path()));
+    QFile::remove(NumberingIndex::indexPath(temp.path(),
+                                            NumberingIndex::makeKey(benchFormat, benchReplacements, extensionFilter, false)));
+    return true;
+}
+
+void RenameBenchmark::reportPhase(const QString& phase, int items, qint64 nsecs, const QJsonObject& extra)
+{
+    QJsonObject object = extra;
+    object["type"] = "benchmark";
+    object["files"] = fileCount;
+    object["phase"] = phase;
+    object["items"] = items;
+    object["ms"] = double(nsecs) / 1e6;
+    object["itemsPerSec"] = nsecs > 0 ? double(items) * 1e9 / double(nsecs) : 0.0;
+    object["peakRssBytes"] = peakRss();
+    report(object);
+}
+
+qint64 RenameBenchmark::peakRss()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return qint64(counters.PeakWorkingSetSize);
+    }
+    return -1;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return -1;
+    }
+#ifdef Q_OS_MACOS
+    return qint64(usage.ru_maxrss);         // macOS以字节为单位
+#else
+    return qint64(usage.ru_maxrss) * 1024;  // Linux以KB为单位
+#endif
+#endif
+}
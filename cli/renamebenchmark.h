@@ -0,0 +1,66 @@
+#ifndef RENAMEBENCHMARK_H
+#define RENAMEBENCHMARK_H
+
+/******************************************************************************
+ * @file       renamebenchmark.h
+ * @brief      在合成的大目录上分阶段测量BatchRenamer的性能
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QJsonObject>
+#include <QStringList>
+#include <functional>
+
+/**
+ * @brief 性能测试
+ *
+ * 在临时目录中生成指定数量的文件（混合图片、视频、文档和其他扩展名，混合已符合格式、
+ * 未符合格式和中文文件名），分别测量各阶段的耗时和每秒处理文件数，并报告峰值内存。
+ */
+class RenameBenchmark
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param report            每得到一项结果调用一次
+     */
+    explicit RenameBenchmark(std::function<void(const QJsonObject&)> report);
+
+    /**
+     * @brief 在指定规模的目录上运行全部测量
+     * @param fileCount         文件数
+     * @return 测试目录创建成功时返回true
+     */
+    bool run(int fileCount);
+
+    /**
+     * @brief 生成测试用文件名
+     * @param fileCount         文件数
+     * @return 文件名列表（固定随机种子，结果可复现）
+     */
+    static QStringList generateNames(int fileCount);
+
+private:
+    /**
+     * @brief 报告一个阶段的结果
+     * @param phase             阶段名
+     * @param items             处理的项目数
+     * @param nsecs             耗时（纳秒）
+     * @param extra             附加字段
+     */
+    void reportPhase(const QString& phase, int items, qint64 nsecs, const QJsonObject& extra = QJsonObject());
+
+    /**
+     * @brief 获取进程的峰值常驻内存
+     * @return 字节数，不支持时返回-1
+     */
+    static qint64 peakRss();
+
+    std::function<void(const QJsonObject&)> report;
+    int fileCount = 0;
+};
+
+#endif // RENAMEBENCHMARK_H
@@ -0,0 +1,124 @@
+#include "directoryrenamer.h"
+
+#include <QDebug>
+#include <QFile>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+DirectoryRenamer::DirectoryRenamer(const QString& directory, Backend backend)
+    : dir(directory)
+{
+#ifdef Q_OS_LINUX
+    if(backend == Backend::Auto)
+    {
+        dirfd = ::open(QFile::encodeName(dir.absolutePath()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        calls++;
+        if(dirfd < 0)
+        {
+            qWarning() << "Failed to open directory, falling back to QDir:" << directory << std::strerror(errno);
+        }
+    }
+#else
+    Q_UNUSED(backend);
+#endif
+}
+
+DirectoryRenamer::~DirectoryRenamer()
+{
+#ifdef Q_OS_LINUX
+    if(dirfd >= 0)
+    {
+        ::close(dirfd);
+    }
+#endif
+}
+
+int DirectoryRenamer::rename(const QString& oldName, const QString& newName)
+{
+#ifdef Q_OS_LINUX
+    if(dirfd >= 0)
+    {
+        QByteArray from = QFile::encodeName(oldName);
+        QByteArray to = QFile::encodeName(newName);
+        if(noReplace)
+        {
+            calls++;
+            if(::renameat2(dirfd, from.constData(), dirfd, to.constData(), RENAME_NOREPLACE) == 0)
+            {
+                return 0;
+            }
+            int error = errno;
+            if(error != EINVAL && error != ENOSYS)
+            {
+                return error;
+            }
+            // 内核或文件系统不支持RENAME_NOREPLACE，本目录之后都不再尝试
+            qWarning() << "RENAME_NOREPLACE is not supported, checking targets separately:" << dir.absolutePath();
+            noReplace = false;
+        }
+        struct stat st;
+        calls++;
+        if(::fstatat(dirfd, to.constData(), &st, AT_SYMLINK_NOFOLLOW) == 0)
+        {
+            return EEXIST;
+        }
+        calls++;
+        if(::renameat(dirfd, from.constData(), dirfd, to.constData()) == 0)
+        {
+            return 0;
+        }
+        return errno;
+    }
+#endif
+    // QDir::rename同样不覆盖已有文件，但不报告原因，先检查一次以区分目标已存在
+    calls++;
+    if(QFile::exists(dir.filePath(newName)))
+    {
+        return EEXIST;
+    }
+    calls++;
+    return dir.rename(oldName, newName) ? 0 : -1;
+}
+
+bool DirectoryRenamer::exists(const QString& name)
+{
+    calls++;
+#ifdef Q_OS_LINUX
+    if(dirfd >= 0)
+    {
+        struct stat st;
+        return ::fstatat(dirfd, QFile::encodeName(name).constData(), &st, AT_SYMLINK_NOFOLLOW) == 0;
+    }
+#endif
+    return dir.exists(name);
+}
+
+bool DirectoryRenamer::usesDirectoryHandle() const
+{
+    return dirfd >= 0;
+}
+
+qint64 DirectoryRenamer::callCount() const
+{
+    return calls;
+}
+
+QString DirectoryRenamer::errorString(int error)
+{
+    if(error == 0)
+    {
+        return QString();
+    }
+    if(error < 0)
+    {
+        return "Unknown error";
+    }
+    return QString::fromLocal8Bit(std::strerror(error));
+}
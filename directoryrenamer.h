@@ -0,0 +1,86 @@
+#ifndef DIRECTORYRENAMER_H
+#define DIRECTORYRENAMER_H
+
+/******************************************************************************
+ * @file       directoryrenamer.h
+ * @brief      在单个目录内重命名文件的底层实现
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QDir>
+#include <QString>
+
+/**
+ * @brief 目录内重命名
+ *
+ * Linux下只打开一次目录，之后每个文件调用一次renameat2(dirfd, 旧名, dirfd, 新名, RENAME_NOREPLACE)：
+ * 名称相对目录句柄解析，目标已存在时由内核原子地拒绝（EEXIST），不再需要单独检查，也没有检查与重命名之间的空档。
+ * 文件系统不支持RENAME_NOREPLACE时（部分FUSE、SMB挂载返回EINVAL）退回fstatat加renameat；
+ * 其他平台或目录无法打开时退回QDir。
+ */
+class DirectoryRenamer
+{
+public:
+    /**
+     * @brief 实现方式
+     */
+    enum class Backend
+    {
+        Auto,       // 能用目录句柄时使用，否则退回QDir
+        Portable    // 始终使用QDir（先检查目标是否存在，再重命名）
+    };
+
+    /**
+     * @brief 构造函数，打开目录
+     * @param directory         目录
+     * @param backend           实现方式
+     */
+    explicit DirectoryRenamer(const QString& directory, Backend backend = Backend::Auto);
+    ~DirectoryRenamer();
+
+    DirectoryRenamer(const DirectoryRenamer&) = delete;
+    DirectoryRenamer& operator=(const DirectoryRenamer&) = delete;
+
+    /**
+     * @brief 重命名，目标已存在时不覆盖
+     * @param oldName           原文件名
+     * @param newName           新文件名
+     * @return 成功时返回0，失败时返回errno（目标已存在为EEXIST），QDir失败时原因未知，返回-1
+     */
+    int rename(const QString& oldName, const QString& newName);
+
+    /**
+     * @brief 目录中是否存在该名称（不跟随符号链接）
+     * @param name              名称
+     * @return 存在时返回true
+     */
+    bool exists(const QString& name);
+
+    /**
+     * @brief 是否通过目录句柄重命名
+     */
+    bool usesDirectoryHandle() const;
+
+    /**
+     * @brief 本对象发出的文件系统调用数（QDir的每次调用按一次计）
+     */
+    qint64 callCount() const;
+
+    /**
+     * @brief 错误码的说明
+     * @param error             rename()返回的错误码
+     * @return 说明文字
+     */
+    static QString errorString(int error);
+
+private:
+    QDir dir;
+    int dirfd = -1;             // 目录句柄，未使用时为-1
+    bool noReplace = true;      // 文件系统是否支持RENAME_NOREPLACE
+    qint64 calls = 0;
+};
+
+#endif // DIRECTORYRENAMER_H
@@ -0,0 +1,313 @@
+#include "duplicatefinder.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QThreadPool>
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+#include "fileorder.h"
+
+namespace
+{
+    // 第一轮只比较开头的字节数
+    const qint64 prefixSize = 64 * 1024;
+
+    // 每次映射的字节数，避免大视频占满地址空间
+    const qint64 mapWindow = 64 * 1024 * 1024;
+
+    // 映射失败时逐块读取的字节数
+    const qint64 readBlock = 1024 * 1024;
+
+    // 每个哈希任务处理的文件数
+    const int hashChunkSize = 8;
+
+    /**
+     * @brief 流式XXH64
+     */
+    class Xxh64
+    {
+    public:
+        Xxh64()
+        {
+            v[0] = prime1 + prime2;
+            v[1] = prime2;
+            v[2] = 0;
+            v[3] = 0 - prime1;
+        }
+
+        void update(const uchar* data, qint64 length)
+        {
+            total += quint64(length);
+            // 先补齐上次剩下的不足32字节的部分
+            if(buffered > 0)
+            {
+                qint64 fill = qMin<qint64>(32 - buffered, length);
+                std::memcpy(buffer + buffered, data, size_t(fill));
+                buffered += int(fill);
+                data += fill;
+                length -= fill;
+                if(buffered < 32)
+                {
+                    return;
+                }
+                stripe(buffer);
+                buffered = 0;
+            }
+            while(length >= 32)
+            {
+                stripe(data);
+                data += 32;
+                length -= 32;
+            }
+            std::memcpy(buffer, data, size_t(length));
+            buffered = int(length);
+        }
+
+        quint64 digest() const
+        {
+            quint64 h;
+            if(total >= 32)
+            {
+                h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+                for(quint64 lane : v)
+                {
+                    h = (h ^ round(0, lane)) * prime1 + prime4;
+                }
+            }
+            else
+            {
+                h = prime5;
+            }
+            h += total;
+            const uchar* p = buffer;
+            int remaining = buffered;
+            while(remaining >= 8)
+            {
+                h = rotl(h ^ round(0, qFromLittleEndian<quint64>(p)), 27) * prime1 + prime4;
+                p += 8;
+                remaining -= 8;
+            }
+            if(remaining >= 4)
+            {
+                h = rotl(h ^ (quint64(qFromLittleEndian<quint32>(p)) * prime1), 23) * prime2 + prime3;
+                p += 4;
+                remaining -= 4;
+            }
+            while(remaining > 0)
+            {
+                h = rotl(h ^ (quint64(*p) * prime5), 11) * prime1;
+                p++;
+                remaining--;
+            }
+            h ^= h >> 33;
+            h *= prime2;
+            h ^= h >> 29;
+            h *= prime3;
+            h ^= h >> 32;
+            return h;
+        }
+
+    private:
+        static constexpr quint64 prime1 = 11400714785074694791ULL;
+        static constexpr quint64 prime2 = 14029467366897019727ULL;
+        static constexpr quint64 prime3 = 1609587929392839161ULL;
+        static constexpr quint64 prime4 = 9650029242287828579ULL;
+        static constexpr quint64 prime5 = 2870177450012600261ULL;
+
+        static quint64 rotl(quint64 x, int r)
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        static quint64 round(quint64 acc, quint64 input)
+        {
+            return rotl(acc + input * prime2, 31) * prime1;
+        }
+
+        void stripe(const uchar* p)
+        {
+            for(int i = 0; i < 4; i++)
+            {
+                v[i] = round(v[i], qFromLittleEndian<quint64>(p + 8 * i));
+            }
+        }
+
+        quint64 v[4];
+        uchar buffer[32];
+        int buffered = 0;
+        quint64 total = 0;
+    };
+
+    /**
+     * @brief 在线程池中计算一组文件的哈希
+     * @param base              目录路径（以“/”结尾）
+     * @param fileNames         文件名列表
+     * @param indices           需要计算的文件下标
+     * @param limit             最多读取的字节数，小于0时读取整个文件
+     * @param maxThreads        最大线程数
+     * @param hashes            按文件下标写入哈希值
+     * @param valid             按文件下标写入是否读取成功
+     */
+    void hashAll(const QString& base, const QStringList& fileNames, const QVector<int>& indices, qint64 limit,
+                 int maxThreads, QVector<quint64>* hashes, QVector<char>* valid)
+    {
+        quint64* hashOut = hashes->data();
+        char* validOut = valid->data();
+        QThreadPool pool;
+        pool.setMaxThreadCount(qMax(1, maxThreads));
+        for(int begin = 0; begin < indices.size(); begin += hashChunkSize)
+        {
+            int end = qMin(begin + hashChunkSize, int(indices.size()));
+            pool.start([&base, &fileNames, &indices, limit, hashOut, validOut, begin, end]()
+            {
+                for(int k = begin; k < end; k++)
+                {
+                    int i = indices[k];
+                    validOut[i] = DuplicateFinder::hashFile(base + fileNames[i], limit, &hashOut[i]) ? 1 : 0;
+                }
+            });
+        }
+        pool.waitForDone();
+    }
+
+    /**
+     * @brief 按键把文件分成若干组，只保留不少于两个文件的组
+     */
+    template<typename Key>
+    QVector<QVector<int>> groupBy(const QVector<int>& indices, const QVector<Key>& keys, const QVector<char>* valid)
+    {
+        QHash<Key, int> groupOf;
+        QVector<QVector<int>> groups;
+        for(int i : indices)
+        {
+            if(valid && !(*valid)[i])
+            {
+                continue;
+            }
+            auto it = groupOf.find(keys[i]);
+            if(it == groupOf.end())
+            {
+                it = groupOf.insert(keys[i], groups.size());
+                groups.append(QVector<int>());
+            }
+            groups[it.value()].append(i);
+        }
+        QVector<QVector<int>> result;
+        for(QVector<int>& group : groups)
+        {
+            if(group.size() > 1)
+            {
+                result.append(std::move(group));
+            }
+        }
+        return result;
+    }
+} // namespace
+
+QVector<int> DuplicateFinder::find(const QString& directory, const QStringList& fileNames, int maxThreads)
+{
+    QVector<int> result(fileNames.size(), -1);
+    if(fileNames.size() < 2)
+    {
+        return result;
+    }
+    // 按大小分组：大小唯一的文件不读内容；空文件不算重复
+    QVector<qint64> sizes = FileOrder::statKeys(directory, fileNames, FileOrder::Key::Size, maxThreads);
+    QVector<int> all;
+    all.reserve(fileNames.size());
+    for(int i = 0; i < fileNames.size(); i++)
+    {
+        if(sizes[i] > 0 && sizes[i] != std::numeric_limits<qint64>::max())
+        {
+            all.append(i);
+        }
+    }
+    QVector<int> collisions;
+    for(const QVector<int>& group : groupBy(all, sizes, nullptr))
+    {
+        collisions += group;
+    }
+    if(collisions.isEmpty())
+    {
+        return result;
+    }
+    const QString base = QDir(directory).absolutePath() + "/";
+    QVector<quint64> hashes(fileNames.size(), 0);
+    QVector<char> valid(fileNames.size(), 0);
+    // 第一轮：大小相同的文件只比较开头一段（不超过这一段的文件即为全文）
+    hashAll(base, fileNames, collisions, prefixSize, maxThreads, &hashes, &valid);
+    QVector<QVector<int>> candidates;
+    QVector<int> needFull;
+    for(const QVector<int>& sizeGroup : groupBy(collisions, sizes, nullptr))
+    {
+        for(const QVector<int>& group : groupBy(sizeGroup, hashes, &valid))
+        {
+            candidates.append(group);
+            if(sizes[group.front()] > prefixSize)
+            {
+                needFull += group;
+            }
+        }
+    }
+    // 第二轮：开头仍相同且更长的文件计算全文
+    if(!needFull.isEmpty())
+    {
+        hashAll(base, fileNames, needFull, -1, maxThreads, &hashes, &valid);
+    }
+    for(const QVector<int>& candidate : std::as_const(candidates))
+    {
+        for(const QVector<int>& group : groupBy(candidate, hashes, &valid))
+        {
+            // 组内下标按列表顺序排列，第一个为原件
+            for(int k = 1; k < group.size(); k++)
+            {
+                result[group[k]] = group.front();
+            }
+        }
+    }
+    return result;
+}
+
+bool DuplicateFinder::hashFile(const QString& path, qint64 limit, quint64* hash)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    qint64 size = file.size();
+    if(limit >= 0)
+    {
+        size = qMin(size, limit);
+    }
+    Xxh64 state;
+    qint64 offset = 0;
+    while(offset < size)
+    {
+        qint64 length = qMin(mapWindow, size - offset);
+        uchar* data = file.map(offset, length);
+        if(data)
+        {
+            state.update(data, length);
+            file.unmap(data);
+            offset += length;
+            continue;
+        }
+        // 不支持映射的文件系统退回逐块读取
+        if(!file.seek(offset))
+        {
+            return false;
+        }
+        QByteArray block = file.read(qMin(readBlock, size - offset));
+        if(block.isEmpty())
+        {
+            return false;
+        }
+        state.update(reinterpret_cast<const uchar*>(block.constData()), block.size());
+        offset += block.size();
+    }
+    *hash = state.digest();
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+/******************************************************************************
+ * @file       duplicatefinder.h
+ * @brief      找出内容相同的文件
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief 重复文件查找
+ *
+ * 先按大小分组，大小唯一的文件不可能重复，不读取内容；大小相同的文件在线程池中计算XXH64：
+ * 先只计算开头一段，仍然相同的再计算整个文件。文件通过QFile::map分段映射，不复制到用户缓冲区。
+ * 64位哈希相同即视为内容相同。
+ */
+class DuplicateFinder
+{
+public:
+    /**
+     * @brief 查找重复文件
+     * @param directory         文件所在目录
+     * @param fileNames         文件名列表，靠前的文件视为原件
+     * @param maxThreads        同时读取的最大线程数
+     * @return 与文件名列表一一对应：重复文件为其原件（列表中第一个内容相同的文件）的下标，其余为-1
+     */
+    static QVector<int> find(const QString& directory, const QStringList& fileNames, int maxThreads = 8);
+
+    /**
+     * @brief 计算文件内容的XXH64
+     * @param path              文件路径
+     * @param limit             最多读取的字节数，小于0时读取整个文件
+     * @param hash              哈希值
+     * @return 读取成功时返回true
+     */
+    static bool hashFile(const QString& path, qint64 limit, quint64* hash);
+};
+
+#endif // DUPLICATEFINDER_H
@@ -0,0 +1,188 @@
+#include "extensionclassifier.h"
+#include "batchrenamer.h"
+
+#include <QDir>
+#include <QFile>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // 各内置类型的扩展名列表
+    const QVector<QStringList>& builtinLists()
+    {
+        static const QVector<QStringList> result = {Extension::Pic.split('|'), Extension::Vid.split('|'),
+                                                    Extension::Doc.split('|')};
+        return result;
+    }
+
+    // 文件头在指定偏移处是否为给定字节
+    bool hasMagic(const QByteArray& header, int offset, const char* magic, int size)
+    {
+        return header.size() >= offset + size && std::memcmp(header.constData() + offset, magic, size) == 0;
+    }
+
+    // 每个读取任务处理的文件数，减少调度开销
+    const int sniffChunkSize = 64;
+} // namespace
+
+ExtensionClassifier::ExtensionClassifier(const QString& extensionFilter)
+{
+    QRegularExpression whole(extensionFilter, QRegularExpression::CaseInsensitiveOption);
+    if(!whole.isValid())
+    {
+        qWarning() << "Invalid regex pattern in extension filter:" << extensionFilter;
+        all = true; // 过滤器无效时保留所有文件作为降级处理
+        return;
+    }
+    // 含分组、字符类或转义时无法安全地按“|”拆分，整体按正则表达式处理
+    static const QRegularExpression structural(R"([()\[\]{}\\])");
+    if(extensionFilter.contains(structural))
+    {
+        customRegex = whole;
+        customRegex.optimize();
+        return;
+    }
+    QStringList tokens = extensionFilter.split('|');
+    // 完整出现的内置列表（由类型选项拼接而来）放入哈希表；用户输入的扩展名即使与内置的相同，也按正则表达式匹配
+    QVector<bool> builtin(tokens.size(), false);
+    for(const QStringList& list : builtinLists())
+    {
+        for(int begin = 0; begin + list.size() <= tokens.size(); begin++)
+        {
+            if(std::equal(list.begin(), list.end(), tokens.begin() + begin))
+            {
+                for(int i = begin; i < begin + list.size(); i++)
+                {
+                    builtin[i] = true;
+                    extensions.insert(tokens[i].toLower());
+                }
+                break;
+            }
+        }
+    }
+    QStringList custom;
+    for(int i = 0; i < tokens.size(); i++)
+    {
+        // 空分支或“.*”匹配任意扩展名
+        if(tokens[i].isEmpty() || tokens[i] == ".*")
+        {
+            all = true;
+            return;
+        }
+        if(!builtin[i])
+        {
+            custom.append(tokens[i]);
+        }
+    }
+    if(!custom.isEmpty())
+    {
+        customRegex = QRegularExpression(custom.join('|'), QRegularExpression::CaseInsensitiveOption);
+        customRegex.optimize();
+    }
+}
+
+bool ExtensionClassifier::matchesAll() const
+{
+    return all;
+}
+
+bool ExtensionClassifier::matchesSuffix(QStringView suffix) const
+{
+    if(all)
+    {
+        return true;
+    }
+    QString text = suffix.toString();
+    if(extensions.contains(text.toLower()))
+    {
+        return true;
+    }
+    return !customRegex.pattern().isEmpty() && customRegex.match(text).hasMatch();
+}
+
+bool ExtensionClassifier::matchesHeader(const QByteArray& header) const
+{
+    QString extension = sniffExtension(header);
+    return !extension.isEmpty() && matchesSuffix(extension);
+}
+
+QVector<char> ExtensionClassifier::matchFileHeaders(const QString& directory, const QStringList& fileNames, int maxThreads) const
+{
+    QVector<char> result(fileNames.size(), 0);
+    if(fileNames.isEmpty())
+    {
+        return result;
+    }
+    // 独立的有界线程池，同时打开的文件数不超过maxThreads
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, maxThreads));
+    const QString base = QDir(directory).absolutePath() + "/";
+    char* matched = result.data();
+    for(int begin = 0; begin < fileNames.size(); begin += sniffChunkSize)
+    {
+        int end = qMin(begin + sniffChunkSize, int(fileNames.size()));
+        pool.start([this, &base, &fileNames, matched, begin, end]()
+        {
+            for(int i = begin; i < end; i++)
+            {
+                QFile file(base + fileNames[i]);
+                if(file.open(QIODevice::ReadOnly))
+                {
+                    matched[i] = matchesHeader(file.read(headerSize)) ? 1 : 0;
+                }
+            }
+        });
+    }
+    pool.waitForDone();
+    return result;
+}
+
+QString ExtensionClassifier::sniffExtension(const QByteArray& header)
+{
+    if(hasMagic(header, 0, "\xFF\xD8\xFF", 3))
+    { return "jpg"; }
+    if(hasMagic(header, 0, "\x89PNG\r\n\x1A\n", 8))
+    { return "png"; }
+    if(hasMagic(header, 0, "GIF87a", 6) || hasMagic(header, 0, "GIF89a", 6))
+    { return "gif"; }
+    if(hasMagic(header, 0, "RIFF", 4))
+    {
+        if(hasMagic(header, 8, "WEBP", 4))
+        { return "webp"; }
+        if(hasMagic(header, 8, "AVI ", 4))
+        { return "avi"; }
+        return QString();
+    }
+    // ISO基础媒体文件格式，按主品牌区分
+    if(hasMagic(header, 4, "ftyp", 4))
+    {
+        QByteArray brand = header.mid(8, 4);
+        if(brand == "avif" || brand == "avis")
+        { return "avif"; }
+        if(brand == "heic" || brand == "heix" || brand == "mif1" || brand == "msf1")
+        { return "heic"; }
+        if(brand == "qt  ")
+        { return "mov"; }
+        if(brand == "M4V " || brand == "M4VH")
+        { return "m4v"; }
+        if(brand == "f4v ")
+        { return "f4v"; }
+        return "mp4";
+    }
+    if(hasMagic(header, 0, "FLV\x01", 4))
+    { return "flv"; }
+    if(hasMagic(header, 0, "\x00\x00\x01\xBA", 4) || hasMagic(header, 0, "\x00\x00\x01\xB3", 4))
+    { return "mpg"; }
+    if(hasMagic(header, 0, "\x30\x26\xB2\x75\x8E\x66\xCF\x11", 8))
+    { return "wmv"; }
+    if(hasMagic(header, 0, "%PDF", 4))
+    { return "pdf"; }
+    if(hasMagic(header, 0, "{\\rtf", 5))
+    { return "rtf"; }
+    // BMP的保留字段必须为0，避免把以“BM”开头的文本误认为图片
+    if(hasMagic(header, 0, "BM", 2) && hasMagic(header, 6, "\0\0\0\0", 4))
+    { return "bmp"; }
+    return QString();
+}
@@ -0,0 +1,82 @@
+#ifndef EXTENSIONCLASSIFIER_H
+#define EXTENSIONCLASSIFIER_H
+
+/******************************************************************************
+ * @file       extensionclassifier.h
+ * @brief      按扩展名（或文件头）筛选文件
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+/**
+ * @brief 扩展名分类器
+ *
+ * 扩展名过滤器中完整出现的内置类型列表（Extension::Pic/Vid/Doc）预先放入小写哈希表，
+ * 按扩展名精确查找；用户输入的部分仍按正则表达式匹配。可选地读取文件头识别扩展名错误或缺失的文件。
+ */
+class ExtensionClassifier
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param extensionFilter   扩展名过滤器（正则表达式，以“|”连接）
+     */
+    explicit ExtensionClassifier(const QString& extensionFilter = ".*");
+
+    /**
+     * @brief 是否匹配所有文件
+     */
+    bool matchesAll() const;
+
+    /**
+     * @brief 按扩展名判断
+     * @param suffix            扩展名（不含点号）
+     * @return 通过时返回true
+     */
+    bool matchesSuffix(QStringView suffix) const;
+
+    /**
+     * @brief 按文件头判断
+     * @param header            文件开头的若干字节
+     * @return 识别出的类型通过时返回true
+     */
+    bool matchesHeader(const QByteArray& header) const;
+
+    /**
+     * @brief 并行读取文件头并判断，每个文件只读开头的少量字节
+     * @param directory         目录
+     * @param fileNames         文件名列表
+     * @param maxThreads        同时读取的最大线程数
+     * @return 与文件名列表一一对应的判断结果
+     */
+    QVector<char> matchFileHeaders(const QString& directory, const QStringList& fileNames, int maxThreads = 8) const;
+
+    /**
+     * @brief 根据文件头识别扩展名
+     * @param header            文件开头的若干字节
+     * @return 识别出的扩展名（小写），无法识别时返回空字符串
+     */
+    static QString sniffExtension(const QByteArray& header);
+
+    /**
+     * @brief 识别所需读取的字节数
+     */
+    static const int headerSize = 16;
+
+private:
+    QSet<QString> extensions;           // 被选中的内置类型的扩展名（小写）
+    QRegularExpression customRegex;     // 无法放入哈希表的部分
+    bool all = false;                   // 匹配所有文件
+};
+
+#endif // EXTENSIONCLASSIFIER_H
@@ -0,0 +1,184 @@
+#include "fileorder.h"
+
+#include <QCollator>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QThreadPool>
+#include <algorithm>
+#include <limits>
+#include "mediametadata.h"
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // 每个读取任务处理的文件数
+    const int statChunkSize = 256;
+
+    // 读取失败的文件的键，排在最后
+    const qint64 missingKey = std::numeric_limits<qint64>::max();
+
+    /**
+     * @brief 紧凑的排序键
+     */
+    struct SortKey
+    {
+        qint64 value;
+        int index;      // 在按名称排序的文件名列表中的下标，键相同时保持名称顺序
+    };
+
+    // 按下标重排文件名
+    void permute(QStringList* fileNames, const QVector<int>& order)
+    {
+        QStringList sorted;
+        sorted.reserve(order.size());
+        for(int index : order)
+        {
+            sorted.append(std::move((*fileNames)[index]));
+        }
+        *fileNames = std::move(sorted);
+    }
+} // namespace
+
+bool FileOrder::fromString(const QString& name, Key* key)
+{
+    int index = names().indexOf(name.trimmed().toLower());
+    if(index < 0)
+    {
+        return false;
+    }
+    *key = Key(index);
+    return true;
+}
+
+QStringList FileOrder::names()
+{
+    return {"name", "natural", "mtime", "size", "capture"};
+}
+
+void FileOrder::sort(const QString& directory, QStringList* fileNames, Key key, int maxThreads)
+{
+    // 与QDir默认的排序（按名称、忽略大小写）一致，其他排序依据在此基础上进行
+    std::sort(fileNames->begin(), fileNames->end(), [](const QString& a, const QString& b)
+    {
+        int order = a.compare(b, Qt::CaseInsensitive);
+        return order != 0 ? order < 0 : a < b;
+    });
+    if(key == Key::Name || fileNames->size() < 2)
+    {
+        return;
+    }
+    QVector<int> order(fileNames->size());
+    if(key == Key::NaturalName)
+    {
+        // 预先计算排序键，比较时不再逐字符解析数字；固定区域设置，同一组文件在任何机器上编号顺序相同
+        QCollator collator(QLocale(QLocale::English, QLocale::UnitedStates));
+        collator.setNumericMode(true);
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+        QVector<QCollatorSortKey> keys;
+        keys.reserve(fileNames->size());
+        for(int i = 0; i < fileNames->size(); i++)
+        {
+            keys.append(collator.sortKey(fileNames->at(i)));
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&keys](int a, int b)
+        {
+            return keys[a].compare(keys[b]) < 0;
+        });
+        permute(fileNames, order);
+        return;
+    }
+    QVector<SortKey> keys(fileNames->size());
+    if(key == Key::CaptureTime)
+    {
+        QVector<MediaMetadata> metadata = MetadataReader::readAll(directory, *fileNames, maxThreads);
+        for(int i = 0; i < metadata.size(); i++)
+        {
+            const QDateTime& time = metadata[i].captureTime.isValid() ? metadata[i].captureTime : metadata[i].modifiedTime;
+            keys[i] = {time.isValid() ? time.toMSecsSinceEpoch() : missingKey, i};
+        }
+    }
+    else
+    {
+        QVector<qint64> values = statKeys(directory, *fileNames, key, maxThreads);
+        for(int i = 0; i < values.size(); i++)
+        {
+            keys[i] = {values[i], i};
+        }
+    }
+    std::sort(keys.begin(), keys.end(), [](const SortKey& a, const SortKey& b)
+    {
+        return a.value != b.value ? a.value < b.value : a.index < b.index;
+    });
+    for(int i = 0; i < keys.size(); i++)
+    {
+        order[i] = keys[i].index;
+    }
+    permute(fileNames, order);
+}
+
+QVector<qint64> FileOrder::statKeys(const QString& directory, const QStringList& fileNames, Key key, int maxThreads)
+{
+    QVector<qint64> result(fileNames.size(), missingKey);
+    qint64* out = result.data();
+    bool modified = key == Key::Modified;
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, maxThreads));
+#if defined(Q_OS_LINUX) && defined(STATX_MTIME)
+    // 目录只打开一次，之后按名称相对目录句柄读取，不再逐个解析完整路径
+    int dirfd = ::open(QFile::encodeName(directory).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirfd >= 0)
+    {
+        const unsigned int mask = STATX_TYPE | (modified ? STATX_MTIME : STATX_SIZE);
+        for(int begin = 0; begin < fileNames.size(); begin += statChunkSize)
+        {
+            int end = qMin(begin + statChunkSize, int(fileNames.size()));
+            pool.start([&fileNames, out, dirfd, mask, modified, begin, end]()
+            {
+                struct statx stx;
+                for(int i = begin; i < end; i++)
+                {
+                    // 云盘挂载下不必为排序与服务器同步属性；与QFileInfo一样取符号链接目标的属性，只认普通文件
+                    if(::statx(dirfd, QFile::encodeName(fileNames[i]).constData(),
+                               AT_STATX_DONT_SYNC, mask, &stx) != 0
+                       || (stx.stx_mask & mask) != mask || !S_ISREG(stx.stx_mode))
+                    {
+                        continue;
+                    }
+                    out[i] = modified ? qint64(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec
+                                      : qint64(stx.stx_size);
+                }
+            });
+        }
+        pool.waitForDone();
+        ::close(dirfd);
+        return result;
+    }
+#endif
+    const QString base = QDir(directory).absolutePath() + "/";
+    for(int begin = 0; begin < fileNames.size(); begin += statChunkSize)
+    {
+        int end = qMin(begin + statChunkSize, int(fileNames.size()));
+        pool.start([&fileNames, &base, out, modified, begin, end]()
+        {
+            for(int i = begin; i < end; i++)
+            {
+                QFileInfo info(base + fileNames[i]);
+                if(!info.isFile())
+                {
+                    continue;
+                }
+                out[i] = modified ? info.lastModified().toMSecsSinceEpoch() * 1000000 : info.size();
+            }
+        });
+    }
+    pool.waitForDone();
+    return result;
+}
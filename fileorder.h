@@ -0,0 +1,73 @@
+#ifndef FILEORDER_H
+#define FILEORDER_H
+
+/******************************************************************************
+ * @file       fileorder.h
+ * @brief      决定待重命名文件的编号顺序
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief 编号顺序
+ *
+ * 排序只依赖文件名和文件本身的属性，与目录的枚举顺序无关，同一目录在不同机器上得到相同的编号。
+ * 修改时间和大小在Linux下按目录句柄分批并行调用statx读取，其他平台退回QFileInfo；
+ * 拍摄时间通过MetadataReader读取（共用其缓存），没有拍摄时间的文件按修改时间参与排序。
+ * 排序只在紧凑的（键，下标）数组上进行，最后按下标一次性重排文件名。键相同的文件保持按名称的顺序。
+ */
+class FileOrder
+{
+public:
+    /**
+     * @brief 排序依据
+     */
+    enum class Key
+    {
+        Name,           // 按名称，不区分大小写（默认，与以往的编号顺序一致）
+        NaturalName,    // 按名称，名称中的数字按数值比较（如img2在img10之前）
+        Modified,       // 按修改时间
+        Size,           // 按文件大小
+        CaptureTime     // 按拍摄时间
+    };
+
+    /**
+     * @brief 由名称得到排序依据
+     * @param name              名称（name、natural、mtime、size、capture）
+     * @param key               排序依据
+     * @return 名称有效时返回true
+     */
+    static bool fromString(const QString& name, Key* key);
+
+    /**
+     * @brief 全部排序依据的名称，与Key的顺序一致
+     */
+    static QStringList names();
+
+    /**
+     * @brief 按排序依据对文件名排序
+     * @param directory         文件所在目录
+     * @param fileNames         文件名列表，原地排序
+     * @param key               排序依据
+     * @param maxThreads        读取文件属性的最大线程数
+     */
+    static void sort(const QString& directory, QStringList* fileNames, Key key, int maxThreads = 8);
+
+    /**
+     * @brief 并行读取各文件的修改时间（纳秒）或大小，读取失败的文件为qint64的最大值（排在最后）
+     * @param directory         文件所在目录
+     * @param fileNames         文件名列表
+     * @param key               Modified或Size
+     * @param maxThreads        最大线程数
+     * @return 与文件名列表一一对应的键
+     */
+    static QVector<qint64> statKeys(const QString& directory, const QStringList& fileNames, Key key, int maxThreads);
+};
+
+#endif // FILEORDER_H
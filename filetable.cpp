@@ -0,0 +1,73 @@
+#include "filetable.h"
+
+FileTable::FileTable()
+{
+    offsets.append(0);
+}
+
+void FileTable::reserve(int files, qsizetype chars)
+{
+    arena.reserve(chars);
+    offsets.reserve(files + 1);
+    firstDots.reserve(files);
+    lastDots.reserve(files);
+}
+
+int FileTable::append(QStringView name)
+{
+    // 文件名长度受文件系统限制，远小于点号位置能表示的范围
+    Q_ASSERT(name.size() < noDot);
+    qsizetype first = name.indexOf('.');
+    qsizetype last = name.lastIndexOf('.');
+    arena.append(name);
+    offsets.append(quint32(arena.size()));
+    firstDots.append(first < 0 ? noDot : quint16(first));
+    lastDots.append(last < 0 ? noDot : quint16(last));
+    return firstDots.size() - 1;
+}
+
+void FileTable::clear()
+{
+    arena.clear();
+    offsets.resize(1);
+    firstDots.clear();
+    lastDots.clear();
+}
+
+int FileTable::size() const
+{
+    return firstDots.size();
+}
+
+bool FileTable::isEmpty() const
+{
+    return firstDots.isEmpty();
+}
+
+QStringView FileTable::name(int i) const
+{
+    return QStringView(arena).mid(offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+QStringView FileTable::completeBaseName(int i) const
+{
+    QStringView result = name(i);
+    return lastDots[i] == noDot ? result : result.left(lastDots[i]);
+}
+
+QStringView FileTable::baseName(int i) const
+{
+    QStringView result = name(i);
+    return firstDots[i] == noDot ? result : result.left(firstDots[i]);
+}
+
+QStringView FileTable::suffix(int i) const
+{
+    return lastDots[i] == noDot ? QStringView() : name(i).mid(lastDots[i] + 1);
+}
+
+qint64 FileTable::memoryUsage() const
+{
+    return arena.capacity() * qint64(sizeof(QChar)) + offsets.capacity() * qint64(sizeof(quint32))
+           + (firstDots.capacity() + lastDots.capacity()) * qint64(sizeof(quint16));
+}
@@ -0,0 +1,97 @@
+#ifndef FILETABLE_H
+#define FILETABLE_H
+
+/******************************************************************************
+ * @file       filetable.h
+ * @brief      连续存放文件名的紧凑名称表
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/**
+ * @brief 名称表
+ *
+ * 所有名称首尾相接存放在一块UTF-16缓冲区中，按列（结构数组）另存每个名称的起始位置和
+ * 第一个、最后一个点号的位置，取文件名、基本名和扩展名都只返回指向缓冲区的视图，
+ * 不再为每个文件构造QFileInfo或QString。视图在下一次append()之前有效。
+ */
+class FileTable
+{
+public:
+    FileTable();
+
+    /**
+     * @brief 预留空间
+     * @param files             名称个数
+     * @param chars             名称的总字符数
+     */
+    void reserve(int files, qsizetype chars);
+
+    /**
+     * @brief 追加名称
+     * @param name              不含路径的文件名
+     * @return 名称的序号
+     */
+    int append(QStringView name);
+
+    /**
+     * @brief 清空名称表
+     */
+    void clear();
+
+    /**
+     * @brief 名称个数
+     */
+    int size() const;
+
+    /**
+     * @brief 名称表是否为空
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief 文件名
+     * @param i                 序号
+     */
+    QStringView name(int i) const;
+
+    /**
+     * @brief 最后一个点号之前的部分，同QFileInfo::completeBaseName()
+     * @param i                 序号
+     */
+    QStringView completeBaseName(int i) const;
+
+    /**
+     * @brief 第一个点号之前的部分，同QFileInfo::baseName()
+     * @param i                 序号
+     */
+    QStringView baseName(int i) const;
+
+    /**
+     * @brief 最后一个点号之后的部分，同QFileInfo::suffix()
+     * @param i                 序号
+     */
+    QStringView suffix(int i) const;
+
+    /**
+     * @brief 占用的内存（字节），含预留未用的部分
+     */
+    qint64 memoryUsage() const;
+
+private:
+    // 不含点号时记录的位置
+    static const quint16 noDot = 0xffff;
+
+    QString arena;                  // 全部名称首尾相接
+    QVector<quint32> offsets;       // 各名称在arena中的起始位置，末尾多存一个总长度
+    QVector<quint16> firstDots;     // 第一个点号相对名称起始的位置
+    QVector<quint16> lastDots;      // 最后一个点号相对名称起始的位置
+};
+
+#endif // FILETABLE_H
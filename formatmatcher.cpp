@@ -0,0 +1,238 @@
+#include "formatmatcher.h"
+
+#include <climits>
+
+namespace
+{
+    // 与PCRE中的\d一致，只接受ASCII数字
+    bool isAsciiDigit(QChar c)
+    {
+        return c.unicode() >= '0' && c.unicode() <= '9';
+    }
+
+    // 位置是否落在完整字符的边界上（PCRE在UTF模式下不会停在代理对中间）
+    bool isBoundary(QStringView subject, qsizetype pos)
+    {
+        return pos <= 0 || pos >= subject.size()
+               || !(subject[pos - 1].isHighSurrogate() && subject[pos].isLowSurrogate());
+    }
+} // namespace
+
+FormatMatcher::FormatMatcher() {}
+
+void FormatMatcher::setAnchors(bool start, bool end)
+{
+    anchorStart = start;
+    anchorEnd = end;
+}
+
+void FormatMatcher::addLiteral(const QString& text)
+{
+    if(text.isEmpty())
+    { return; }
+    if(!isPlainLiteral(text))
+    {
+        // 含元字符的文本只能交给正则表达式处理
+        usable = false;
+        return;
+    }
+    // 相邻的固定文本合并为一条指令
+    if(!tokens.isEmpty() && tokens.back().type == TokenType::Literal)
+    {
+        tokens.back().literal += text;
+        return;
+    }
+    Token token;
+    token.type = TokenType::Literal;
+    token.literal = text;
+    tokens.append(token);
+}
+
+void FormatMatcher::addField()
+{
+    Token token;
+    token.type = TokenType::Field;
+    tokens.append(token);
+}
+
+void FormatMatcher::addDigits(int width)
+{
+    Token token;
+    token.type = TokenType::Digits;
+    token.width = width;
+    tokens.append(token);
+}
+
+bool FormatMatcher::isValid() const
+{
+    return usable && !tokens.isEmpty();
+}
+
+bool FormatMatcher::matches(QStringView subject) const
+{
+    MatchState state;
+    return search(subject, &state);
+}
+
+int FormatMatcher::extractNumber(QStringView subject) const
+{
+    MatchState state;
+    if(search(subject, &state))
+    {
+        return state.number;
+    }
+    return -1;
+}
+
+bool FormatMatcher::isPlainLiteral(QStringView text)
+{
+    static const QString metaCharacters = QStringLiteral("\\^$.|?*+()[]{}");
+    for(QChar c : text)
+    {
+        if(metaCharacters.contains(c))
+        {
+            return false;
+        }
+    }
+    return text.isValidUtf16();
+}
+
+bool FormatMatcher::search(QStringView subject, MatchState* state) const
+{
+    // 与QRegularExpression一致：非法UTF-16文本不参与匹配
+    if(!subject.isValidUtf16())
+    {
+        return false;
+    }
+    if(anchorStart)
+    {
+        return matchFrom(subject, 0, 0, state);
+    }
+    // 非锚定时从左到右尝试起点，与PCRE取最左匹配的行为一致
+    const qsizetype length = subject.size();
+    const Token& first = tokens.front();
+    qsizetype pos = 0;
+    while(pos <= length)
+    {
+        if(first.type == TokenType::Literal)
+        {
+            // 直接跳到固定文本下一次出现的位置
+            qsizetype found = subject.indexOf(first.literal, pos);
+            if(found < 0)
+            {
+                return false;
+            }
+            pos = found;
+        }
+        else
+            if(first.type == TokenType::Digits && first.width > 0)
+            {
+                while(pos < length && !isAsciiDigit(subject[pos]))
+                {
+                    pos++;
+                }
+                if(pos + first.width > length)
+                {
+                    return false;
+                }
+            }
+        if(isBoundary(subject, pos) && matchFrom(subject, 0, int(pos), state))
+        {
+            return true;
+        }
+        if(first.type == TokenType::Field && pos < length && subject[pos] != u'_')
+        {
+            // 同一段内更靠后的起点只能得到更少的结束位置，既然这里失败，整段都不必再试
+            qsizetype separator = subject.indexOf(u'_', pos);
+            if(separator < 0)
+            {
+                return false;
+            }
+            pos = separator + 1;
+            continue;
+        }
+        pos++;
+    }
+    return false;
+}
+
+bool FormatMatcher::matchFrom(QStringView subject, int token, int pos, MatchState* state) const
+{
+    const qsizetype length = subject.size();
+    if(token == tokens.size())
+    {
+        if(!anchorEnd)
+        {
+            return true;
+        }
+        // $同时匹配末尾换行符之前的位置
+        return pos == length || (pos == length - 1 && subject[pos] == u'\n');
+    }
+    const Token& current = tokens[token];
+    switch(current.type)
+    {
+        case TokenType::Literal:
+        {
+            if(!subject.mid(pos).startsWith(current.literal))
+            {
+                return false;
+            }
+            return matchFrom(subject, token + 1, pos + int(current.literal.size()), state);
+        }
+        case TokenType::Digits:
+        {
+            if(pos + current.width > length)
+            {
+                return false;
+            }
+            // 检查数字的同时解析编号，溢出时与QString::toInt一样视为不可解析
+            qint64 value = 0;
+            for(int i = pos; i < pos + current.width; i++)
+            {
+                QChar c = subject[i];
+                if(!isAsciiDigit(c))
+                {
+                    return false;
+                }
+                if(value <= INT_MAX)
+                {
+                    value = value * 10 + (c.unicode() - '0');
+                }
+            }
+            int saved = state->number;
+            if(saved < 0 && current.width > 0 && value <= INT_MAX)
+            {
+                state->number = int(value);
+            }
+            if(matchFrom(subject, token + 1, pos + current.width, state))
+            {
+                return true;
+            }
+            state->number = saved;
+            return false;
+        }
+        case TokenType::Field:
+        {
+            if(pos >= length || subject[pos] == u'_')
+            {
+                return false;
+            }
+            // 字段最长延伸到下一个下划线（QStringView::indexOf在QtCore中以SIMD实现）
+            qsizetype runEnd = subject.indexOf(u'_', pos);
+            if(runEnd < 0)
+            {
+                runEnd = length;
+            }
+            // 贪婪匹配：从最长开始逐个回退
+            for(qsizetype end = runEnd; end > pos; end--)
+            {
+                if(isBoundary(subject, end) && matchFrom(subject, token + 1, int(end), state))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,132 @@
+#ifndef FORMATMATCHER_H
+#define FORMATMATCHER_H
+
+/******************************************************************************
+ * @file       formatmatcher.h
+ * @brief      不依赖正则表达式的占位符格式匹配器
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/**
+ * @brief 格式匹配器
+ *
+ * 将只含固定文本、普通占位符（[^_]+）和编号占位符（\d{n}）的格式编译为指令序列，
+ * 直接扫描文件名完成匹配并在同一次扫描中解析编号。匹配结果（包括取哪一处编号）
+ * 与对应正则表达式在QRegularExpression下的结果一致。
+ */
+class FormatMatcher
+{
+public:
+    FormatMatcher();
+
+    /**
+     * @brief 设置锚定方式
+     * @param start             是否锚定开头（^）
+     * @param end               是否锚定结尾（$）
+     */
+    void setAnchors(bool start, bool end);
+
+    /**
+     * @brief 追加固定文本
+     * @param text              固定文本，必须不含正则表达式元字符
+     */
+    void addLiteral(const QString& text);
+
+    /**
+     * @brief 追加字段，等价于[^_]+
+     */
+    void addField();
+
+    /**
+     * @brief 追加编号，等价于(\d{n})
+     * @param width             位数
+     */
+    void addDigits(int width);
+
+    /**
+     * @brief 是否已编译出可用的指令序列
+     */
+    bool isValid() const;
+
+    /**
+     * @brief 检查文本是否匹配
+     * @param subject           文件名（不含扩展名）
+     * @return 匹配时返回true
+     */
+    bool matches(QStringView subject) const;
+
+    /**
+     * @brief 提取编号
+     * @param subject           文件名（不含扩展名）
+     * @return 第一个可解析的编号，不匹配时返回-1
+     */
+    int extractNumber(QStringView subject) const;
+
+    /**
+     * @brief 检查文本在正则表达式中是否只代表其字面含义
+     * @param text              文本
+     * @return 不含元字符时返回true
+     */
+    static bool isPlainLiteral(QStringView text);
+
+private:
+    /**
+     * @brief 指令类型
+     */
+    enum class TokenType
+    {
+        Literal,    // 固定文本
+        Field,      // [^_]+
+        Digits      // (\d{n})
+    };
+
+    /**
+     * @brief 指令
+     */
+    struct Token
+    {
+        TokenType type;
+        QString literal;    // 固定文本
+        int width = 0;      // 编号位数
+    };
+
+    /**
+     * @brief 匹配结果
+     */
+    struct MatchState
+    {
+        int number = -1;    // 第一个可解析的编号
+    };
+
+    /**
+     * @brief 查找匹配
+     * @param subject           文本
+     * @param state             匹配结果
+     * @return 找到匹配时返回true
+     */
+    bool search(QStringView subject, MatchState* state) const;
+
+    /**
+     * @brief 从指定位置起匹配剩余指令（回溯顺序与PCRE相同）
+     * @param subject           文本
+     * @param token             指令序号
+     * @param pos               文本位置
+     * @param state             匹配结果
+     * @return 匹配成功时返回true
+     */
+    bool matchFrom(QStringView subject, int token, int pos, MatchState* state) const;
+
+    QVector<Token> tokens;
+    bool usable = true;         // 出现过无法处理的文本时为false
+    bool anchorStart = false;
+    bool anchorEnd = false;
+};
+
+#endif // FORMATMATCHER_H
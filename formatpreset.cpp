@@ -1,4 +1,12 @@
 #include "formatpreset.h"
+#include "batchrenamer.h"
+
+QVector<FormatPreset> preset =
+{
+    FormatPreset("custom", "", ""),
+    FormatPreset("activity", "\\1_\\2_\\d3", "Date: %{date:MMdd}, Name: 姓名", TYPE_PIC | TYPE_VID, ""),
+    FormatPreset("artwork", "*\\1_\\2", "Date: %yyMMdd, Catagory: 组名", TYPE_PIC, "")
+};
 
 FormatPreset::FormatPreset(const QString name, const QString &format, const QString &content, const int &type, const QString &customType):
     name(name), format(format), defaultContent(content), fileTpye(type), CustomFileType(customType)
@@ -33,3 +41,90 @@ const QString FormatPreset::getCustomType()
 {
     return this->CustomFileType;
 }
+
+QVector<QString> FormatPreset::parseContent(const QString& content, const QString& format)
+{
+    if(format.startsWith('?') && content.contains(";;"))
+    {
+        return content.split(";;");
+    }
+    QVector<QString> replacements = content.split(',');
+    for(int i = 0; i < replacements.length(); i++)
+    {
+        // 取最后一个半角冒号之后的部分，元数据占位符（如%{date:MMdd}）内的冒号不算
+        int colon = -1;
+        bool inToken = false;
+        const QString& part = replacements[i];
+        for(int j = 0; j < part.size(); j++)
+        {
+            if(part[j] == '%' && j + 1 < part.size() && part[j + 1] == '{')
+            { inToken = true; }
+            else
+                if(part[j] == '}')
+                { inToken = false; }
+                else
+                    if(part[j] == ':' && !inToken)
+                    { colon = j; }
+        }
+        if(colon >= 0)
+        { replacements[i] = part.mid(colon + 1); }
+        replacements[i] = replacements[i].trimmed();
+    }
+    return replacements;
+}
+
+QString FormatPreset::buildExtensionFilter(int type, const QString& customType)
+{
+    QString extensionFilter = customType;
+    if(TYPE_PIC & type)
+    {
+        if(!extensionFilter.isEmpty())
+        { extensionFilter += "|"; }
+        extensionFilter += Extension::Pic;
+    }
+    if(TYPE_VID & type)
+    {
+        if(!extensionFilter.isEmpty())
+        { extensionFilter += "|"; }
+        extensionFilter += Extension::Vid;
+    }
+    if(TYPE_DOC & type)
+    {
+        if(!extensionFilter.isEmpty())
+        { extensionFilter += "|"; }
+        extensionFilter += Extension::Doc;
+    }
+    return (extensionFilter.isEmpty()) ? ".*" : extensionFilter;
+}
+
+bool FormatPreset::parseTypes(const QString& list, int* type)
+{
+    *type = 0;
+    for(const QString& part : list.split(',', Qt::SkipEmptyParts))
+    {
+        QString name = part.trimmed().toLower();
+        if(name == "pic")
+        { *type |= TYPE_PIC; }
+        else
+            if(name == "vid")
+            { *type |= TYPE_VID; }
+            else
+                if(name == "doc")
+                { *type |= TYPE_DOC; }
+                else
+                { return false; }
+    }
+    return true;
+}
+
+int FormatPreset::indexOf(const QString& name)
+{
+    for(int i = 0; i < preset.size(); i++)
+    {
+        if(preset[i].getName() == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -13,6 +13,7 @@
 #include <QString>
 #include <QRegularExpression>
 #include <QDateTime>
+#include <QVector>
 
 #define TYPE_PIC 0x01
 #define TYPE_VID 0x02
@@ -65,6 +66,40 @@ public:
      */
     QString const getCustomType();
 
+    /**
+     * @brief 从命名内容中提取占位符（按半角逗号分割，取最后一个半角冒号后的部分并去除首尾空格）
+     *
+     * 格式为正则表达式模式且命名内容含“;;”时为多条规则的替换内容，按“;;”分割并原样保留（可以为空或只含空格）；
+     * 其他模式下“;;”没有特殊含义。
+     * @param content               命名内容
+     * @param format                命名格式
+     * @return 占位符
+     */
+    static QVector<QString> parseContent(const QString& content, const QString& format);
+
+    /**
+     * @brief 构建扩展名过滤器
+     * @param type                  文件类型（参考宏TYPE_XXX）
+     * @param customType            自定义扩展名（正则表达式）
+     * @return 扩展名过滤器（正则表达式），未指定任何类型时匹配所有文件
+     */
+    static QString buildExtensionFilter(int type, const QString& customType);
+
+    /**
+     * @brief 解析逗号分隔的文件类型列表，如“pic,vid”
+     * @param list                  文件类型列表（pic、vid、doc）
+     * @param type                  文件类型（参考宏TYPE_XXX）
+     * @return 全部类型有效时返回true
+     */
+    static bool parseTypes(const QString& list, int* type);
+
+    /**
+     * @brief 按名称查找内置预设
+     * @param name                  预设名称
+     * @return 在内置预设中的下标，不存在时返回-1
+     */
+    static int indexOf(const QString& name);
+
 private:
 
     const QString name;                 // 预设名称
@@ -75,4 +110,7 @@ private:
 
 };
 
+// 内置预设
+extern QVector<FormatPreset> preset;
+
 #endif // FORMATPRESET_H
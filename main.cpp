@@ -5,6 +5,8 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    // 与命令行工具共用应用数据目录（重命名日志）
+    QApplication::setApplicationName("CloudRenamer");
     Widget w;
     w.show();
     return a.exec();
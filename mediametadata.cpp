@@ -0,0 +1,693 @@
+#include "mediametadata.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QTimeZone>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    // 每个读取任务处理的文件数
+    const int readChunkSize = 32;
+
+    // 缓存条目上限，超过时清空重建
+    const int maxCacheEntries = 200000;
+
+    const quint32 cacheMagic = 0x434e4d44;   // "CNMD"
+    const quint32 cacheVersion = 2;         // 文件头之后直到文件末尾都是条目，新条目追加在末尾
+
+    // 单个Exif段最大64KB
+    const int maxExifSize = 65535;
+
+    /**
+     * @brief 缓存键：文件身份加大小和修改时间，任何一项变化都视为新文件
+     */
+    struct FileKey
+    {
+        quint64 device = 0;
+        quint64 inode = 0;
+        qint64 size = 0;
+        qint64 mtime = 0;       // 纳秒
+
+        bool operator==(const FileKey& other) const
+        {
+            return device == other.device && inode == other.inode && size == other.size && mtime == other.mtime;
+        }
+    };
+
+    size_t qHash(const FileKey& key, size_t seed = 0)
+    {
+        return qHashMulti(seed, key.device, key.inode, key.size, key.mtime);
+    }
+
+    // 取文件的缓存键和修改时间，只做一次stat
+    bool statFile(const QString& path, FileKey* key, QDateTime* modified)
+    {
+#ifdef Q_OS_UNIX
+        struct stat st;
+        if(::stat(QFile::encodeName(path).constData(), &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            return false;
+        }
+#ifdef Q_OS_DARWIN
+        const struct timespec& mtime = st.st_mtimespec;
+#else
+        const struct timespec& mtime = st.st_mtim;
+#endif
+        key->device = quint64(st.st_dev);
+        key->inode = quint64(st.st_ino);
+        key->size = qint64(st.st_size);
+        key->mtime = qint64(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+        *modified = QDateTime::fromMSecsSinceEpoch(qint64(mtime.tv_sec) * 1000 + mtime.tv_nsec / 1000000);
+        return true;
+#else
+        // 没有inode时以路径代替
+        QFileInfo info(path);
+        if(!info.isFile())
+        {
+            return false;
+        }
+        key->inode = ::qHash(info.absoluteFilePath());
+        key->size = info.size();
+        *modified = info.lastModified();
+        key->mtime = modified->toMSecsSinceEpoch() * 1000000;
+        return true;
+#endif
+    }
+
+    /**
+     * @brief 进程内共享的元数据缓存，首次使用时从磁盘读取
+     *
+     * 保存时只把新条目追加到文件末尾，每次保存的开销与新读取的文件数成正比，与缓存大小无关；
+     * 清空、文件损坏或过期条目过多时才整体重写。
+     */
+    class MetadataCache
+    {
+    public:
+        static MetadataCache& instance()
+        {
+            static MetadataCache cache;
+            return cache;
+        }
+
+        bool find(const FileKey& key, MediaMetadata* metadata)
+        {
+            QMutexLocker locker(&mutex);
+            load();
+            auto it = entries.constFind(key);
+            if(it == entries.constEnd())
+            {
+                return false;
+            }
+            *metadata = it.value();
+            return true;
+        }
+
+        void insert(const FileKey& key, const MediaMetadata& metadata)
+        {
+            QMutexLocker locker(&mutex);
+            load();
+            if(entries.size() >= maxCacheEntries)
+            {
+                entries.clear();
+                added.clear();
+                rewrite = true;
+            }
+            entries.insert(key, metadata);
+            added.append(key);
+        }
+
+        void save()
+        {
+            QMutexLocker locker(&mutex);
+            // 文件中的条目（含已被替换的）远多于缓存时整体重写，避免文件无限增长
+            if(rewrite || fileRecords > 2 * qint64(entries.size()) + maxCacheEntries / 10)
+            {
+                saveAll();
+            }
+            else
+                if(!added.isEmpty())
+                {
+                    appendAdded();
+                }
+        }
+
+    private:
+        static QString path()
+        {
+            QString base = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+            QDir().mkpath(base);
+            return base + "/metadata.cache";
+        }
+
+        static void writeRecord(QDataStream& out, const FileKey& key, const MediaMetadata& metadata)
+        {
+            out << key.device << key.inode << key.size << key.mtime
+                << (metadata.captureTime.isValid() ? metadata.captureTime.toMSecsSinceEpoch() : qint64(-1))
+                << metadata.cameraModel << qint32(metadata.duration);
+        }
+
+        // 调用时需持有锁
+        void saveAll()
+        {
+            QSaveFile file(path());
+            if(!file.open(QIODevice::WriteOnly))
+            {
+                qWarning() << "Failed to write metadata cache:" << file.fileName();
+                return;
+            }
+            QDataStream out(&file);
+            out.setVersion(QDataStream::Qt_6_0);
+            out << cacheMagic << cacheVersion;
+            for(auto it = entries.constBegin(); it != entries.constEnd(); ++it)
+            {
+                writeRecord(out, it.key(), it.value());
+            }
+            if(out.status() == QDataStream::Ok && file.commit())
+            {
+                rewrite = false;
+                added.clear();
+                fileRecords = entries.size();
+            }
+        }
+
+        // 调用时需持有锁
+        void appendAdded()
+        {
+            QFile file(path());
+            if(!file.open(QIODevice::WriteOnly | QIODevice::Append))
+            {
+                qWarning() << "Failed to write metadata cache:" << file.fileName();
+                return;
+            }
+            QDataStream out(&file);
+            out.setVersion(QDataStream::Qt_6_0);
+            for(const FileKey& key : std::as_const(added))
+            {
+                auto it = entries.constFind(key);
+                if(it != entries.constEnd())
+                {
+                    writeRecord(out, key, it.value());
+                }
+            }
+            file.close();
+            if(out.status() != QDataStream::Ok || file.error() != QFileDevice::NoError)
+            {
+                // 末尾可能留下不完整的条目，下次整体重写
+                qWarning() << "Failed to write metadata cache:" << file.fileName();
+                rewrite = true;
+                return;
+            }
+            fileRecords += added.size();
+            added.clear();
+        }
+
+        // 调用时需持有锁
+        void load()
+        {
+            if(loaded)
+            {
+                return;
+            }
+            loaded = true;
+            // 没有可用的文件时，第一次保存写出完整的文件（含文件头）
+            rewrite = true;
+            QFile file(path());
+            if(!file.open(QIODevice::ReadOnly))
+            {
+                return;
+            }
+            QDataStream in(&file);
+            in.setVersion(QDataStream::Qt_6_0);
+            quint32 magic, version;
+            in >> magic >> version;
+            if(in.status() != QDataStream::Ok || magic != cacheMagic || version != cacheVersion)
+            {
+                return;
+            }
+            rewrite = false;
+            while(!in.atEnd())
+            {
+                FileKey key;
+                qint64 capture;
+                qint32 duration;
+                MediaMetadata metadata;
+                in >> key.device >> key.inode >> key.size >> key.mtime >> capture >> metadata.cameraModel >> duration;
+                if(in.status() != QDataStream::Ok)
+                {
+                    // 末尾的条目写入时被中断：保留之前的条目，下次整体重写
+                    rewrite = true;
+                    break;
+                }
+                if(capture >= 0)
+                {
+                    metadata.captureTime = QDateTime::fromMSecsSinceEpoch(capture);
+                }
+                metadata.duration = duration;
+                // 同一个键后写入的条目覆盖先写入的
+                entries.insert(key, metadata);
+                fileRecords++;
+            }
+            if(entries.size() > maxCacheEntries)
+            {
+                entries.clear();
+                rewrite = true;
+            }
+        }
+
+        QMutex mutex;
+        QHash<FileKey, MediaMetadata> entries;
+        QVector<FileKey> added;     // 尚未写入文件的条目
+        qint64 fileRecords = 0;     // 文件中的条目数，含已被替换的
+        bool loaded = false;
+        bool rewrite = false;       // 下次保存时整体重写
+    };
+
+    quint32 readBig32(const uchar* p)
+    {
+        return (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | quint32(p[3]);
+    }
+
+    quint64 readBig64(const uchar* p)
+    {
+        return (quint64(readBig32(p)) << 32) | readBig32(p + 4);
+    }
+
+    /**
+     * @brief Exif（TIFF结构）解析
+     */
+    class ExifParser
+    {
+    public:
+        explicit ExifParser(const QByteArray& tiff)
+            : data(reinterpret_cast<const uchar*>(tiff.constData())), size(quint32(tiff.size()))
+        {}
+
+        bool parse(MediaMetadata* metadata)
+        {
+            if(size < 8)
+            {
+                return false;
+            }
+            if(data[0] == 'I' && data[1] == 'I')
+            { littleEndian = true; }
+            else
+                if(data[0] == 'M' && data[1] == 'M')
+                { littleEndian = false; }
+                else
+                { return false; }
+            if(read16(2) != 42)
+            {
+                return false;
+            }
+            QString dateTime;
+            QString original;
+            quint32 exifOffset = 0;
+            // IFD0：相机型号、修改时间和Exif子IFD的位置
+            forEachEntry(read32(4), [&](quint32 entry, quint16 tag)
+            {
+                if(tag == 0x0110)
+                { metadata->cameraModel = readAscii(entry); }
+                else
+                    if(tag == 0x0132)
+                    { dateTime = readAscii(entry); }
+                    else
+                        if(tag == 0x8769)
+                        { exifOffset = read32(entry + 8); }
+            });
+            // Exif子IFD：拍摄时间
+            if(exifOffset != 0)
+            {
+                forEachEntry(exifOffset, [&](quint32 entry, quint16 tag)
+                {
+                    if(tag == 0x9003 || (tag == 0x9004 && original.isEmpty()))
+                    { original = readAscii(entry); }
+                });
+            }
+            // Exif中的时间没有时区，按本地时间处理
+            QDateTime capture = QDateTime::fromString(original.isEmpty() ? dateTime : original, "yyyy:MM:dd HH:mm:ss");
+            if(capture.isValid())
+            {
+                metadata->captureTime = capture;
+            }
+            return true;
+        }
+
+    private:
+        quint16 read16(quint32 offset) const
+        {
+            if(offset > size || size - offset < 2)
+            { return 0; }
+            const uchar* p = data + offset;
+            return littleEndian ? quint16(p[0] | (p[1] << 8)) : quint16((p[0] << 8) | p[1]);
+        }
+
+        quint32 read32(quint32 offset) const
+        {
+            if(offset > size || size - offset < 4)
+            { return 0; }
+            const uchar* p = data + offset;
+            return littleEndian ? (quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24))
+                                : readBig32(p);
+        }
+
+        template<typename Visitor>
+        void forEachEntry(quint32 offset, Visitor visit) const
+        {
+            // 偏移来自文件内容，先检查范围
+            if(offset == 0 || offset > size || size - offset < 2)
+            {
+                return;
+            }
+            quint32 count = read16(offset);
+            // 条目数不能超出数据范围
+            count = qMin(count, (size - offset - 2) / 12);
+            for(quint32 i = 0; i < count; i++)
+            {
+                quint32 entry = offset + 2 + 12 * i;
+                visit(entry, read16(entry));
+            }
+        }
+
+        QString readAscii(quint32 entry) const
+        {
+            // 类型2为ASCII，不超过4字节时直接存放在条目中
+            if(read16(entry + 2) != 2)
+            {
+                return QString();
+            }
+            quint32 count = read32(entry + 4);
+            quint32 offset = count <= 4 ? entry + 8 : read32(entry + 8);
+            if(count == 0 || offset >= size || count > size - offset)
+            {
+                return QString();
+            }
+            QByteArray text(reinterpret_cast<const char*>(data + offset), int(count));
+            int terminator = text.indexOf('\0');
+            if(terminator >= 0)
+            {
+                text.truncate(terminator);
+            }
+            return QString::fromUtf8(text).trimmed();
+        }
+
+        const uchar* data;
+        quint32 size;
+        bool littleEndian = false;
+    };
+
+    // 逐段跳读JPEG，只读取段头和APP1（Exif）段
+    void readJpeg(QFile& file, MediaMetadata* metadata)
+    {
+        if(!file.seek(2))
+        {
+            return;
+        }
+        while(true)
+        {
+            uchar marker[2];
+            if(file.read(reinterpret_cast<char*>(marker), 2) != 2 || marker[0] != 0xFF)
+            {
+                return;
+            }
+            // 跳过填充字节
+            while(marker[1] == 0xFF)
+            {
+                if(!file.getChar(reinterpret_cast<char*>(&marker[1])))
+                {
+                    return;
+                }
+            }
+            uchar type = marker[1];
+            // 到达图像数据或文件结尾，后面不会再有Exif
+            if(type == 0xDA || type == 0xD9)
+            {
+                return;
+            }
+            // 没有长度字段的独立标记
+            if(type == 0x01 || (type >= 0xD0 && type <= 0xD7))
+            {
+                continue;
+            }
+            uchar lengthBytes[2];
+            if(file.read(reinterpret_cast<char*>(lengthBytes), 2) != 2)
+            {
+                return;
+            }
+            int length = ((lengthBytes[0] << 8) | lengthBytes[1]) - 2;
+            if(length < 0)
+            {
+                return;
+            }
+            if(type == 0xE1 && length > 6 && length <= maxExifSize)
+            {
+                QByteArray payload = file.read(length);
+                if(payload.startsWith(QByteArray("Exif\0\0", 6)))
+                {
+                    ExifParser(payload.mid(6)).parse(metadata);
+                    return;
+                }
+                // 其他APP1段（如XMP）已读过，继续找下一段
+                continue;
+            }
+            if(!file.seek(file.pos() + length))
+            {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief 在[begin, end)范围内查找指定类型的box
+     * @return box内容的起始位置和结束位置，找不到时返回false
+     */
+    bool findBox(QFile& file, qint64 begin, qint64 end, const char* wanted, qint64* contentBegin, qint64* contentEnd)
+    {
+        qint64 pos = begin;
+        while(pos + 8 <= end)
+        {
+            uchar header[16];
+            if(!file.seek(pos) || file.read(reinterpret_cast<char*>(header), 8) != 8)
+            {
+                return false;
+            }
+            quint64 boxSize = readBig32(header);
+            qint64 headerSize = 8;
+            if(boxSize == 1)
+            {
+                // 64位长度
+                if(file.read(reinterpret_cast<char*>(header + 8), 8) != 8)
+                {
+                    return false;
+                }
+                boxSize = readBig64(header + 8);
+                headerSize = 16;
+            }
+            else
+                if(boxSize == 0)
+                {
+                    boxSize = quint64(end - pos);
+                }
+            if(boxSize < quint64(headerSize) || boxSize > quint64(end - pos))
+            {
+                return false;
+            }
+            if(std::memcmp(header + 4, wanted, 4) == 0)
+            {
+                *contentBegin = pos + headerSize;
+                *contentEnd = pos + qint64(boxSize);
+                return true;
+            }
+            // 直接跳过，不读取box内容（mdat可能有数GB）
+            pos += qint64(boxSize);
+        }
+        return false;
+    }
+
+    // 读取MP4/MOV的moov/mvhd：创建时间和时长
+    void readIsoMedia(QFile& file, MediaMetadata* metadata)
+    {
+        qint64 moovBegin, moovEnd, mvhdBegin, mvhdEnd;
+        if(!findBox(file, 0, file.size(), "moov", &moovBegin, &moovEnd)
+           || !findBox(file, moovBegin, moovEnd, "mvhd", &mvhdBegin, &mvhdEnd))
+        {
+            return;
+        }
+        if(!file.seek(mvhdBegin))
+        {
+            return;
+        }
+        QByteArray box = file.read(qMin<qint64>(mvhdEnd - mvhdBegin, 32));
+        const uchar* p = reinterpret_cast<const uchar*>(box.constData());
+        quint64 creation, duration;
+        quint32 timescale;
+        if(box.size() >= 32 && p[0] == 1)
+        {
+            creation = readBig64(p + 4);
+            timescale = readBig32(p + 20);
+            duration = readBig64(p + 24);
+        }
+        else
+            if(box.size() >= 20 && p[0] == 0)
+            {
+                creation = readBig32(p + 4);
+                timescale = readBig32(p + 12);
+                duration = readBig32(p + 16);
+            }
+            else
+            {
+                return;
+            }
+        // 创建时间自1904年起计（UTC），为0表示未填写
+        if(creation != 0)
+        {
+            QDateTime epoch(QDate(1904, 1, 1), QTime(0, 0), QTimeZone::UTC);
+            metadata->captureTime = epoch.addSecs(qint64(creation)).toLocalTime();
+        }
+        if(timescale != 0)
+        {
+            metadata->duration = int(duration / timescale);
+        }
+    }
+
+    // 代入的值中不能出现在文件名里的字符，以及格式中用作分隔的下划线
+    QString sanitize(const QString& value)
+    {
+        QString result = value;
+        for(QChar& c : result)
+        {
+            if(c.unicode() < 0x20 || QStringLiteral("\\/:*?\"<>|_").contains(c))
+            {
+                c = u'-';
+            }
+        }
+        result = result.trimmed();
+        return result.isEmpty() ? QStringLiteral("Unknown") : result;
+    }
+} // namespace
+
+MediaMetadata MetadataReader::read(const QString& filePath)
+{
+    MediaMetadata result;
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return result;
+    }
+    QByteArray head = file.read(12);
+    if(head.startsWith("\xFF\xD8\xFF"))
+    {
+        readJpeg(file, &result);
+    }
+    else
+        if(head.size() >= 8 && head.mid(4, 4) == "ftyp")
+        {
+            readIsoMedia(file, &result);
+        }
+    return result;
+}
+
+QVector<MediaMetadata> MetadataReader::readAll(const QString& directory, const QStringList& fileNames, int maxThreads)
+{
+    QVector<MediaMetadata> result(fileNames.size());
+    if(fileNames.isEmpty())
+    {
+        return result;
+    }
+    MetadataCache& cache = MetadataCache::instance();
+    const QString base = QDir(directory).absolutePath() + "/";
+    MediaMetadata* out = result.data();
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, maxThreads));
+    for(int begin = 0; begin < fileNames.size(); begin += readChunkSize)
+    {
+        int end = qMin(begin + readChunkSize, int(fileNames.size()));
+        pool.start([&cache, &base, &fileNames, out, begin, end]()
+        {
+            for(int i = begin; i < end; i++)
+            {
+                QString path = base + fileNames[i];
+                FileKey key;
+                QDateTime modified;
+                if(!statFile(path, &key, &modified))
+                {
+                    continue;
+                }
+                MediaMetadata metadata;
+                if(!cache.find(key, &metadata))
+                {
+                    metadata = read(path);
+                    cache.insert(key, metadata);
+                }
+                metadata.modifiedTime = modified;
+                out[i] = metadata;
+            }
+        });
+    }
+    pool.waitForDone();
+    cache.save();
+    return result;
+}
+
+bool MetadataReader::hasTokens(const QString& text)
+{
+    static const QRegularExpression token(R"(%\{(date|time|camera|duration)(:[^}]*)?\})");
+    return text.contains(token);
+}
+
+QString MetadataReader::expand(const QString& text, const MediaMetadata& metadata)
+{
+    QString result;
+    int pos = 0;
+    while(true)
+    {
+        int start = text.indexOf("%{", pos);
+        if(start < 0)
+        {
+            break;
+        }
+        int close = text.indexOf('}', start + 2);
+        if(close < 0)
+        {
+            break;
+        }
+        result += text.mid(pos, start - pos);
+        QString token = text.mid(start + 2, close - start - 2);
+        int colon = token.indexOf(':');
+        QString name = colon < 0 ? token : token.left(colon);
+        QString argument = colon < 0 ? QString() : token.mid(colon + 1);
+        QDateTime time = metadata.captureTime.isValid() ? metadata.captureTime : metadata.modifiedTime;
+        if(name == "date")
+        { result += sanitize(time.toString(argument.isEmpty() ? "yyyyMMdd" : argument)); }
+        else
+            if(name == "time")
+            { result += sanitize(time.toString(argument.isEmpty() ? "hhmmss" : argument)); }
+            else
+                if(name == "camera")
+                { result += sanitize(metadata.cameraModel); }
+                else
+                    if(name == "duration")
+                    { result += QString::number(qMax(0, metadata.duration)); }
+                    else
+                    {
+                        // 不认识的占位符原样保留
+                        result += text.mid(start, close - start + 1);
+                    }
+        pos = close + 1;
+    }
+    result += text.mid(pos);
+    return result;
+}
@@ -0,0 +1,77 @@
+#ifndef MEDIAMETADATA_H
+#define MEDIAMETADATA_H
+
+/******************************************************************************
+ * @file       mediametadata.h
+ * @brief      从照片和视频的文件头中读取拍摄时间、相机型号和时长
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief 媒体文件的元数据
+ */
+struct MediaMetadata
+{
+    QDateTime captureTime;      // 拍摄时间（本地时间），无法读取时无效
+    QDateTime modifiedTime;     // 文件修改时间，没有拍摄时间时代替
+    QString cameraModel;        // 相机型号
+    int duration = -1;          // 视频时长（秒），无法读取时为-1
+};
+
+/**
+ * @brief 元数据读取器
+ *
+ * 只按结构跳读文件头：JPEG逐段读取段头，直到APP1（Exif）；MP4/MOV逐个跳过顶层box，
+ * 只读取moov中的mvhd，不会读取图像或视频数据本身。
+ * 读取结果按（inode、大小、修改时间）缓存在应用数据目录中，文件未变时不再打开。
+ *
+ * 命名内容中可使用以下占位符，按文件分别代入：
+ * %{date}、%{date:MMdd}  拍摄日期（没有时取修改日期），冒号后为日期格式，默认yyyyMMdd
+ * %{time}、%{time:hhmm}  拍摄时间，默认hhmmss
+ * %{camera}              相机型号，没有时为Unknown
+ * %{duration}            视频时长（秒），没有时为0
+ */
+class MetadataReader
+{
+public:
+    /**
+     * @brief 读取单个文件的元数据（不使用缓存）
+     * @param filePath          文件路径
+     * @return 元数据
+     */
+    static MediaMetadata read(const QString& filePath);
+
+    /**
+     * @brief 并行读取一批文件的元数据，优先使用缓存
+     * @param directory         目录
+     * @param fileNames         文件名列表
+     * @param maxThreads        同时读取的最大线程数
+     * @return 与文件名列表一一对应的元数据
+     */
+    static QVector<MediaMetadata> readAll(const QString& directory, const QStringList& fileNames, int maxThreads = 8);
+
+    /**
+     * @brief 文本中是否含有元数据占位符
+     * @param text              文本
+     * @return 含有时返回true
+     */
+    static bool hasTokens(const QString& text);
+
+    /**
+     * @brief 代入元数据占位符，代入的值中不能出现在文件名里的字符（以及下划线）替换为“-”
+     * @param text              文本
+     * @param metadata          元数据
+     * @return 代入后的文本
+     */
+    static QString expand(const QString& text, const MediaMetadata& metadata);
+};
+
+#endif // MEDIAMETADATA_H
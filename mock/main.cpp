@@ -0,0 +1,44 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+#include "seafilemockserver.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serve a local directory through the subset of the Seafile web API used by rename_cli.");
+    parser.addHelpOption();
+    QCommandLineOption portOption("port", "Port to listen on (default 8000, 0 picks a free port).", "port", "8000");
+    QCommandLineOption tokenOption("token", "API token clients must send (default mock-token).", "token", "mock-token");
+    QCommandLineOption repoOption("repo", "Library ID to accept; any ID is accepted when omitted.", "id");
+    QCommandLineOption latencyOption("latency", "Delay every response by the given milliseconds.", "ms", "0");
+    QCommandLineOption failOption("fail-rate", "Answer this fraction of requests (0-1) with 503 before touching any file.",
+                                  "rate", "0");
+    parser.addOptions({portOption, tokenOption, repoOption, latencyOption, failOption});
+    parser.addPositionalArgument("directory", "Directory served as the library.", "<directory>");
+    parser.process(a);
+
+    QTextStream err(stderr);
+    if(parser.positionalArguments().size() != 1)
+    {
+        err << "Expected exactly one directory.\n";
+        return 2;
+    }
+    SeafileMockServer::Options options;
+    options.root = parser.positionalArguments().first();
+    options.repo = parser.value(repoOption);
+    options.token = parser.value(tokenOption);
+    options.latency = qMax(0, parser.value(latencyOption).toInt());
+    options.failRate = qBound(0.0, parser.value(failOption).toDouble(), 1.0);
+    SeafileMockServer server(options);
+    QString error;
+    if(!server.listen(quint16(parser.value(portOption).toUInt()), &error))
+    {
+        err << error << "\n";
+        return 1;
+    }
+    err << "Serving " << options.root << " on http://127.0.0.1:" << server.port() << "\n";
+    err.flush();
+    return a.exec();
+}
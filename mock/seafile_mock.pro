@@ -0,0 +1,14 @@
+QT       = core network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = seafile_mock
+
+# A stand-in for the Seafile web API that serves a local directory, for testing the remote backend offline.
+SOURCES += \
+    main.cpp \
+    seafilemockserver.cpp
+
+HEADERS += \
+    seafilemockserver.h
@@ -0,0 +1,275 @@
+#include "seafilemockserver.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+
+namespace
+{
+    QByteArray reason(int status)
+    {
+        switch(status)
+        {
+            case 200:
+                return "OK";
+            case 400:
+                return "Bad Request";
+            case 401:
+                return "Unauthorized";
+            case 404:
+                return "Not Found";
+            case 405:
+                return "Method Not Allowed";
+            case 409:
+                return "Conflict";
+            case 503:
+                return "Service Unavailable";
+            default:
+                return "Error";
+        }
+    }
+
+    QByteArray errorBody(const QString& message)
+    {
+        return QJsonDocument(QJsonObject{{"error_msg", message}}).toJson(QJsonDocument::Compact);
+    }
+
+    QJsonObject describe(const QFileInfo& info)
+    {
+        QJsonObject result;
+        result["type"] = info.isDir() ? "dir" : "file";
+        result["name"] = info.fileName();
+        result["obj_name"] = info.fileName();
+        result["mtime"] = info.lastModified().toSecsSinceEpoch();
+        if(!info.isDir())
+        {
+            result["size"] = info.size();
+        }
+        return result;
+    }
+} // namespace
+
+SeafileMockServer::SeafileMockServer(const Options& options, QObject *parent)
+    : QObject(parent)
+    , options(options)
+{
+    this->options.root = QDir(options.root).absolutePath();
+    connect(&server, &QTcpServer::newConnection, this, &SeafileMockServer::accept);
+}
+
+bool SeafileMockServer::listen(quint16 port, QString* error)
+{
+    if(!QDir(options.root).exists())
+    {
+        *error = "Directory does not exist: " + options.root;
+        return false;
+    }
+    if(!server.listen(QHostAddress::LocalHost, port))
+    {
+        *error = server.errorString();
+        return false;
+    }
+    return true;
+}
+
+quint16 SeafileMockServer::port() const
+{
+    return server.serverPort();
+}
+
+void SeafileMockServer::accept()
+{
+    while(QTcpSocket* socket = server.nextPendingConnection())
+    {
+        buffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]()
+        {
+            readRequests(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]()
+        {
+            buffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void SeafileMockServer::readRequests(QTcpSocket* socket)
+{
+    QByteArray& buffer = buffers[socket];
+    buffer += socket->readAll();
+    // 长连接上可能连续到达多个请求
+    while(true)
+    {
+        int headerEnd = buffer.indexOf("\r\n\r\n");
+        if(headerEnd < 0)
+        {
+            return;
+        }
+        QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+        if(requestLine.size() != 3)
+        {
+            respond(socket, 400, errorBody("Malformed request line."), true);
+            return;
+        }
+        Request request;
+        request.method = requestLine[0];
+        request.target = requestLine[1];
+        for(const QByteArray& line : std::as_const(lines))
+        {
+            int colon = line.indexOf(':');
+            if(colon > 0)
+            {
+                request.headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+            }
+        }
+        int length = request.headers.value("content-length", "0").toInt();
+        if(buffer.size() < headerEnd + 4 + length)
+        {
+            return;
+        }
+        request.body = buffer.mid(headerEnd + 4, length);
+        buffer.remove(0, headerEnd + 4 + length);
+        bool close = request.headers.value("connection").toLower() == "close" || requestLine[2] == "HTTP/1.0";
+        int status = 200;
+        QByteArray body = handle(request, &status);
+        respond(socket, status, body, close);
+        if(close)
+        {
+            return;
+        }
+    }
+}
+
+QByteArray SeafileMockServer::handle(const Request& request, int* status)
+{
+    static const QRegularExpression route("^/api/v2\\.1/repos/([^/]+)/(dir|file)/$");
+    QUrl url(QString::fromLatin1(request.target));
+    QRegularExpressionMatch match = route.match(url.path());
+    if(!match.hasMatch())
+    {
+        *status = 404;
+        return errorBody("Not found.");
+    }
+    if(request.headers.value("authorization") != "Token " + options.token.toUtf8())
+    {
+        *status = 401;
+        return errorBody("Invalid token.");
+    }
+    if(!options.repo.isEmpty() && match.captured(1) != options.repo)
+    {
+        *status = 404;
+        return errorBody("Library not found.");
+    }
+    // 模拟服务器过载，在修改任何文件之前返回
+    if(options.failRate > 0 && QRandomGenerator::global()->generateDouble() < options.failRate)
+    {
+        *status = 503;
+        return errorBody("Service unavailable.");
+    }
+    QString path = QUrlQuery(url).queryItemValue("p", QUrl::FullyDecoded);
+    QString local;
+    if(!localPath(path, &local))
+    {
+        *status = 400;
+        return errorBody("Invalid path.");
+    }
+    QFileInfo info(local);
+    if(match.captured(2) == "dir")
+    {
+        if(request.method != "GET")
+        {
+            *status = 405;
+            return errorBody("Method not allowed.");
+        }
+        if(!info.isDir())
+        {
+            *status = 404;
+            return errorBody("Folder not found.");
+        }
+        QJsonArray entries;
+        const QFileInfoList children = QDir(local).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        for(const QFileInfo& child : children)
+        {
+            entries.append(describe(child));
+        }
+        return QJsonDocument(QJsonObject{{"dirent_list", entries}}).toJson(QJsonDocument::Compact);
+    }
+    if(request.method == "GET")
+    {
+        if(!info.isFile())
+        {
+            *status = 404;
+            return errorBody("File not found.");
+        }
+        return QJsonDocument(describe(info)).toJson(QJsonDocument::Compact);
+    }
+    if(request.method != "POST")
+    {
+        *status = 405;
+        return errorBody("Method not allowed.");
+    }
+    QUrlQuery form(QString::fromUtf8(request.body));
+    QString newName = form.queryItemValue("newname", QUrl::FullyDecoded);
+    if(form.queryItemValue("operation") != "rename" || newName.isEmpty() || newName.contains('/')
+        || newName == "." || newName == "..")
+    {
+        *status = 400;
+        return errorBody("Invalid operation or name.");
+    }
+    if(!info.isFile())
+    {
+        *status = 404;
+        return errorBody("File not found.");
+    }
+    QString target = info.absolutePath() + "/" + newName;
+    if(QFileInfo::exists(target) || QFileInfo(target).isSymLink())
+    {
+        *status = 409;
+        return errorBody("Name already exists.");
+    }
+    if(!QFile::rename(local, target))
+    {
+        *status = 500;
+        return errorBody("Failed to rename.");
+    }
+    return QJsonDocument(describe(QFileInfo(target))).toJson(QJsonDocument::Compact);
+}
+
+bool SeafileMockServer::localPath(const QString& path, QString* local) const
+{
+    if(!path.startsWith('/'))
+    {
+        return false;
+    }
+    *local = QDir::cleanPath(options.root + path);
+    return *local == options.root || local->startsWith(options.root + "/");
+}
+
+void SeafileMockServer::respond(QTcpSocket* socket, int status, const QByteArray& body, bool close)
+{
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + " " + reason(status) + "\r\n"
+                          "Content-Type: application/json\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += close ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    response += body;
+    // 文件操作已经完成，只推迟响应；同一连接上的延迟相同，响应顺序不变
+    QTimer::singleShot(options.latency, socket, [socket, response, close]()
+    {
+        socket->write(response);
+        if(close)
+        {
+            socket->disconnectFromHost();
+        }
+    });
+}
@@ -0,0 +1,118 @@
+#ifndef SEAFILEMOCKSERVER_H
+#define SEAFILEMOCKSERVER_H
+
+/******************************************************************************
+ * @file       seafilemockserver.h
+ * @brief      用本地目录模拟Seafile Web API的HTTP服务器，用于离线测试
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QTcpServer>
+
+class QTcpSocket;
+
+/**
+ * @brief Seafile模拟服务器
+ *
+ * 只实现重命名工具用到的接口，资料库对应一个本地目录：
+ * GET /api/v2.1/repos/{资料库}/dir/?p=目录 列目录，GET .../file/?p=路径 查询文件，
+ * POST .../file/?p=路径（operation=rename&newname=新名称）重命名，目标已存在时返回409。
+ * 支持HTTP/1.1长连接；可以给每个响应加上延迟、按比例返回503，以检验并发和重试。
+ */
+class SeafileMockServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 服务器选项
+     */
+    struct Options
+    {
+        QString root;               // 作为资料库的本地目录
+        QString repo;               // 资料库ID，为空时接受任意ID
+        QString token;              // API令牌
+        int latency = 0;            // 每个响应的延迟（毫秒）
+        double failRate = 0;        // 返回503的比例
+    };
+
+    /**
+     * @brief 构造函数
+     * @param options           服务器选项
+     * @param parent            父对象
+     */
+    explicit SeafileMockServer(const Options& options, QObject *parent = nullptr);
+
+    /**
+     * @brief 开始监听本机地址
+     * @param port              端口，为0时自动选择
+     * @param error             失败时的错误信息
+     * @return 成功时返回true
+     */
+    bool listen(quint16 port, QString* error);
+
+    /**
+     * @brief 实际监听的端口
+     */
+    quint16 port() const;
+
+private:
+    /**
+     * @brief 解析后的请求
+     */
+    struct Request
+    {
+        QByteArray method;
+        QByteArray target;
+        QHash<QByteArray, QByteArray> headers;  // 名称为小写
+        QByteArray body;
+    };
+
+    /**
+     * @brief 接受新连接
+     */
+    void accept();
+
+    /**
+     * @brief 从连接中取出完整的请求逐个处理
+     * @param socket            连接
+     */
+    void readRequests(QTcpSocket* socket);
+
+    /**
+     * @brief 处理请求
+     * @param request           请求
+     * @param status            返回HTTP状态码
+     * @return 响应内容（JSON）
+     */
+    QByteArray handle(const Request& request, int* status);
+
+    /**
+     * @brief 资料库路径对应的本地路径
+     * @param path              资料库中的路径
+     * @param local             返回本地路径
+     * @return 路径在资料库内时返回true
+     */
+    bool localPath(const QString& path, QString* local) const;
+
+    /**
+     * @brief 写出响应
+     * @param socket            连接
+     * @param status            HTTP状态码
+     * @param body              响应内容
+     * @param close             写出后是否关闭连接
+     */
+    void respond(QTcpSocket* socket, int status, const QByteArray& body, bool close);
+
+    Options options;
+    QTcpServer server;
+    QHash<QTcpSocket*, QByteArray> buffers;     // 各连接尚未处理的数据
+};
+
+#endif // SEAFILEMOCKSERVER_H
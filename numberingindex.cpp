@@ -0,0 +1,156 @@
+#include "numberingindex.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+    const quint32 indexMagic = 0x434e4958;   // "CNIX"
+    const quint32 indexVersion = 1;
+
+    // 目录修改时间的精度最粗为2秒（FAT），距今不足此值的修改时间可能与随后的修改相同
+    const qint64 racyInterval = 2000;
+} // namespace
+
+NumberingIndex::NumberingIndex(const QString& directory, const QString& key)
+    : directory(QDir::cleanPath(QDir(directory).absolutePath())), key(key)
+{
+    path = indexPath(directory, key);
+}
+
+QString NumberingIndex::makeKey(const QString& format, const QVector<QString> &replacements, const QString& extensionFilter,
+                                bool contentSniffing)
+{
+    // 以不会出现在文件名中的控制字符分隔各部分
+    QStringList parts;
+    parts.append(format);
+    parts.append(QStringList(replacements.begin(), replacements.end()).join(QChar(0x1f)));
+    parts.append(extensionFilter);
+    parts.append(contentSniffing ? "sniff" : "");
+    return parts.join(QChar(0x1e));
+}
+
+QString NumberingIndex::indexPath(const QString& directory, const QString& key)
+{
+    QString base = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/indexes";
+    QDir().mkpath(base);
+    QByteArray id = QCryptographicHash::hash((QDir::cleanPath(QDir(directory).absolutePath()) + QChar(0x1e) + key).toUtf8(),
+                                             QCryptographicHash::Sha1).toHex();
+    return base + "/" + QString::fromLatin1(id) + ".index";
+}
+
+qint64 NumberingIndex::directoryStamp(const QString& directory)
+{
+    QFileInfo info(directory);
+    if(!info.exists())
+    {
+        return -1;
+    }
+    qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    if(QDateTime::currentMSecsSinceEpoch() - modified < racyInterval)
+    {
+        return -1;
+    }
+    return modified;
+}
+
+bool NumberingIndex::load()
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version;
+    in >> magic >> version;
+    if(magic != indexMagic || version != indexVersion)
+    {
+        qWarning() << "Invalid numbering index:" << path;
+        return false;
+    }
+    QString storedDirectory, storedKey;
+    qint32 storedScanned, storedMatched, storedCandidates, storedMaximum;
+    in >> storedDirectory >> storedKey >> stamp
+       >> storedScanned >> storedMatched >> storedCandidates >> storedMaximum >> conforming;
+    // 路径哈希碰撞或文件损坏时放弃索引
+    if(in.status() != QDataStream::Ok || storedDirectory != directory || storedKey != key)
+    {
+        qWarning() << "Invalid numbering index:" << path;
+        conforming.clear();
+        candidates = -1;
+        return false;
+    }
+    scanned = storedScanned;
+    matched = storedMatched;
+    candidates = storedCandidates;
+    maximum = storedMaximum;
+    return true;
+}
+
+bool NumberingIndex::isUpToDate(qint64 currentStamp) const
+{
+    return candidates == 0 && currentStamp >= 0 && currentStamp == stamp;
+}
+
+bool NumberingIndex::lookup(const QString& fileName, int* number) const
+{
+    auto it = conforming.constFind(fileName);
+    if(it == conforming.constEnd())
+    {
+        return false;
+    }
+    *number = it.value();
+    return true;
+}
+
+bool NumberingIndex::save(qint64 scanStamp, const QHash<QString, int> &scanConforming, int scanScanned, int scanMatched,
+                          int scanCandidates, int scanMaxNumber)
+{
+    stamp = scanStamp;
+    conforming = scanConforming;
+    scanned = scanScanned;
+    matched = scanMatched;
+    candidates = scanCandidates;
+    maximum = scanMaxNumber;
+    // 先写临时文件再替换，中途退出不会留下半个索引
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Failed to write numbering index:" << path;
+        return false;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << indexMagic << indexVersion << directory << key << stamp
+        << qint32(scanned) << qint32(matched) << qint32(candidates) << qint32(maximum) << conforming;
+    if(out.status() != QDataStream::Ok || !file.commit())
+    {
+        qWarning() << "Failed to write numbering index:" << path;
+        return false;
+    }
+    return true;
+}
+
+int NumberingIndex::scannedCount() const
+{
+    return scanned;
+}
+
+int NumberingIndex::matchedCount() const
+{
+    return matched;
+}
+
+int NumberingIndex::maxNumber() const
+{
+    return maximum;
+}
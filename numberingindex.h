@@ -0,0 +1,121 @@
+#ifndef NUMBERINGINDEX_H
+#define NUMBERINGINDEX_H
+
+/******************************************************************************
+ * @file       numberingindex.h
+ * @brief      按目录保存的编号索引，重复运行时跳过已分类的文件
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief 编号索引
+ *
+ * 以“目录 + 格式 + 占位符 + 扩展名过滤器”为键，记录上次扫描时符合格式的文件名及其编号、
+ * 最大编号和目录的修改时间（位于应用数据目录，不写入云盘）。
+ * 文件名是否符合格式只取决于文件名本身和键，因此索引中的条目始终可以直接复用，
+ * 只有新出现的文件需要重新分类；目录修改时间未变且上次没有待重命名的文件时，可以完全跳过扫描。
+ */
+class NumberingIndex
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param directory         重命名目录
+     * @param key               格式、占位符和扩展名过滤器组成的键
+     */
+    NumberingIndex(const QString& directory, const QString& key);
+
+    /**
+     * @brief 由格式、占位符和扩展名过滤器生成键
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param extensionFilter   扩展名过滤器
+     * @param contentSniffing   是否按文件头识别
+     * @return 键
+     */
+    static QString makeKey(const QString& format, const QVector<QString> &replacements, const QString& extensionFilter,
+                           bool contentSniffing);
+
+    /**
+     * @brief 获取索引路径
+     * @param directory         重命名目录
+     * @param key               键
+     * @return 索引文件路径
+     */
+    static QString indexPath(const QString& directory, const QString& key);
+
+    /**
+     * @brief 读取目录的修改时间，应在枚举目录之前读取
+     * @param directory         目录
+     * @return 自纪元起的毫秒数；目录不存在，或修改时间距今太近、之后的修改可能得到相同的时间时返回-1
+     */
+    static qint64 directoryStamp(const QString& directory);
+
+    /**
+     * @brief 读取索引
+     * @return 索引存在、有效且键一致时返回true
+     */
+    bool load();
+
+    /**
+     * @brief 目录自上次扫描后是否未变化且没有待重命名的文件
+     * @param stamp             当前的目录修改时间
+     * @return 可以跳过扫描时返回true
+     */
+    bool isUpToDate(qint64 stamp) const;
+
+    /**
+     * @brief 查找已知符合格式的文件
+     * @param fileName          文件名
+     * @param number            查到时写入编号（没有编号时为-1）
+     * @return 查到时返回true
+     */
+    bool lookup(const QString& fileName, int* number) const;
+
+    /**
+     * @brief 用一次完整扫描的结果替换索引内容并写入磁盘
+     * @param stamp             扫描前读取的目录修改时间
+     * @param conforming        符合格式的文件及其编号
+     * @param scanned           扫描的文件数
+     * @param matched           通过扩展名过滤器的文件数
+     * @param candidates        需要重命名的文件数
+     * @param maxNumber         最大编号
+     * @return 成功时返回true
+     */
+    bool save(qint64 stamp, const QHash<QString, int> &conforming, int scanned, int matched, int candidates, int maxNumber);
+
+    /**
+     * @brief 上次扫描的文件数
+     */
+    int scannedCount() const;
+
+    /**
+     * @brief 上次通过扩展名过滤器的文件数
+     */
+    int matchedCount() const;
+
+    /**
+     * @brief 上次的最大编号
+     */
+    int maxNumber() const;
+
+private:
+    QString directory;
+    QString key;
+    QString path;
+    qint64 stamp = -1;              // 扫描前的目录修改时间
+    int scanned = 0;
+    int matched = 0;
+    int candidates = -1;            // 上次待重命名的文件数
+    int maximum = -1;
+    QHash<QString, int> conforming; // 符合格式的文件名及其编号
+};
+
+#endif // NUMBERINGINDEX_H
@@ -0,0 +1,468 @@
+#include "pipelinedrenamer.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// 需要5.16以上的内核头文件（IORING_OP_RENAMEAT、IORING_TIMEOUT_ETIME_SUCCESS）
+#ifdef IORING_TIMEOUT_ETIME_SUCCESS
+#define RENAMER_IO_URING
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <vector>
+#endif
+#endif
+#endif
+
+#ifdef RENAMER_IO_URING
+/**
+ * @brief 直接通过系统调用使用的io_uring（不依赖liburing）
+ */
+class PipelinedRenamer::Uring
+{
+public:
+    Uring() = default;
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    ~Uring()
+    {
+        if(sqes != MAP_FAILED)
+        {
+            ::munmap(sqes, sqesSize);
+        }
+        if(cqRing != MAP_FAILED && cqRing != sqRing)
+        {
+            ::munmap(cqRing, cqRingSize);
+        }
+        if(sqRing != MAP_FAILED)
+        {
+            ::munmap(sqRing, sqRingSize);
+        }
+        if(fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+
+    // 创建队列并确认内核支持IORING_OP_RENAMEAT，失败时返回errno
+    int open(unsigned entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = int(::syscall(__NR_io_uring_setup, entries, &params));
+        if(fd < 0)
+        {
+            return errno;
+        }
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if(singleMap)
+        {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if(sqRing == MAP_FAILED)
+        {
+            return errno;
+        }
+        cqRing = singleMap ? sqRing : ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                             fd, IORING_OFF_CQ_RING);
+        if(cqRing == MAP_FAILED)
+        {
+            return errno;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if(sqes == MAP_FAILED)
+        {
+            return errno;
+        }
+        char* sq = static_cast<char*>(sqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        // 5.11之前的内核没有RENAMEAT，提交后才会失败，事先探测
+        const unsigned probeOps = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + probeOps * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if(::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, probeOps) < 0)
+        {
+            return errno;
+        }
+        if(probe->last_op < IORING_OP_RENAMEAT || !(probe->ops[IORING_OP_RENAMEAT].flags & IO_URING_OP_SUPPORTED))
+        {
+            return ENOSYS;
+        }
+        return 0;
+    }
+
+    // 加入一个renameat2(RENAME_NOREPLACE)；delay非空时先链接一个定时器，到时后才开始重命名
+    void prepareRename(int dirfd, const char* from, const char* to, quint64 userData, const __kernel_timespec* delay)
+    {
+        if(delay)
+        {
+            io_uring_sqe* timeout = nextSqe();
+            timeout->opcode = IORING_OP_TIMEOUT;
+            timeout->fd = -1;
+            timeout->addr = reinterpret_cast<quint64>(delay);
+            timeout->len = 1;
+            // 定时器到时返回-ETIME，不视为失败，链接的重命名照常执行
+            timeout->timeout_flags = IORING_TIMEOUT_ETIME_SUCCESS;
+            timeout->flags = IOSQE_IO_LINK;
+            timeout->user_data = timerTag;
+        }
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_RENAMEAT;
+        sqe->fd = dirfd;
+        sqe->addr = reinterpret_cast<quint64>(from);
+        sqe->len = unsigned(dirfd);
+        sqe->addr2 = reinterpret_cast<quint64>(to);
+        sqe->rename_flags = RENAME_NOREPLACE;
+        sqe->user_data = userData;
+    }
+
+    // 一次系统调用提交全部新加入的操作，并等待至少minComplete个完成；失败时返回errno
+    int enter(unsigned minComplete)
+    {
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+        while(true)
+        {
+            long submitted = ::syscall(__NR_io_uring_enter, fd, unsubmitted, minComplete,
+                                       minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            calls++;
+            if(submitted >= 0)
+            {
+                unsubmitted -= unsigned(submitted);
+                return 0;
+            }
+            if(errno != EINTR)
+            {
+                return errno;
+            }
+        }
+    }
+
+    // 取出全部已完成的操作（顺序任意），跳过定时器
+    template<typename Callback>
+    void drain(Callback callback)
+    {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for(; head != tail; head++)
+        {
+            const io_uring_cqe& cqe = cqes[head & cqMask];
+            if(cqe.user_data != timerTag)
+            {
+                callback(cqe.user_data, cqe.res);
+            }
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    qint64 callCount() const
+    {
+        return calls;
+    }
+
+    __kernel_timespec delay = {0, 0};   // 模拟延迟时链接在重命名之前的定时器
+
+private:
+    io_uring_sqe* nextSqe()
+    {
+        unsigned index = localTail & sqMask;
+        io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + index;
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+        sqArray[index] = index;
+        localTail++;
+        unsubmitted++;
+        return sqe;
+    }
+
+    static constexpr quint64 timerTag = ~quint64(0);
+
+    int fd = -1;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    void* sqes = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned localTail = 0;     // 已加入但尚未对内核可见的队尾
+    unsigned unsubmitted = 0;   // 已加入但尚未提交的操作数
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    qint64 calls = 1;           // 含io_uring_setup
+};
+#else
+class PipelinedRenamer::Uring
+{
+};
+#endif
+
+PipelinedRenamer::PipelinedRenamer(const QString& directory, int depth, Engine engine)
+    : fallback(directory)
+    , queueDepth(qMax(1, depth))
+{
+#ifdef Q_OS_LINUX
+    if(engine == Engine::Serial)
+    {
+        return;
+    }
+    dirfd = ::open(QFile::encodeName(QDir(directory).absolutePath()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    calls++;
+    if(dirfd < 0)
+    {
+        qWarning() << "Failed to open directory, renaming one by one:" << directory << std::strerror(errno);
+        return;
+    }
+#ifdef RENAMER_IO_URING
+    if(engine == Engine::Auto || engine == Engine::IoUring)
+    {
+        // 每个重命名之前可能链接一个定时器，提交队列留出两倍的槽位
+        uring.reset(new Uring);
+        int error = uring->open(unsigned(queueDepth) * 2);
+        if(error == 0)
+        {
+            active = Engine::IoUring;
+            ringSlots.resize(queueDepth);
+            for(int i = queueDepth - 1; i >= 0; i--)
+            {
+                freeSlots.append(i);
+            }
+            return;
+        }
+        qWarning() << "io_uring is not available, using a thread pool:" << std::strerror(error);
+        uring.reset();
+    }
+#endif
+    active = Engine::Threads;
+    pool.setMaxThreadCount(queueDepth);
+#else
+    Q_UNUSED(engine);
+#endif
+}
+
+PipelinedRenamer::~PipelinedRenamer()
+{
+    // 线程中的重命名引用了本对象的成员，须在成员析构前结束
+    pool.waitForDone();
+#ifdef Q_OS_LINUX
+    if(dirfd >= 0)
+    {
+        ::close(dirfd);
+    }
+#endif
+}
+
+PipelinedRenamer::Engine PipelinedRenamer::engine() const
+{
+    return active;
+}
+
+int PipelinedRenamer::depth() const
+{
+    return queueDepth;
+}
+
+int PipelinedRenamer::pending() const
+{
+    return inFlight;
+}
+
+void PipelinedRenamer::setLatency(int microseconds)
+{
+    latency = qMax(0, microseconds);
+#ifdef RENAMER_IO_URING
+    if(uring)
+    {
+        uring->delay.tv_sec = latency / 1000000;
+        uring->delay.tv_nsec = (latency % 1000000) * 1000LL;
+    }
+#endif
+}
+
+void PipelinedRenamer::submit(int tag, const QString& oldName, const QString& newName)
+{
+    QByteArray from = QFile::encodeName(oldName);
+    QByteArray to = QFile::encodeName(newName);
+    inFlight++;
+#ifdef Q_OS_LINUX
+    if(noReplace)
+    {
+#ifdef RENAMER_IO_URING
+        if(active == Engine::IoUring)
+        {
+            // 文件名在完成前须保持有效，存放在槽位中；只加入队列，在reap()中一次提交
+            int slot = freeSlots.takeLast();
+            ringSlots[slot] = Slot{tag, from, to};
+            uring->prepareRename(dirfd, ringSlots[slot].from.constData(), ringSlots[slot].to.constData(), quint64(slot),
+                                 latency > 0 ? &uring->delay : nullptr);
+            ringPending++;
+            return;
+        }
+#endif
+        if(active == Engine::Threads)
+        {
+            pool.start([this, tag, from, to]()
+            {
+                if(latency > 0)
+                {
+                    QThread::usleep(latency);
+                }
+                int error = ::renameat2(dirfd, from.constData(), dirfd, to.constData(), RENAME_NOREPLACE) == 0 ? 0 : errno;
+                QMutexLocker locker(&mutex);
+                threadCalls++;
+                done.append(Completion{tag, error, from, to, true});
+                finished.wakeAll();
+            });
+            return;
+        }
+    }
+#endif
+    renameNow(tag, from, to);
+}
+
+void PipelinedRenamer::reap(const std::function<void(int tag, int error)>& completed)
+{
+    if(inFlight == 0)
+    {
+        return;
+    }
+    QVector<Completion> batch;
+    while(true)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            batch.swap(done);
+        }
+#ifdef RENAMER_IO_URING
+        if(uring && ringPending > 0)
+        {
+            // 已有结果时只提交不等待
+            int error = uring->enter(batch.isEmpty() ? 1 : 0);
+            uring->drain([&](quint64 slot, int result)
+            {
+                Slot& entry = ringSlots[int(slot)];
+                batch.append(Completion{entry.tag, -result, entry.from, entry.to, true});
+                entry = Slot();
+                freeSlots.append(int(slot));
+                ringPending--;
+            });
+            // 完成队列已满时取出结果后重新提交；其他错误说明队列不可用，在途的重命名按失败处理
+            if(error != 0 && error != EBUSY && error != EAGAIN)
+            {
+                qWarning() << "io_uring_enter failed:" << std::strerror(error);
+                for(int slot = 0; slot < ringSlots.size(); slot++)
+                {
+                    if(ringSlots[slot].tag >= 0)
+                    {
+                        batch.append(Completion{ringSlots[slot].tag, error, ringSlots[slot].from, ringSlots[slot].to, false});
+                        ringSlots[slot] = Slot();
+                        freeSlots.append(slot);
+                    }
+                }
+                ringPending = 0;
+            }
+        }
+#endif
+        if(!batch.isEmpty())
+        {
+            break;
+        }
+#ifdef RENAMER_IO_URING
+        if(ringPending > 0)
+        {
+            continue;
+        }
+#endif
+        QMutexLocker locker(&mutex);
+        while(done.isEmpty())
+        {
+            finished.wait(&mutex);
+        }
+    }
+    for(const Completion& completion : std::as_const(batch))
+    {
+        inFlight--;
+        deliver(completion, completed);
+    }
+}
+
+qint64 PipelinedRenamer::callCount() const
+{
+    qint64 result = calls + fallback.callCount();
+#ifdef RENAMER_IO_URING
+    if(uring)
+    {
+        result += uring->callCount();
+    }
+#endif
+    QMutexLocker locker(&mutex);
+    return result + threadCalls;
+}
+
+QString PipelinedRenamer::engineName(Engine engine)
+{
+    switch(engine)
+    {
+        case Engine::Auto:
+            return "auto";
+        case Engine::IoUring:
+            return "io_uring";
+        case Engine::Threads:
+            return "threads";
+        case Engine::Serial:
+            return "serial";
+    }
+    return QString();
+}
+
+void PipelinedRenamer::renameNow(int tag, const QByteArray& from, const QByteArray& to)
+{
+    if(latency > 0)
+    {
+        QThread::usleep(latency);
+    }
+    int error = fallback.rename(QFile::decodeName(from), QFile::decodeName(to));
+    QMutexLocker locker(&mutex);
+    done.append(Completion{tag, error, from, to, false});
+}
+
+void PipelinedRenamer::deliver(const Completion& completion, const std::function<void(int, int)>& completed)
+{
+    int error = completion.error;
+    // 内核或文件系统不支持RENAME_NOREPLACE：本条目和之后的条目都由DirectoryRenamer检查目标后逐个执行
+    if(completion.async && (error == EINVAL || error == ENOSYS))
+    {
+        if(noReplace)
+        {
+            qWarning() << "RENAME_NOREPLACE is not supported, renaming one by one:" << engineName(active);
+            noReplace = false;
+        }
+        error = fallback.rename(QFile::decodeName(completion.from), QFile::decodeName(completion.to));
+    }
+    completed(completion.tag, error);
+}
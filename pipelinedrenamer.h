@@ -0,0 +1,160 @@
+#ifndef PIPELINEDRENAMER_H
+#define PIPELINEDRENAMER_H
+
+/******************************************************************************
+ * @file       pipelinedrenamer.h
+ * @brief      并发提交重命名、乱序取回结果的执行器，用于高延迟的挂载目录
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+#include "directoryrenamer.h"
+
+/**
+ * @brief 流水线重命名
+ *
+ * FUSE、SMB挂载上每次重命名都要等待毫秒级的往返，逐个执行时耗时几乎全是等待。
+ * 本类最多同时保持depth个重命名在途：Linux 5.11以上通过io_uring的IORING_OP_RENAMEAT
+ * （同样带RENAME_NOREPLACE）提交，一次io_uring_enter提交一批并等待结果；
+ * io_uring不可用（内核过旧、被seccomp禁止）时退回线程池，每个线程调用renameat2。
+ * 结果按完成顺序取回，由提交时给出的标签对应到计划条目；有先后依赖的条目须由调用者等前一个完成后再提交。
+ * 文件系统不支持RENAME_NOREPLACE（返回EINVAL）时，该条目及之后的条目都改由DirectoryRenamer逐个执行。
+ */
+class PipelinedRenamer
+{
+public:
+    /**
+     * @brief 实现方式
+     */
+    enum class Engine
+    {
+        Auto,       // 优先io_uring，不可用时使用线程池
+        IoUring,    // io_uring，不可用时同样退回线程池
+        Threads,    // 线程池
+        Serial      // 逐个执行（目录无法打开或非Linux平台）
+    };
+
+    /**
+     * @brief 构造函数，打开目录并创建队列
+     * @param directory         目录
+     * @param depth             最多同时在途的重命名数
+     * @param engine            实现方式
+     */
+    PipelinedRenamer(const QString& directory, int depth, Engine engine = Engine::Auto);
+    ~PipelinedRenamer();
+
+    PipelinedRenamer(const PipelinedRenamer&) = delete;
+    PipelinedRenamer& operator=(const PipelinedRenamer&) = delete;
+
+    /**
+     * @brief 实际使用的实现方式（不为Auto）
+     */
+    Engine engine() const;
+
+    /**
+     * @brief 最多同时在途的重命名数
+     */
+    int depth() const;
+
+    /**
+     * @brief 已提交但尚未取回结果的重命名数
+     */
+    int pending() const;
+
+    /**
+     * @brief 测试用：每个重命名开始前先等待一段时间，模拟高延迟的挂载
+     *
+     * io_uring中以链接在重命名之前的定时器实现，线程池和逐个执行时在线程中休眠，在途的等待互相重叠。
+     * @param microseconds      等待时间（微秒）
+     */
+    void setLatency(int microseconds);
+
+    /**
+     * @brief 提交重命名，目标已存在时不覆盖；须在pending()小于depth()时调用
+     * @param tag               标签，随结果返回
+     * @param oldName           原文件名
+     * @param newName           新文件名
+     */
+    void submit(int tag, const QString& oldName, const QString& newName);
+
+    /**
+     * @brief 等待至少一个重命名完成，取回全部已完成的结果；没有在途的重命名时立即返回
+     * @param completed         对每个结果调用一次，参数为标签和错误码（0或errno，与DirectoryRenamer::rename相同）
+     */
+    void reap(const std::function<void(int tag, int error)>& completed);
+
+    /**
+     * @brief 发出的系统调用数（io_uring按io_uring_enter计，线程池按每次renameat2计）
+     */
+    qint64 callCount() const;
+
+    /**
+     * @brief 实现方式的名称
+     */
+    static QString engineName(Engine engine);
+
+private:
+    /**
+     * @brief 一个已完成的重命名
+     */
+    struct Completion
+    {
+        int tag;
+        int error;
+        QByteArray from;
+        QByteArray to;
+        bool async;             // 是否由io_uring或线程池执行
+    };
+
+    /**
+     * @brief 在途的重命名占用的槽位，保存提交给内核的文件名
+     */
+    struct Slot
+    {
+        int tag = -1;
+        QByteArray from;
+        QByteArray to;
+    };
+
+    class Uring;
+
+    /**
+     * @brief 在当前线程中重命名并记入结果
+     */
+    void renameNow(int tag, const QByteArray& from, const QByteArray& to);
+
+    /**
+     * @brief 处理一个结果：不支持RENAME_NOREPLACE时改为逐个执行
+     */
+    void deliver(const Completion& completion, const std::function<void(int, int)>& completed);
+
+    DirectoryRenamer fallback;              // 逐个执行和不支持RENAME_NOREPLACE时使用
+    Engine active = Engine::Serial;
+    int queueDepth = 1;
+    int latency = 0;                        // 微秒
+    int inFlight = 0;
+    int ringPending = 0;                    // 其中在io_uring中的数量
+    int dirfd = -1;
+    bool noReplace = true;                  // 文件系统是否支持RENAME_NOREPLACE
+    qint64 calls = 0;
+    std::unique_ptr<Uring> uring;
+    QVector<Slot> ringSlots;                // io_uring的槽位，下标即user_data
+    QVector<int> freeSlots;
+    QThreadPool pool;
+    mutable QMutex mutex;                   // 保护done和threadCalls
+    QWaitCondition finished;
+    QVector<Completion> done;               // 线程池和逐个执行已完成、尚未取回的结果
+    qint64 threadCalls = 0;
+};
+
+#endif // PIPELINEDRENAMER_H
@@ -0,0 +1,391 @@
+#include "regexrulelist.h"
+
+#include <QDebug>
+
+namespace
+{
+    // 规则之间的分隔符
+    const QString ruleSeparator = ";;";
+
+    // 从pos处的“{”开始解析量词{n}、{n,}、{n,m}，返回最少次数并把end设为“}”之后，不是量词时返回-1
+    int parseBraceQuantifier(const QString& pattern, int pos, int* end)
+    {
+        int i = pos + 1;
+        int minimum = 0;
+        int digits = 0;
+        while(i < pattern.size() && pattern[i].isDigit())
+        {
+            minimum = qMin(minimum * 10 + pattern[i].digitValue(), 1000000);
+            digits++;
+            i++;
+        }
+        if(digits == 0)
+        {
+            return -1;
+        }
+        if(i < pattern.size() && pattern[i] == ',')
+        {
+            i++;
+            while(i < pattern.size() && pattern[i].isDigit())
+            {
+                i++;
+            }
+        }
+        if(i >= pattern.size() || pattern[i] != '}')
+        {
+            return -1;
+        }
+        *end = i + 1;
+        return minimum;
+    }
+
+    // 跳过从pos处“[”开始的字符集，返回“]”之后的位置
+    int skipClass(const QString& pattern, int pos)
+    {
+        int i = pos + 1;
+        if(i < pattern.size() && pattern[i] == '^')
+        {
+            i++;
+        }
+        // 紧跟在开头的“]”是普通字符
+        if(i < pattern.size() && pattern[i] == ']')
+        {
+            i++;
+        }
+        while(i < pattern.size() && pattern[i] != ']')
+        {
+            if(pattern[i] == '\\')
+            {
+                i++;
+            }
+            else
+                if(pattern[i] == '[' && i + 1 < pattern.size() && pattern[i + 1] == ':')
+                {
+                    // POSIX字符类[:alpha:]
+                    int close = pattern.indexOf(":]", i + 2);
+                    if(close >= 0)
+                    {
+                        i = close + 1;
+                    }
+                }
+            i++;
+        }
+        return i + 1;
+    }
+
+    // 跳过从pos处“(”开始的分组，返回“)”之后的位置
+    int skipGroup(const QString& pattern, int pos)
+    {
+        int depth = 0;
+        int i = pos;
+        while(i < pattern.size())
+        {
+            QChar c = pattern[i];
+            if(c == '\\')
+            {
+                i += 2;
+                continue;
+            }
+            if(c == '[')
+            {
+                i = skipClass(pattern, i);
+                continue;
+            }
+            if(c == '(')
+            {
+                depth++;
+            }
+            else
+                if(c == ')' && --depth == 0)
+                {
+                    return i + 1;
+                }
+            i++;
+        }
+        return i;
+    }
+} // namespace
+
+RegexRuleList::RegexRuleList() {}
+
+QStringList RegexRuleList::split(const QString& format)
+{
+    return format.split(ruleSeparator);
+}
+
+bool RegexRuleList::compile(const QStringList& patterns, const QVector<QString> &replacements)
+{
+    rules.clear();
+    bool valid = true;
+    for(int i = 0; i < patterns.size(); i++)
+    {
+        Rule rule;
+        rule.regex.setPattern(patterns[i]);
+        if(!rule.regex.isValid())
+        {
+            qWarning() << "Invalid regex pattern:" << patterns[i] << rule.regex.errorString();
+            valid = false;
+            continue;
+        }
+        // 预先编译（支持时使用JIT），避免逐文件编译
+        rule.regex.optimize();
+        rule.replacement = replacements.value(i);
+        rule.literal = requiredLiteral(patterns[i]);
+        rules.append(rule);
+    }
+    buildAutomaton();
+    return valid && !rules.isEmpty();
+}
+
+bool RegexRuleList::isValid() const
+{
+    return !rules.isEmpty();
+}
+
+int RegexRuleList::size() const
+{
+    return rules.size();
+}
+
+bool RegexRuleList::matches(const QString& baseName) const
+{
+    QBitArray candidates = screen(baseName);
+    for(int i = 0; i < rules.size(); i++)
+    {
+        if(candidates.testBit(i) && rules[i].regex.match(baseName).hasMatch())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString RegexRuleList::apply(const QString& baseName) const
+{
+    QBitArray candidates = screen(baseName);
+    QString result = baseName;
+    bool changed = false;
+    for(int i = 0; i < rules.size(); i++)
+    {
+        const Rule& rule = rules[i];
+        // 名称未变时沿用预筛结果；已被前面的规则改写时只需再查这一条规则的文字
+        if(!changed ? !candidates.testBit(i) : (!rule.literal.isEmpty() && !result.contains(rule.literal)))
+        {
+            continue;
+        }
+        QString next = result;
+        next.replace(rule.regex, rule.replacement);
+        if(next != result)
+        {
+            result = next;
+            changed = true;
+        }
+    }
+    return result;
+}
+
+QString RegexRuleList::requiredLiteral(const QString& pattern)
+{
+    QString best;
+    QString run;
+    auto flush = [&]()
+    {
+        if(run.size() > best.size())
+        {
+            best = run;
+        }
+        run.clear();
+    };
+    // 普通字符后面的量词决定它是否可省略，以及能否与后面的字符连成一段
+    auto addLiteral = [&](QChar c, int next, int* end)
+    {
+        *end = next;
+        if(next < pattern.size())
+        {
+            QChar q = pattern[next];
+            if(q == '*' || q == '?')
+            {
+                flush();
+                return;
+            }
+            if(q == '+')
+            {
+                run += c;
+                flush();
+                return;
+            }
+            int braceEnd;
+            int minimum = q == '{' ? parseBraceQuantifier(pattern, next, &braceEnd) : -1;
+            if(minimum == 0)
+            {
+                flush();
+                return;
+            }
+            if(minimum > 0)
+            {
+                run += c;
+                flush();
+                return;
+            }
+        }
+        run += c;
+    };
+    int i = 0;
+    while(i < pattern.size())
+    {
+        QChar c = pattern[i];
+        if(c == '\\')
+        {
+            if(i + 1 >= pattern.size())
+            {
+                break;
+            }
+            QChar escaped = pattern[i + 1];
+            if(escaped == 'Q')
+            {
+                return QString();
+            }
+            if(escaped.isLetterOrNumber())
+            {
+                // \d、\w、\b等字符类和断言只占两个字符，不是确定的文字；
+                // 反向引用、\x41、\cX、\k<name>、八进制等长度不定，无法可靠跳过
+                if(!QStringLiteral("dDwWsShHvVbBAzZGRNX").contains(escaped))
+                {
+                    return QString();
+                }
+                flush();
+                i += 2;
+                continue;
+            }
+            addLiteral(escaped, i + 2, &i);
+            continue;
+        }
+        if(c == '|')
+        {
+            return QString();
+        }
+        if(c == '(')
+        {
+            // (?i)、(?x)等改变其后匹配方式的选项无法处理；(?i:...)等只作用于分组，随分组一起跳过
+            if(i + 1 < pattern.size() && pattern[i + 1] == '?')
+            {
+                int j = i + 2;
+                while(j < pattern.size() && (pattern[j].isLetter() || pattern[j] == '-' || pattern[j] == '^'))
+                {
+                    j++;
+                }
+                if(j > i + 2 && j < pattern.size() && pattern[j] == ')')
+                {
+                    return QString();
+                }
+            }
+            flush();
+            i = skipGroup(pattern, i);
+            continue;
+        }
+        if(c == '[')
+        {
+            flush();
+            i = skipClass(pattern, i);
+            continue;
+        }
+        if(c == '{')
+        {
+            int end;
+            if(parseBraceQuantifier(pattern, i, &end) >= 0)
+            {
+                flush();
+                i = end;
+                continue;
+            }
+            addLiteral(c, i + 1, &i);
+            continue;
+        }
+        if(c == '.' || c == '^' || c == '$' || c == '*' || c == '+' || c == '?' || c == ')')
+        {
+            flush();
+            i++;
+            continue;
+        }
+        addLiteral(c, i + 1, &i);
+    }
+    flush();
+    return best;
+}
+
+void RegexRuleList::buildAutomaton()
+{
+    nodes.clear();
+    nodes.append(Node());
+    unscreened = QBitArray(rules.size());
+    for(int i = 0; i < rules.size(); i++)
+    {
+        const QString& literal = rules[i].literal;
+        if(literal.isEmpty())
+        {
+            unscreened.setBit(i);
+            continue;
+        }
+        int state = 0;
+        for(QChar c : literal)
+        {
+            auto it = nodes[state].next.constFind(c);
+            if(it == nodes[state].next.constEnd())
+            {
+                nodes.append(Node());
+                nodes[state].next.insert(c, nodes.size() - 1);
+                state = nodes.size() - 1;
+            }
+            else
+            {
+                state = it.value();
+            }
+        }
+        nodes[state].rules.append(i);
+    }
+    // 按层构建失败链，并把失败链上的输出并入当前节点
+    QVector<int> queue;
+    for(int child : std::as_const(nodes[0].next))
+    {
+        queue.append(child);
+    }
+    for(int k = 0; k < queue.size(); k++)
+    {
+        int state = queue[k];
+        for(auto it = nodes[state].next.constBegin(); it != nodes[state].next.constEnd(); ++it)
+        {
+            int fail = nodes[state].fail;
+            while(fail != 0 && !nodes[fail].next.contains(it.key()))
+            {
+                fail = nodes[fail].fail;
+            }
+            int target = nodes[fail].next.value(it.key(), 0);
+            nodes[it.value()].fail = target == it.value() ? 0 : target;
+            nodes[it.value()].rules += nodes[nodes[it.value()].fail].rules;
+            queue.append(it.value());
+        }
+    }
+}
+
+QBitArray RegexRuleList::screen(const QString& baseName) const
+{
+    QBitArray result = unscreened;
+    if(nodes.size() <= 1)
+    {
+        return result;
+    }
+    int state = 0;
+    for(QChar c : baseName)
+    {
+        while(state != 0 && !nodes[state].next.contains(c))
+        {
+            state = nodes[state].fail;
+        }
+        state = nodes[state].next.value(c, 0);
+        for(int rule : nodes[state].rules)
+        {
+            result.setBit(rule);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,121 @@
+#ifndef REGEXRULELIST_H
+#define REGEXRULELIST_H
+
+/******************************************************************************
+ * @file       regexrulelist.h
+ * @brief      正则表达式模式下按顺序应用的多条替换规则及其文字预筛
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QBitArray>
+#include <QChar>
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief 正则表达式规则列表
+ *
+ * 格式栏“?规则1;;规则2;;...”中的各条规则按顺序作用于文件名，后一条规则作用于前一条替换后的结果，
+ * 一次扫描完成“去掉副本、统一日期、合并空格”这类连续的整理。每条规则只在批次开始时编译一次。
+ * 编译时从每条规则中提取匹配时必然出现的一段文字（无法确定时不提取），全部文字合成一个
+ * Aho-Corasick自动机：每个文件名只扫描一遍，就能排除不含其必需文字、不可能匹配的规则，
+ * 只有余下的规则才交给正则表达式。
+ */
+class RegexRuleList
+{
+public:
+    RegexRuleList();
+
+    /**
+     * @brief 拆分格式中的规则
+     * @param format            去掉开头问号后的格式
+     * @return 各条规则的正则表达式
+     */
+    static QStringList split(const QString& format);
+
+    /**
+     * @brief 编译规则
+     * @param patterns          各条规则的正则表达式
+     * @param replacements      各条规则的替换内容（可用\n引用捕获组），缺少时替换为空
+     * @return 全部规则有效时返回true
+     */
+    bool compile(const QStringList& patterns, const QVector<QString> &replacements);
+
+    /**
+     * @brief 是否已编译出至少一条有效规则
+     */
+    bool isValid() const;
+
+    /**
+     * @brief 规则数
+     */
+    int size() const;
+
+    /**
+     * @brief 是否有规则匹配（前面的规则都不匹配时名称不变，因此只需对原名判断）
+     * @param baseName          文件名（不含扩展名）
+     * @return 有规则匹配时返回true
+     */
+    bool matches(const QString& baseName) const;
+
+    /**
+     * @brief 按顺序应用全部规则
+     * @param baseName          文件名（不含扩展名）
+     * @return 替换后的文件名
+     */
+    QString apply(const QString& baseName) const;
+
+    /**
+     * @brief 提取匹配时必然出现的文字
+     *
+     * 只取顶层（不在分组和字符集中）、不带可省略量词的连续普通字符，取最长的一段；
+     * 含顶层“|”、\Q...\E、改变匹配方式的内联选项（如(?i)）或字符类、断言以外的字母数字转义
+     * （如反向引用、\x41、\cX）时无法确定，返回空。
+     * @param pattern           正则表达式
+     * @return 必需的文字，无法确定时为空
+     */
+    static QString requiredLiteral(const QString& pattern);
+
+private:
+    /**
+     * @brief 一条规则
+     */
+    struct Rule
+    {
+        QRegularExpression regex;
+        QString replacement;
+        QString literal;            // 必需的文字，为空时总要检查
+    };
+
+    /**
+     * @brief 自动机节点
+     */
+    struct Node
+    {
+        QHash<QChar, int> next;
+        int fail = 0;
+        QVector<int> rules;         // 在此结束的文字（含失败链上的）所属的规则
+    };
+
+    /**
+     * @brief 构建自动机
+     */
+    void buildAutomaton();
+
+    /**
+     * @brief 名称中可能匹配的规则
+     */
+    QBitArray screen(const QString& baseName) const;
+
+    QVector<Rule> rules;
+    QVector<Node> nodes;
+    QBitArray unscreened;           // 没有必需文字、总要检查的规则
+};
+
+#endif // REGEXRULELIST_H
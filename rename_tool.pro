@@ -8,15 +8,55 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Cross-check the regex-free format matcher against QRegularExpression on every file (debug builds).
+#DEFINES += RENAMER_VERIFY_MATCHER
+
 SOURCES += \
     batchrenamer.cpp \
+    directoryrenamer.cpp \
+    duplicatefinder.cpp \
+    extensionclassifier.cpp \
+    fileorder.cpp \
+    filetable.cpp \
+    formatmatcher.cpp \
     formatpreset.cpp \
     main.cpp \
+    mediametadata.cpp \
+    numberingindex.cpp \
+    pipelinedrenamer.cpp \
+    regexrulelist.cpp \
+    renamejournal.cpp \
+    renameplan.cpp \
+    renamepreviewmodel.cpp \
+    renamewatcher.cpp \
+    renameworker.cpp \
+    ruleset.cpp \
+    runstats.cpp \
+    treerenamer.cpp \
     widget.cpp
 
 HEADERS += \
     batchrenamer.h \
+    directoryrenamer.h \
+    duplicatefinder.h \
+    extensionclassifier.h \
+    fileorder.h \
+    filetable.h \
+    formatmatcher.h \
     formatpreset.h \
+    mediametadata.h \
+    numberingindex.h \
+    pipelinedrenamer.h \
+    regexrulelist.h \
+    renamejournal.h \
+    renameplan.h \
+    renamepreviewmodel.h \
+    renamewatcher.h \
+    renameworker.h \
+    ruleset.h \
+    runstats.h \
+    storagebackend.h \
+    treerenamer.h \
     widget.h
 
 FORMS += \
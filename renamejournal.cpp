@@ -0,0 +1,269 @@
+#include "renamejournal.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QStandardPaths>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const QByteArray journalHeader = "#cloudrenamer-journal 1";
+
+    // 每组提交的记录数
+    const int groupCommitSize = 256;
+
+    // 转义文件名中的反斜杠、制表符和换行符，保证一条记录占一行
+    QByteArray escapeName(const QString& name)
+    {
+        QByteArray result;
+        const QByteArray utf8 = name.toUtf8();
+        result.reserve(utf8.size());
+        for(char c : utf8)
+        {
+            switch(c)
+            {
+                case '\\': result += "\\\\"; break;
+                case '\t': result += "\\t"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                default: result += c; break;
+            }
+        }
+        return result;
+    }
+
+    QString unescapeName(const QByteArray& field)
+    {
+        QByteArray utf8;
+        utf8.reserve(field.size());
+        for(int i = 0; i < field.size(); i++)
+        {
+            char c = field[i];
+            if(c == '\\' && i + 1 < field.size())
+            {
+                char next = field[++i];
+                switch(next)
+                {
+                    case 't': c = '\t'; break;
+                    case 'n': c = '\n'; break;
+                    case 'r': c = '\r'; break;
+                    default: c = next; break;
+                }
+            }
+            utf8 += c;
+        }
+        return QString::fromUtf8(utf8);
+    }
+
+    // 把文件内容刷到磁盘
+    bool syncFile(QFile& file)
+    {
+        if(!file.flush())
+        {
+            return false;
+        }
+#ifdef Q_OS_WIN
+        return _commit(file.handle()) == 0;
+#else
+        return ::fsync(file.handle()) == 0;
+#endif
+    }
+} // namespace
+
+RenameJournal::RenameJournal(const QString& directory)
+    : directory(QDir(directory).absolutePath())
+{
+    file.setFileName(journalPath(directory));
+}
+
+RenameJournal::~RenameJournal()
+{
+    if(file.isOpen())
+    {
+        commit();
+    }
+}
+
+QString RenameJournal::journalPath(const QString& directory)
+{
+    QString base = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/journals";
+    QDir().mkpath(base);
+    QByteArray key = QCryptographicHash::hash(QDir::cleanPath(QDir(directory).absolutePath()).toUtf8(),
+                                              QCryptographicHash::Sha1).toHex();
+    return base + "/" + QString::fromLatin1(key) + ".journal";
+}
+
+bool RenameJournal::begin(const RenamePlan& plan)
+{
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning() << "Failed to open rename journal:" << file.fileName();
+        failed = true;
+        return false;
+    }
+    buffer = journalHeader + "\n";
+    buffer += "H\t" + escapeName(directory) + "\n";
+    for(const RenamePlan::Entry& entry : plan.entries)
+    {
+        buffer += (entry.status == RenamePlan::Status::Conflict) ? "K\t"
+                  : (entry.status == RenamePlan::Status::Duplicate) ? "D\t" : "P\t";
+        buffer += escapeName(entry.oldName) + "\t" + escapeName(entry.newName) + "\n";
+    }
+    // 计划必须先于任何重命名落盘
+    pendingRecords = 0;
+    return commit();
+}
+
+bool RenameJournal::open()
+{
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        qWarning() << "Failed to open rename journal:" << file.fileName();
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool RenameJournal::load(RenamePlan* plan, Phase* phase) const
+{
+    QFile input(file.fileName());
+    if(!input.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QList<QByteArray> lines = input.readAll().split('\n');
+    // 最后一行若没有换行符，说明写入时被中断，丢弃
+    lines.removeLast();
+    if(lines.isEmpty() || lines.front() != journalHeader)
+    {
+        qWarning() << "Invalid rename journal:" << input.fileName();
+        return false;
+    }
+    plan->directory = directory;
+    plan->entries.clear();
+    plan->error.clear();
+    *phase = Phase::Running;
+    for(int i = 1; i < lines.size(); i++)
+    {
+        QList<QByteArray> fields = lines[i].split('\t');
+        const QByteArray& type = fields.front();
+        if((type == "P" || type == "K" || type == "D") && fields.size() == 3)
+        {
+            RenamePlan::Entry entry;
+            entry.oldName = unescapeName(fields[1]);
+            entry.newName = unescapeName(fields[2]);
+            entry.status = (type == "K") ? RenamePlan::Status::Conflict
+                           : (type == "D") ? RenamePlan::Status::Duplicate : RenamePlan::Status::Pending;
+            plan->entries.append(entry);
+            continue;
+        }
+        if((type == "C" || type == "F" || type == "U") && fields.size() == 2)
+        {
+            bool ok;
+            int index = fields[1].toInt(&ok);
+            if(!ok || index < 0 || index >= plan->entries.size())
+            {
+                continue;
+            }
+            if(type == "C")
+            { plan->entries[index].status = RenamePlan::Status::Renamed; }
+            else
+                if(type == "F")
+                { plan->entries[index].status = RenamePlan::Status::Failed; }
+                else
+                { plan->entries[index].status = RenamePlan::Status::Pending; }
+            continue;
+        }
+        if(type == "E")
+        { *phase = Phase::Finished; }
+        else
+            if(type == "R")
+            { *phase = Phase::Undoing; }
+            else
+                if(type == "X")
+                { *phase = Phase::Undone; }
+    }
+    return true;
+}
+
+void RenameJournal::markCompleted(int index)
+{
+    append("C\t" + QByteArray::number(index));
+}
+
+void RenameJournal::markFailed(int index)
+{
+    append("F\t" + QByteArray::number(index));
+}
+
+void RenameJournal::markUndoStarted()
+{
+    append("R");
+    commit();
+}
+
+void RenameJournal::markUndone(int index)
+{
+    append("U\t" + QByteArray::number(index));
+}
+
+bool RenameJournal::finish()
+{
+    append("E");
+    return commit();
+}
+
+bool RenameJournal::finishUndo()
+{
+    append("X");
+    return commit();
+}
+
+bool RenameJournal::commit()
+{
+    if(!isValid())
+    {
+        buffer.clear();
+        pendingRecords = 0;
+        return false;
+    }
+    if(buffer.isEmpty())
+    {
+        return true;
+    }
+    bool ok = file.write(buffer) == buffer.size() && syncFile(file);
+    if(!ok)
+    {
+        qWarning() << "Failed to write rename journal:" << file.fileName();
+        failed = true;
+    }
+    buffer.clear();
+    pendingRecords = 0;
+    return ok;
+}
+
+bool RenameJournal::isValid() const
+{
+    return file.isOpen() && !failed;
+}
+
+void RenameJournal::append(const QByteArray& record)
+{
+    // 日志不可用时丢弃记录，避免整个批次的记录堆积在缓冲区中
+    if(!isValid())
+    {
+        return;
+    }
+    buffer += record + "\n";
+    if(++pendingRecords >= groupCommitSize)
+    {
+        commit();
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef RENAMEJOURNAL_H
+#define RENAMEJOURNAL_H
+
+/******************************************************************************
+ * @file       renamejournal.h
+ * @brief      重命名日志，用于撤销和续做中断的批次
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include "renameplan.h"
+
+/**
+ * @brief 只追加的重命名日志
+ *
+ * 每个目录保存最近一个批次的日志（位于应用数据目录，不写入云盘）。计划先完整写入并落盘，
+ * 之后的完成记录按组提交：攒够一组才写入并fsync一次，而不是每个文件一次。
+ * 崩溃时最多丢失最后一组记录，续做和撤销会对这部分条目核对文件系统。
+ */
+class RenameJournal
+{
+public:
+    /**
+     * @brief 批次阶段
+     */
+    enum class Phase
+    {
+        Running,    // 执行中（或被中断）
+        Finished,   // 执行完毕
+        Undoing,    // 撤销中（或撤销被中断）
+        Undone      // 已撤销
+    };
+
+    /**
+     * @brief 构造函数
+     * @param directory         重命名目录
+     */
+    explicit RenameJournal(const QString& directory);
+
+    /**
+     * @brief 析构时提交尚未落盘的记录
+     */
+    ~RenameJournal();
+
+    /**
+     * @brief 获取目录对应的日志路径
+     * @param directory         重命名目录
+     * @return 日志文件路径
+     */
+    static QString journalPath(const QString& directory);
+
+    /**
+     * @brief 开始新批次：覆盖旧日志，写入计划并落盘
+     * @param plan              重命名计划
+     * @return 成功时返回true
+     */
+    bool begin(const RenamePlan& plan);
+
+    /**
+     * @brief 以追加方式打开已有日志
+     * @return 成功时返回true
+     */
+    bool open();
+
+    /**
+     * @brief 读取日志
+     * @param plan              读出的计划，条目状态反映已记录的进度
+     * @param phase             批次阶段
+     * @return 日志存在且有效时返回true
+     */
+    bool load(RenamePlan* plan, Phase* phase) const;
+
+    /**
+     * @brief 记录条目已重命名
+     * @param index             条目序号
+     */
+    void markCompleted(int index);
+
+    /**
+     * @brief 记录条目重命名失败
+     * @param index             条目序号
+     */
+    void markFailed(int index);
+
+    /**
+     * @brief 记录开始撤销
+     */
+    void markUndoStarted();
+
+    /**
+     * @brief 记录条目已撤销
+     * @param index             条目序号
+     */
+    void markUndone(int index);
+
+    /**
+     * @brief 记录批次执行完毕并落盘
+     * @return 成功时返回true
+     */
+    bool finish();
+
+    /**
+     * @brief 记录撤销完毕并落盘
+     * @return 成功时返回true
+     */
+    bool finishUndo();
+
+    /**
+     * @brief 写入并落盘已缓冲的记录（组提交）
+     * @return 成功时返回true
+     */
+    bool commit();
+
+    /**
+     * @brief 日志是否可用：已打开且没有写入失败
+     *
+     * 不可用时不再缓冲记录，本批次无法撤销或续做。
+     */
+    bool isValid() const;
+
+private:
+    /**
+     * @brief 缓冲一条记录，攒够一组时自动提交
+     * @param record            记录（不含换行符）
+     */
+    void append(const QByteArray& record);
+
+    QString directory;
+    QFile file;
+    QByteArray buffer;          // 尚未写入的记录
+    int pendingRecords = 0;     // 尚未写入的记录数
+    bool failed = false;        // 打开或写入失败后停止记录
+};
+
+#endif // RENAMEJOURNAL_H
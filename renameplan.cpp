@@ -0,0 +1,350 @@
+#include "renameplan.h"
+
+#include <QDebug>
+
+int RenamePlan::count(Status status) const
+{
+    int result = 0;
+    for(const Entry& entry : entries)
+    {
+        if(entry.status == status)
+        {
+            result++;
+        }
+    }
+    return result;
+}
+
+namespace
+{
+    // 散列表的最小桶数
+    const int minimumBuckets = 64;
+
+    // 取出一个码位并按大小写折叠，与QString::toCaseFolded()的逐字符折叠一致
+    char32_t foldedAt(QStringView name, qsizetype* i)
+    {
+        char32_t c = name[*i].unicode();
+        if(QChar::isHighSurrogate(c) && *i + 1 < name.size() && name[*i + 1].isLowSurrogate())
+        {
+            c = QChar::surrogateToUcs4(name[*i], name[*i + 1]);
+            ++*i;
+        }
+        ++*i;
+        return QChar::toCaseFolded(c);
+    }
+} // namespace
+
+NameIndex::NameIndex(bool caseInsensitive)
+    : caseInsensitive(caseInsensitive), buckets(minimumBuckets, -1)
+{}
+
+int NameIndex::insert(QStringView name)
+{
+    // 装填因子超过3/4时重建，同时丢弃已释放的名称
+    if((table.size() + 1) * 4 > buckets.size() * 3)
+    {
+        int bucketCount = minimumBuckets;
+        while(bucketCount < (live + 1) * 2)
+        {
+            bucketCount *= 2;
+        }
+        rebuild(bucketCount);
+    }
+    int bucket = findBucket(name, hashOf(name));
+    int row = buckets[bucket];
+    if(row < 0)
+    {
+        row = table.append(name);
+        counts.append(0);
+        buckets[bucket] = row;
+    }
+    if(counts[row]++ == 0)
+    {
+        live++;
+    }
+    return row;
+}
+
+void NameIndex::remove(QStringView name)
+{
+    int row = buckets[findBucket(name, hashOf(name))];
+    if(row < 0 || counts[row] == 0)
+    {
+        return;
+    }
+    if(--counts[row] == 0)
+    {
+        live--;
+    }
+}
+
+bool NameIndex::contains(QStringView name) const
+{
+    int row = buckets[findBucket(name, hashOf(name))];
+    return row >= 0 && counts[row] > 0;
+}
+
+QString NameIndex::key(const QString& name) const
+{
+    return caseInsensitive ? name.toCaseFolded() : name;
+}
+
+const FileTable& NameIndex::names() const
+{
+    return table;
+}
+
+qint64 NameIndex::memoryUsage() const
+{
+    return table.memoryUsage() + (counts.capacity() + buckets.capacity()) * qint64(sizeof(int));
+}
+
+size_t NameIndex::hashOf(QStringView name) const
+{
+    if(!caseInsensitive)
+    {
+        return qHash(name);
+    }
+    // FNV-1a，逐码位折叠后计算，不分配临时字符串
+    quint64 hash = 14695981039346656037ULL;
+    for(qsizetype i = 0; i < name.size();)
+    {
+        hash = (hash ^ foldedAt(name, &i)) * 1099511628211ULL;
+    }
+    return size_t(hash ^ (hash >> 32));
+}
+
+bool NameIndex::same(QStringView a, QStringView b) const
+{
+    if(!caseInsensitive)
+    {
+        return a == b;
+    }
+    qsizetype i = 0;
+    qsizetype j = 0;
+    while(i < a.size() && j < b.size())
+    {
+        if(foldedAt(a, &i) != foldedAt(b, &j))
+        {
+            return false;
+        }
+    }
+    return i == a.size() && j == b.size();
+}
+
+int NameIndex::findBucket(QStringView name, size_t hash) const
+{
+    // 线性探测
+    int mask = buckets.size() - 1;
+    int bucket = int(hash & size_t(mask));
+    while(buckets[bucket] >= 0 && !same(table.name(buckets[bucket]), name))
+    {
+        bucket = (bucket + 1) & mask;
+    }
+    return bucket;
+}
+
+void NameIndex::rebuild(int bucketCount)
+{
+    FileTable old = std::move(table);
+    QVector<int> oldCounts = std::move(counts);
+    table = FileTable();
+    counts.clear();
+    counts.reserve(live);
+    buckets = QVector<int>(bucketCount, -1);
+    for(int i = 0; i < old.size(); i++)
+    {
+        if(oldCounts[i] > 0)
+        {
+            QStringView name = old.name(i);
+            buckets[findBucket(name, hashOf(name))] = table.append(name);
+            counts.append(oldCounts[i]);
+        }
+    }
+}
+
+namespace
+{
+    const QString temporaryPrefix = ".renamer-";
+    const QString temporarySuffix = ".tmp";
+} // namespace
+
+QVector<RenamePlan::Entry> RenameScheduler::schedule(const QVector<RenamePlan::Entry> &moves, NameIndex* occupied,
+                                                     int* temporaries)
+{
+    const int count = moves.size();
+    QVector<RenamePlan::Status> status(count, RenamePlan::Status::Pending);
+    QVector<bool> skipped(count, false);      // 新旧名称相同，不需要执行
+    QHash<QString, int> bySource;               // 原名称的键 -> 条目
+    QHash<QString, int> byTarget;               // 新名称的键 -> 占用该名称的条目（先到者）
+    for(int i = 0; i < count; i++)
+    {
+        if(moves[i].oldName == moves[i].newName)
+        {
+            skipped[i] = true;
+            continue;
+        }
+        bySource.insert(occupied->key(moves[i].oldName), i);
+    }
+    for(int i = 0; i < count; i++)
+    {
+        if(skipped[i])
+        {
+            continue;
+        }
+        QString target = occupied->key(moves[i].newName);
+        if(byTarget.contains(target))
+        {
+            status[i] = RenamePlan::Status::Conflict;
+            continue;
+        }
+        byTarget.insert(target, i);
+    }
+    // 目标被保留的名称占用的条目判为冲突；其原名称也被保留，沿入边传播
+    auto pendingSource = [&](const QString& key)
+    {
+        auto it = bySource.constFind(key);
+        return it != bySource.constEnd() && status[it.value()] == RenamePlan::Status::Pending ? it.value() : -1;
+    };
+    QVector<int> queue;
+    for(int i = 0; i < count; i++)
+    {
+        if(!skipped[i] && status[i] == RenamePlan::Status::Conflict)
+        {
+            queue.append(i);
+        }
+        else
+            if(!skipped[i] && occupied->contains(moves[i].newName)
+               && pendingSource(occupied->key(moves[i].newName)) < 0)
+            {
+                status[i] = RenamePlan::Status::Conflict;
+                queue.append(i);
+            }
+    }
+    while(!queue.isEmpty())
+    {
+        int i = queue.takeLast();
+        auto it = byTarget.constFind(occupied->key(moves[i].oldName));
+        if(it != byTarget.constEnd() && status[it.value()] == RenamePlan::Status::Pending)
+        {
+            status[it.value()] = RenamePlan::Status::Conflict;
+            queue.append(it.value());
+        }
+    }
+    // 按编号顺序遍历，遇到未安排的条目时安排其所在的整条链或整个环
+    QVector<RenamePlan::Entry> result;
+    result.reserve(count);
+    QVector<bool> done(count, false);
+    int temporaryCount = 0;
+    int temporaryNumber = 0;
+    auto emitMove = [&](const QString& from, const QString& to)
+    {
+        RenamePlan::Entry entry;
+        entry.oldName = from;
+        entry.newName = to;
+        result.append(entry);
+        occupied->remove(from);
+        occupied->insert(to);
+    };
+    for(int i = 0; i < count; i++)
+    {
+        if(skipped[i] || done[i])
+        {
+            continue;
+        }
+        if(status[i] == RenamePlan::Status::Conflict)
+        {
+            qWarning() << "Target file already exists: " << moves[i].newName;
+            result.append(moves[i]);
+            result.last().status = RenamePlan::Status::Conflict;
+            done[i] = true;
+            continue;
+        }
+        // 沿出边找到链的末端（目标空闲），或回到起点（环）
+        int end = i;
+        bool cycle = false;
+        while(true)
+        {
+            int next = pendingSource(occupied->key(moves[end].newName));
+            if(next < 0)
+            {
+                break;
+            }
+            if(next == i)
+            {
+                cycle = true;
+                break;
+            }
+            end = next;
+        }
+        // 环：先把起点移到临时名称，腾出其原名称，环中起点之前的条目（即end）随后可以就位
+        QString temporary;
+        int current = end;
+        if(cycle)
+        {
+            do
+            {
+                temporary = temporaryPrefix + QString::number(temporaryNumber++) + temporarySuffix;
+            }
+            while(occupied->contains(temporary) || byTarget.contains(occupied->key(temporary)));
+            emitMove(moves[i].oldName, temporary);
+            temporaryCount++;
+            done[i] = true;
+        }
+        // 逆序执行：每执行一条就腾出其原名称，再执行以该名称为目标的条目
+        while(current >= 0 && !done[current])
+        {
+            emitMove(moves[current].oldName, moves[current].newName);
+            done[current] = true;
+            auto it = byTarget.constFind(occupied->key(moves[current].oldName));
+            current = (it != byTarget.constEnd() && status[it.value()] == RenamePlan::Status::Pending) ? it.value() : -1;
+        }
+        if(cycle)
+        {
+            emitMove(temporary, moves[i].newName);
+        }
+    }
+    if(temporaries)
+    {
+        *temporaries = temporaryCount;
+    }
+    return result;
+}
+
+QVector<QVector<int>> RenameScheduler::dependencies(const QVector<RenamePlan::Entry> &entries, bool caseInsensitive)
+{
+    QVector<QVector<int>> result(entries.size());
+    // 与schedule()相同的键，只差大小写的名称视为同一名称
+    const NameIndex names(caseInsensitive);
+    // 按执行顺序记录每个名称最近一次被移走、被占用的条目
+    QHash<QString, int> vacatedBy;
+    QHash<QString, int> filledBy;
+    for(int i = 0; i < entries.size(); i++)
+    {
+        const RenamePlan::Entry& entry = entries[i];
+        if(entry.status != RenamePlan::Status::Pending)
+        {
+            continue;
+        }
+        QString oldKey = names.key(entry.oldName);
+        QString newKey = names.key(entry.newName);
+        auto vacated = vacatedBy.constFind(newKey);
+        if(vacated != vacatedBy.constEnd())
+        {
+            result[i].append(vacated.value());
+        }
+        auto filled = filledBy.constFind(oldKey);
+        if(filled != filledBy.constEnd())
+        {
+            result[i].append(filled.value());
+        }
+        vacatedBy.insert(oldKey, i);
+        filledBy.insert(newKey, i);
+    }
+    return result;
+}
+
+bool RenameScheduler::isTemporaryName(const QString& name)
+{
+    return name.startsWith(temporaryPrefix) && name.endsWith(temporarySuffix);
+}
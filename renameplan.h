@@ -0,0 +1,190 @@
+#ifndef RENAMEPLAN_H
+#define RENAMEPLAN_H
+
+/******************************************************************************
+ * @file       renameplan.h
+ * @brief      重命名计划、内存中的冲突检测及执行顺序的安排
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include "filetable.h"
+
+/**
+ * @brief 重命名计划，由BatchRenamer::plan生成、BatchRenamer::apply执行
+ */
+struct RenamePlan
+{
+    /**
+     * @brief 条目状态
+     */
+    enum class Status
+    {
+        Pending,        // 待重命名
+        Conflict,       // 目标名称已被占用，跳过
+        Renamed,        // 已重命名
+        Failed,         // 重命名失败
+        Duplicate       // 与本批次中另一个文件内容相同，跳过
+    };
+
+    // 状态个数，新增状态须加在Duplicate之后并更新此处
+    static const int statusCount = int(Status::Duplicate) + 1;
+
+    /**
+     * @brief 计划条目
+     */
+    struct Entry
+    {
+        QString oldName;
+        QString newName;
+        Status status = Status::Pending;
+        int error = 0;          // 重命名失败时的errno，原因未知时为-1（不写入日志）
+        QString duplicateOf;    // 内容相同的原件的原名称，不是重复文件时为空（不写入日志）
+    };
+
+    QString directory;          // 重命名目录
+    QVector<Entry> entries;     // 按执行顺序排列的条目
+    bool caseInsensitive = false;   // 名称按大小写折叠后比较（不写入日志）
+    QString error;              // 无法生成计划时的错误信息
+
+    /**
+     * @brief 统计处于指定状态的条目数
+     * @param status            状态
+     * @return 条目数
+     */
+    int count(Status status) const;
+};
+
+/**
+ * @brief 目录中已占用的名称，用于在内存中检测冲突
+ *
+ * 名称存放在FileTable中，散列表只记录名称的序号，不再为每个名称单独分配QString。
+ * 释放的名称保留在表中、计数归零，再次占用时直接复用；失效的名称过多时整体重建。
+ */
+class NameIndex
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param caseInsensitive   是否按大小写折叠后比较（用于不区分大小写的云盘挂载）
+     */
+    explicit NameIndex(bool caseInsensitive = false);
+
+    /**
+     * @brief 占用名称
+     * @param name              名称
+     * @return 名称在names()中的序号；与已有名称只差大小写时返回已有名称的序号
+     */
+    int insert(QStringView name);
+
+    /**
+     * @brief 释放名称
+     * @param name              名称
+     */
+    void remove(QStringView name);
+
+    /**
+     * @brief 名称是否已被占用
+     * @param name              名称
+     * @return 已占用时返回true
+     */
+    bool contains(QStringView name) const;
+
+    /**
+     * @brief 计算比较用的键，键相同的名称视为同一名称
+     * @param name              名称
+     * @return 键
+     */
+    QString key(const QString& name) const;
+
+    /**
+     * @brief 名称表，序号与insert()的返回值对应，下一次insert()之前有效
+     */
+    const FileTable& names() const;
+
+    /**
+     * @brief 占用的内存（字节）
+     */
+    qint64 memoryUsage() const;
+
+private:
+    /**
+     * @brief 计算散列值，不区分大小写时按折叠后的字符计算
+     * @param name              名称
+     */
+    size_t hashOf(QStringView name) const;
+
+    /**
+     * @brief 两个名称是否视为同一名称
+     */
+    bool same(QStringView a, QStringView b) const;
+
+    /**
+     * @brief 查找名称
+     * @param name              名称
+     * @param hash              hashOf(name)
+     * @return 名称所在的桶，名称不存在时返回应放入的空桶
+     */
+    int findBucket(QStringView name, size_t hash) const;
+
+    /**
+     * @brief 按当前占用的名称重建名称表和散列表
+     * @param bucketCount       桶数，须为2的幂
+     */
+    void rebuild(int bucketCount);
+
+    bool caseInsensitive;
+    FileTable table;                // 出现过的名称，大小写不同的同一名称只存第一种写法
+    QVector<int> counts;            // 与table一一对应；折叠后可能有多个名称对应同一个键，按计数管理
+    QVector<int> buckets;           // 开放寻址的散列表，存放table中的序号，-1为空
+    int live = 0;                   // 计数不为零的名称个数
+};
+
+/**
+ * @brief 安排重命名的执行顺序
+ *
+ * 目标名称是本批次中另一个文件的原名称时，不再直接判为冲突：把各条目看作原名称指向新名称的边，
+ * 新名称互不相同时每个名称至多一条入边、一条出边，整张图只由链和环组成。
+ * 链从目标空闲的一端开始逆序执行；每个环先把其中一个文件移到临时名称，环中其余文件依次就位后再移回，
+ * 长度为k的环只多一次重命名，整个置换一次执行完毕。
+ * 目标被不参与重命名的名称占用（或被前面的条目抢先占用）的条目判为冲突，其原名称随之保留，
+ * 指向它的条目同样判为冲突。
+ */
+class RenameScheduler
+{
+public:
+    /**
+     * @brief 安排执行顺序
+     * @param moves             按编号顺序排列的条目（状态均为Pending），新旧名称相同的条目不需要执行，会被去掉
+     * @param occupied          目录中已占用的名称，更新为全部执行后的状态
+     * @param temporaries       非空时返回使用的临时名称数
+     * @return 按执行顺序排列的条目，含冲突条目和经过临时名称的条目
+     */
+    static QVector<RenamePlan::Entry> schedule(const QVector<RenamePlan::Entry> &moves, NameIndex* occupied,
+                                               int* temporaries = nullptr);
+
+    /**
+     * @brief 并发执行时每个条目须等待完成的条目
+     *
+     * 条目的新名称是前面某个条目的原名称时，须等那个条目先移走；条目的原名称是前面某个条目的新名称时
+     * （经过临时名称的环），须等那个条目先就位。其余条目互不相关，可以同时执行。
+     * @param entries           schedule()排好顺序的条目，只考虑状态为Pending的条目
+     * @param caseInsensitive   名称是否按大小写折叠后比较，须与schedule()所用的NameIndex一致
+     * @return 各条目依赖的条目下标（均小于该条目的下标）
+     */
+    static QVector<QVector<int>> dependencies(const QVector<RenamePlan::Entry> &entries, bool caseInsensitive);
+
+    /**
+     * @brief 是否为临时名称（中断后可能残留，扫描时不参与重命名）
+     * @param name              名称
+     */
+    static bool isTemporaryName(const QString& name);
+};
+
+#endif // RENAMEPLAN_H
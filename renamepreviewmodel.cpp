@@ -0,0 +1,210 @@
+#include "renamepreviewmodel.h"
+
+#include "directoryrenamer.h"
+
+namespace
+{
+    // 每次fetchMore加入的行数
+    const int fetchBatch = 256;
+
+    // 筛选时每次fetchMore最多检查的条目数，避免匹配很少时一次遍历整个计划而卡住界面
+    const int scanBatch = 65536;
+} // namespace
+
+RenamePreviewModel::RenamePreviewModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    for(bool& show : shown)
+    {
+        show = true;
+    }
+}
+
+void RenamePreviewModel::setPlan(const RenamePlan& plan)
+{
+    beginResetModel();
+    renamePlan = plan;
+    rows.clear();
+    fetched = 0;
+    scanned = 0;
+    endResetModel();
+}
+
+void RenamePreviewModel::clear()
+{
+    setPlan(RenamePlan());
+}
+
+void RenamePreviewModel::setStatusFilter(const QVector<RenamePlan::Status>& statuses)
+{
+    beginResetModel();
+    filtering = !statuses.isEmpty();
+    for(bool& show : shown)
+    {
+        show = !filtering;
+    }
+    for(RenamePlan::Status status : statuses)
+    {
+        shown[int(status)] = true;
+    }
+    // 已加入的行作废，之后随滚动从头重新分批筛选
+    rows.clear();
+    fetched = 0;
+    scanned = 0;
+    endResetModel();
+}
+
+const RenamePlan& RenamePreviewModel::plan() const
+{
+    return renamePlan;
+}
+
+QString RenamePreviewModel::statusName(RenamePlan::Status status)
+{
+    switch(status)
+    {
+        case RenamePlan::Status::Pending:
+            return "Planned";
+        case RenamePlan::Status::Conflict:
+            return "Conflict";
+        case RenamePlan::Status::Renamed:
+            return "Renamed";
+        case RenamePlan::Status::Failed:
+            return "Failed";
+        case RenamePlan::Status::Duplicate:
+            return "Duplicate";
+    }
+    return QString();
+}
+
+int RenamePreviewModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : fetched;
+}
+
+int RenamePreviewModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant RenamePreviewModel::data(const QModelIndex& index, int role) const
+{
+    if(!index.isValid() || index.row() >= fetched || (role != Qt::DisplayRole && role != Qt::ToolTipRole))
+    {
+        return QVariant();
+    }
+    const RenamePlan::Entry& entry = renamePlan.entries[entryAt(index.row())];
+    switch(index.column())
+    {
+        case OldName:
+            return entry.oldName;
+        case NewName:
+            return entry.newName;
+        case Status:
+            // 提示中给出失败原因或重复文件的原件
+            if(role == Qt::ToolTipRole)
+            {
+                if(entry.error != 0)
+                {
+                    return DirectoryRenamer::errorString(entry.error);
+                }
+                if(!entry.duplicateOf.isEmpty())
+                {
+                    return "Same content as " + entry.duplicateOf;
+                }
+                return QVariant();
+            }
+            return statusName(entry.status);
+        default:
+            return QVariant();
+    }
+}
+
+QVariant RenamePreviewModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    if(orientation == Qt::Vertical)
+    {
+        return section + 1;
+    }
+    switch(section)
+    {
+        case OldName:
+            return "Old name";
+        case NewName:
+            return "New name";
+        case Status:
+            return "Status";
+        default:
+            return QVariant();
+    }
+}
+
+bool RenamePreviewModel::canFetchMore(const QModelIndex& parent) const
+{
+    if(parent.isValid())
+    {
+        return false;
+    }
+    return filtering ? scanned < renamePlan.entries.size() : fetched < renamePlan.entries.size();
+}
+
+void RenamePreviewModel::fetchMore(const QModelIndex& parent)
+{
+    if(parent.isValid())
+    {
+        return;
+    }
+    if(!filtering)
+    {
+        int count = qMin(fetchBatch, int(renamePlan.entries.size()) - fetched);
+        if(count <= 0)
+        {
+            return;
+        }
+        beginInsertRows(QModelIndex(), fetched, fetched + count - 1);
+        fetched += count;
+        endInsertRows();
+        return;
+    }
+    // 从上次停下的位置继续筛选，凑够一批或检查了足够多的条目就停
+    QVector<int> found;
+    int end = qMin(int(renamePlan.entries.size()), scanned + scanBatch);
+    while(scanned < end && found.size() < fetchBatch)
+    {
+        if(accepts(renamePlan.entries[scanned]))
+        {
+            found.append(scanned);
+        }
+        scanned++;
+    }
+    if(found.isEmpty())
+    {
+        // 这一段没有匹配的条目时视图不会再请求，在事件循环中接着筛选下一段
+        if(scanned < renamePlan.entries.size())
+        {
+            QMetaObject::invokeMethod(this, [this]()
+            {
+                fetchMore(QModelIndex());
+            }, Qt::QueuedConnection);
+        }
+        return;
+    }
+    beginInsertRows(QModelIndex(), fetched, fetched + found.size() - 1);
+    rows += found;
+    fetched += found.size();
+    endInsertRows();
+}
+
+int RenamePreviewModel::entryAt(int row) const
+{
+    return filtering ? rows[row] : row;
+}
+
+bool RenamePreviewModel::accepts(const RenamePlan::Entry& entry) const
+{
+    return shown[int(entry.status)];
+}
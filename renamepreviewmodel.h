@@ -0,0 +1,95 @@
+#ifndef RENAMEPREVIEWMODEL_H
+#define RENAMEPREVIEWMODEL_H
+
+/******************************************************************************
+ * @file       renamepreviewmodel.h
+ * @brief      重命名计划的预览表格模型
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include "renameplan.h"
+
+/**
+ * @brief 预览表格模型
+ *
+ * 直接引用计划中的条目（隐式共享，不复制），每个单元格的文字在视图请求时才生成，不为每行创建对象。
+ * 行按视图滚动分批加入（canFetchMore/fetchMore）：按状态筛选时每批只向后检查到凑够一批为止，
+ * 切换筛选条件不必先遍历整个计划。不筛选时不保存行号，筛选时每个可见行只占一个int。
+ */
+class RenamePreviewModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 列
+     */
+    enum Column
+    {
+        OldName,
+        NewName,
+        Status,
+        ColumnCount
+    };
+
+    explicit RenamePreviewModel(QObject *parent = nullptr);
+
+    /**
+     * @brief 显示新的计划，清除已加入的行
+     * @param plan              重命名计划
+     */
+    void setPlan(const RenamePlan& plan);
+
+    /**
+     * @brief 清空
+     */
+    void clear();
+
+    /**
+     * @brief 只显示给定状态的条目
+     * @param statuses          状态，为空时显示全部
+     */
+    void setStatusFilter(const QVector<RenamePlan::Status>& statuses);
+
+    /**
+     * @brief 当前计划
+     */
+    const RenamePlan& plan() const;
+
+    /**
+     * @brief 状态的显示名称
+     */
+    static QString statusName(RenamePlan::Status status);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+private:
+    /**
+     * @brief 可见行对应的条目下标
+     */
+    int entryAt(int row) const;
+
+    /**
+     * @brief 条目是否通过筛选
+     */
+    bool accepts(const RenamePlan::Entry& entry) const;
+
+    RenamePlan renamePlan;
+    bool filtering = false;
+    bool shown[RenamePlan::statusCount];    // 按RenamePlan::Status下标
+    QVector<int> rows;          // 筛选时可见行对应的条目下标
+    int fetched = 0;            // 已加入的行数
+    int scanned = 0;            // 已检查的条目数
+};
+
+#endif // RENAMEPREVIEWMODEL_H
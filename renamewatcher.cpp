@@ -0,0 +1,344 @@
+#include "renamewatcher.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <utility>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // 目录安静多久后处理攒下的事件（毫秒）
+    const int quietInterval = 500;
+
+    // 持续有文件放入时，一批最多推迟多久（毫秒）
+    const qint64 maxBatchDelay = 3000;
+} // namespace
+
+RenameWatcher::RenameWatcher(QObject *parent)
+    : QObject(parent)
+    , debounce(this)
+{
+    debounce.setSingleShot(true);
+    connect(&debounce, &QTimer::timeout, this, &RenameWatcher::processPending);
+}
+
+RenameWatcher::~RenameWatcher()
+{
+    stop();
+}
+
+QString RenameWatcher::start(const QString& format, const QVector<QString> &replacements, const QString& directory,
+                             const QString& extensionFilter, bool caseInsensitive)
+{
+    stop();
+    this->directory = QDir(directory).absolutePath();
+    this->format = format;
+    this->replacements = replacements;
+    this->extensionFilter = extensionFilter;
+    this->caseInsensitive = caseInsensitive;
+    // 先开始接收事件再做初始批次，扫描期间放入的文件不会漏掉
+    if(!QDir(this->directory).exists() || !startNotifications())
+    {
+        qWarning() << "Failed to watch directory: " << directory;
+        return "Failed to watch directory: " + directory;
+    }
+    // 统计只覆盖一批，长时间监视时区间记录不会无限增长
+    batchRenamer.stats().reset();
+    RenamePlan plan;
+    QString feedback = batchRenamer.startWatch(format, replacements, this->directory, extensionFilter, caseInsensitive, &plan);
+    if(!plan.error.isEmpty())
+    {
+        stopNotifications();
+        return feedback;
+    }
+    recordOwnRenames(plan);
+    active = true;
+    return feedback;
+}
+
+void RenameWatcher::stop()
+{
+    debounce.stop();
+    stopNotifications();
+    pendingSince.invalidate();
+    arrived.clear();
+    arrivedSet.clear();
+    removed.clear();
+    ownOldNames.clear();
+    ownNewNames.clear();
+    knownFiles.clear();
+    overflowed = false;
+    batchRenamer.stopWatch();
+    active = false;
+}
+
+bool RenameWatcher::isActive() const
+{
+    return active;
+}
+
+BatchRenamer& RenameWatcher::renamer()
+{
+    return batchRenamer;
+}
+
+bool RenameWatcher::startNotifications()
+{
+#ifdef Q_OS_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd >= 0)
+    {
+        // 只关心写完、移入、移出和删除；IN_CREATE时文件可能还没写完，不予理会
+        const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE
+                              | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+        if(inotify_add_watch(inotifyFd, QFile::encodeName(directory).constData(), mask) >= 0)
+        {
+            notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+            connect(notifier, &QSocketNotifier::activated, this, &RenameWatcher::readEvents);
+            return true;
+        }
+        qWarning() << "inotify_add_watch failed, falling back to QFileSystemWatcher: " << directory;
+        ::close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+    fallback = new QFileSystemWatcher(this);
+    if(!fallback->addPath(directory))
+    {
+        delete fallback;
+        fallback = nullptr;
+        return false;
+    }
+    connect(fallback, &QFileSystemWatcher::directoryChanged, this, &RenameWatcher::directoryChanged);
+    knownFiles = listFiles();
+    return true;
+}
+
+void RenameWatcher::stopNotifications()
+{
+    delete notifier;
+    notifier = nullptr;
+#ifdef Q_OS_LINUX
+    if(inotifyFd >= 0)
+    {
+        ::close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+    delete fallback;
+    fallback = nullptr;
+}
+
+void RenameWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    bool lost = false;
+    alignas(struct inotify_event) char buffer[16384];
+    while(true)
+    {
+        ssize_t length = ::read(inotifyFd, buffer, sizeof(buffer));
+        if(length <= 0)
+        {
+            break;
+        }
+        for(char* p = buffer; p < buffer + length;)
+        {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+            if(event->mask & IN_Q_OVERFLOW)
+            {
+                overflowed = true;
+                continue;
+            }
+            if(event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+            {
+                lost = true;
+                continue;
+            }
+            if((event->mask & IN_ISDIR) || event->len == 0)
+            {
+                continue;
+            }
+            QString fileName = QFile::decodeName(event->name);
+            if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            {
+                queueArrived(fileName);
+            }
+            else
+            {
+                queueRemoved(fileName);
+            }
+        }
+    }
+    if(lost)
+    {
+        QString reason = "Stopped watching, directory is no longer available: " + directory;
+        stop();
+        emit stopped(reason);
+        return;
+    }
+    schedule();
+#endif
+}
+
+void RenameWatcher::directoryChanged()
+{
+    if(!QDir(directory).exists())
+    {
+        QString reason = "Stopped watching, directory is no longer available: " + directory;
+        stop();
+        emit stopped(reason);
+        return;
+    }
+    // 没有逐文件事件时只能重新列出目录；仍然只有新出现的文件需要分类
+    QSet<QString> current = listFiles();
+    for(const QString& fileName : current)
+    {
+        if(!knownFiles.contains(fileName))
+        {
+            queueArrived(fileName);
+        }
+    }
+    for(const QString& fileName : std::as_const(knownFiles))
+    {
+        if(!current.contains(fileName))
+        {
+            queueRemoved(fileName);
+        }
+    }
+    knownFiles = current;
+    schedule();
+}
+
+QSet<QString> RenameWatcher::listFiles() const
+{
+    QSet<QString> result;
+    QDirIterator it(directory, QDir::Files | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+    while(it.hasNext())
+    {
+        it.next();
+        result.insert(it.fileName());
+    }
+    return result;
+}
+
+void RenameWatcher::queueArrived(const QString& fileName)
+{
+    if(ownNewNames.remove(fileName))
+    {
+        return;
+    }
+    if(!arrivedSet.contains(fileName))
+    {
+        arrivedSet.insert(fileName);
+        arrived.append(fileName);
+    }
+}
+
+void RenameWatcher::queueRemoved(const QString& fileName)
+{
+    if(ownOldNames.remove(fileName))
+    {
+        return;
+    }
+    removed.append(fileName);
+}
+
+void RenameWatcher::recordOwnRenames(const RenamePlan& plan)
+{
+    for(const RenamePlan::Entry& entry : plan.entries)
+    {
+        if(entry.status != RenamePlan::Status::Renamed)
+        {
+            continue;
+        }
+        if(fallback)
+        {
+            knownFiles.remove(entry.oldName);
+            knownFiles.insert(entry.newName);
+        }
+        else
+        {
+            ownOldNames.insert(entry.oldName);
+            ownNewNames.insert(entry.newName);
+        }
+    }
+}
+
+void RenameWatcher::schedule()
+{
+    if(arrived.isEmpty() && removed.isEmpty() && !overflowed)
+    {
+        return;
+    }
+    if(!pendingSince.isValid())
+    {
+        pendingSince.start();
+    }
+    // 每来一个事件都重新计时，但不超过整批的最长推迟时间
+    qint64 remaining = maxBatchDelay - pendingSince.elapsed();
+    debounce.start(int(qBound<qint64>(0, remaining, quietInterval)));
+}
+
+void RenameWatcher::processPending()
+{
+    pendingSince.invalidate();
+    if(!active)
+    {
+        return;
+    }
+    if(overflowed)
+    {
+        restart();
+        return;
+    }
+    QStringList arrivedNow = arrived;
+    QStringList removedNow = removed;
+    arrived.clear();
+    arrivedSet.clear();
+    removed.clear();
+    // 先释放移出的名称，同名文件随后又放入时仍会被处理
+    batchRenamer.forgetRemoved(removedNow);
+    if(arrivedNow.isEmpty())
+    {
+        return;
+    }
+    batchRenamer.stats().reset();
+    RenamePlan plan;
+    QString feedback = batchRenamer.renameArrived(arrivedNow, &plan);
+    recordOwnRenames(plan);
+    if(!plan.entries.isEmpty())
+    {
+        emit batchFinished(plan, feedback);
+    }
+}
+
+void RenameWatcher::restart()
+{
+    // 事件已经丢失，只能重新扫描整个目录并重新设定计数器
+    qWarning() << "Watch event queue overflowed, rescanning: " << directory;
+    overflowed = false;
+    arrived.clear();
+    arrivedSet.clear();
+    removed.clear();
+    ownOldNames.clear();
+    ownNewNames.clear();
+    batchRenamer.stats().reset();
+    RenamePlan plan;
+    QString feedback = batchRenamer.startWatch(format, replacements, directory, extensionFilter, caseInsensitive, &plan);
+    if(!plan.error.isEmpty())
+    {
+        stop();
+        emit stopped(feedback);
+        return;
+    }
+    recordOwnRenames(plan);
+    emit batchFinished(plan, feedback);
+}
@@ -0,0 +1,162 @@
+#ifndef RENAMEWATCHER_H
+#define RENAMEWATCHER_H
+
+/******************************************************************************
+ * @file       renamewatcher.h
+ * @brief      监视目录，对新放入的文件增量重命名
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include "batchrenamer.h"
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+
+/**
+ * @brief 目录监视器
+ *
+ * Linux下直接使用inotify，只接收文件写完（IN_CLOSE_WRITE）和移入（IN_MOVED_TO）的事件，
+ * 每个事件只处理对应的文件；其他平台退回QFileSystemWatcher，目录变化时重新列出目录并与上次比较。
+ * 事件先去重、攒批，目录安静一段时间（或攒批时间过长）后交给BatchRenamer::renameArrived。
+ * 自身重命名产生的事件会被忽略。
+ */
+class RenameWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RenameWatcher(QObject *parent = nullptr);
+    ~RenameWatcher();
+
+    /**
+     * @brief 开始监视：先重命名目录中已有的文件，再处理之后放入的文件
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param directory         重命名目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     * @param caseInsensitive   按不区分大小写的方式检测冲突
+     * @return 初始批次的操作结果信息，无法开始时isActive()为false
+     */
+    QString start(const QString& format, const QVector<QString> &replacements, const QString& directory,
+                  const QString& extensionFilter, bool caseInsensitive = false);
+
+    /**
+     * @brief 停止监视，尚未处理的事件被丢弃
+     */
+    void stop();
+
+    /**
+     * @brief 是否正在监视
+     */
+    bool isActive() const;
+
+    /**
+     * @brief 使用的重命名对象，可在开始前设置选项
+     */
+    BatchRenamer& renamer();
+
+signals:
+    /**
+     * @brief 一个批次处理完毕，此时renamer().stats()只含本批次的统计
+     * @param plan              本批次的计划（含执行结果）
+     * @param feedback          操作结果信息
+     */
+    void batchFinished(const RenamePlan& plan, const QString& feedback);
+
+    /**
+     * @brief 监视意外停止（目录被删除或移走等）
+     * @param reason            原因
+     */
+    void stopped(const QString& reason);
+
+private slots:
+    /**
+     * @brief 读取inotify事件
+     */
+    void readEvents();
+
+    /**
+     * @brief 目录变化（QFileSystemWatcher）
+     */
+    void directoryChanged();
+
+    /**
+     * @brief 处理攒下的事件
+     */
+    void processPending();
+
+private:
+    /**
+     * @brief 开始接收目录事件
+     * @return 成功时返回true
+     */
+    bool startNotifications();
+
+    /**
+     * @brief 停止接收目录事件
+     */
+    void stopNotifications();
+
+    /**
+     * @brief 列出目录中的文件名（QFileSystemWatcher模式使用）
+     */
+    QSet<QString> listFiles() const;
+
+    /**
+     * @brief 记录文件放入
+     */
+    void queueArrived(const QString& fileName);
+
+    /**
+     * @brief 记录文件移出或删除
+     */
+    void queueRemoved(const QString& fileName);
+
+    /**
+     * @brief 记录自身重命名涉及的名称，之后对应的事件会被忽略
+     * @param plan              已执行的计划
+     */
+    void recordOwnRenames(const RenamePlan& plan);
+
+    /**
+     * @brief 安排处理攒下的事件
+     */
+    void schedule();
+
+    /**
+     * @brief 事件队列溢出，重新扫描整个目录
+     */
+    void restart();
+
+    BatchRenamer batchRenamer;
+    QString directory;
+    QString format;
+    QVector<QString> replacements;
+    QString extensionFilter;
+    bool caseInsensitive = false;
+    bool active = false;
+
+    int inotifyFd = -1;
+    QSocketNotifier *notifier = nullptr;
+    QFileSystemWatcher *fallback = nullptr;
+    QSet<QString> knownFiles;           // QFileSystemWatcher模式下上次列出的文件
+
+    QTimer debounce;                    // 目录安静后处理
+    QElapsedTimer pendingSince;         // 最早一个未处理事件的时间
+    QStringList arrived;                // 放入的文件，按事件顺序
+    QSet<QString> arrivedSet;
+    QStringList removed;                // 移出或删除的文件
+    QSet<QString> ownOldNames;          // 自身重命名移出的名称，对应事件到达时忽略
+    QSet<QString> ownNewNames;          // 自身重命名移入的名称，对应事件到达时忽略
+    bool overflowed = false;            // 事件队列曾溢出
+};
+
+#endif // RENAMEWATCHER_H
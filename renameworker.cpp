@@ -0,0 +1,147 @@
+#include "renameworker.h"
+
+namespace
+{
+    // 两次进度信号之间的最短间隔（毫秒）
+    const qint64 progressInterval = 100;
+} // namespace
+
+RenameWorker::RenameWorker(QObject *parent)
+    : QObject(parent)
+    , watcher(new RenameWatcher(this))
+{
+    connect(watcher, &RenameWatcher::batchFinished, this, [this](const RenamePlan&, const QString& feedback)
+    {
+        emit watchChanged(true, feedback);
+    });
+    connect(watcher, &RenameWatcher::stopped, this, [this](const QString& reason)
+    {
+        emit watchChanged(false, reason);
+    });
+    auto report = [this](const BatchRenamer::Progress& p)
+    {
+        // 逐文件回调，但只按固定间隔发出信号，避免界面刷新成为瓶颈
+        if(throttle.isValid() && throttle.elapsed() < progressInterval)
+        {
+            return;
+        }
+        throttle.restart();
+        emit progress(p.scanned, p.matched, p.renamed, p.failed);
+    };
+    renamer.setProgressCallback(report);
+    // 递归模式的回调来自多个线程，已由TreeRenamer串行化
+    tree.setProgressCallback(report);
+}
+
+void RenameWorker::cancel()
+{
+    renamer.cancel();
+    tree.cancel();
+    watcher->renamer().cancel();
+}
+
+void RenameWorker::resetCancel()
+{
+    renamer.resetCancel();
+    tree.resetCancel();
+    watcher->renamer().resetCancel();
+}
+
+void RenameWorker::setContentSniffing(bool enabled)
+{
+    renamer.setContentSniffing(enabled);
+    tree.renamer().setContentSniffing(enabled);
+    watcher->renamer().setContentSniffing(enabled);
+}
+
+void RenameWorker::setNumberingIndex(bool enabled)
+{
+    renamer.setNumberingIndex(enabled);
+    tree.renamer().setNumberingIndex(enabled);
+    watcher->renamer().setNumberingIndex(enabled);
+}
+
+void RenameWorker::setNumberingOrder(FileOrder::Key key)
+{
+    renamer.setNumberingOrder(key);
+    tree.renamer().setNumberingOrder(key);
+    watcher->renamer().setNumberingOrder(key);
+}
+
+void RenameWorker::setDuplicateMode(BatchRenamer::DuplicateMode mode)
+{
+    renamer.setDuplicateMode(mode);
+    tree.renamer().setDuplicateMode(mode);
+    watcher->renamer().setDuplicateMode(mode);
+}
+
+void RenameWorker::run(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter)
+{
+    throttle.invalidate();
+    renamer.stats().reset();
+    RenamePlan plan;
+    QString feedback = renamer.renameFiles(format, replacements, directory, extensionFilter, &plan);
+    // 计划的条目隐式共享，发往界面线程不复制
+    emit planReady(plan);
+    // 第二行给出各阶段的计数和耗时，便于判断慢在哪里
+    emit finished(feedback + "\n" + renamer.stats().summary());
+}
+
+void RenameWorker::runPreview(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter)
+{
+    throttle.invalidate();
+    renamer.stats().reset();
+    RenamePlan plan = renamer.plan(format, replacements, directory, extensionFilter);
+    emit planReady(plan);
+    QString feedback = plan.error;
+    if(plan.error.isEmpty())
+    {
+        feedback = "Planned " + QString::number(plan.count(RenamePlan::Status::Pending)) + " rename(s), "
+                   + QString::number(plan.count(RenamePlan::Status::Conflict)) + " conflict(s).";
+    }
+    emit finished(feedback + "\n" + renamer.stats().summary());
+}
+
+void RenameWorker::runRecursive(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter)
+{
+    throttle.invalidate();
+    TreeRenamer::Summary summary = tree.run(format, replacements, directory, extensionFilter);
+    emit finished(tree.describe(summary) + "\n" + summary.stats.summary());
+}
+
+void RenameWorker::runRules(const QString& rulesPath, const QString& directory)
+{
+    throttle.invalidate();
+    renamer.stats().reset();
+    QString feedback = renamer.renameTree(rulesPath, directory);
+    emit finished(feedback + "\n" + renamer.stats().summary());
+}
+
+void RenameWorker::runUndo(const QString& directory)
+{
+    throttle.invalidate();
+    renamer.stats().reset();
+    QString feedback = renamer.undo(directory);
+    emit finished(feedback + "\n" + renamer.stats().summary());
+}
+
+void RenameWorker::runResume(const QString& directory)
+{
+    throttle.invalidate();
+    renamer.stats().reset();
+    QString feedback = renamer.resume(directory);
+    emit finished(feedback + "\n" + renamer.stats().summary());
+}
+
+void RenameWorker::runWatch(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter)
+{
+    throttle.invalidate();
+    QString feedback = watcher->start(format, replacements, directory, extensionFilter);
+    emit watchChanged(watcher->isActive(), feedback);
+}
+
+void RenameWorker::stopWatch()
+{
+    watcher->stop();
+    emit watchChanged(false, "Stopped watching.");
+}
@@ -0,0 +1,156 @@
+#ifndef RENAMEWORKER_H
+#define RENAMEWORKER_H
+
+/******************************************************************************
+ * @file       renameworker.h
+ * @brief      在后台线程中执行批量重命名
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QObject>
+#include <QElapsedTimer>
+#include "batchrenamer.h"
+#include "renamewatcher.h"
+#include "treerenamer.h"
+
+/**
+ * @brief 重命名工作对象，移入后台线程后通过信号汇报进度
+ */
+class RenameWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RenameWorker(QObject *parent = nullptr);
+
+    /**
+     * @brief 请求取消当前批次，可从任意线程调用
+     */
+    void cancel();
+
+    /**
+     * @brief 清除取消请求，可从任意线程调用；在排队新任务时调用，排队后、开始前的取消请求仍然有效
+     */
+    void resetCancel();
+
+    /**
+     * @brief 设置是否按文件头识别扩展名错误或缺失的文件，需在工作线程中调用
+     * @param enabled           是否开启
+     */
+    void setContentSniffing(bool enabled);
+
+    /**
+     * @brief 设置是否使用编号索引，需在工作线程中调用
+     * @param enabled           是否开启
+     */
+    void setNumberingIndex(bool enabled);
+
+    /**
+     * @brief 设置编号顺序，需在工作线程中调用
+     * @param key               排序依据
+     */
+    void setNumberingOrder(FileOrder::Key key);
+
+    /**
+     * @brief 设置重复文件的处理方式，需在工作线程中调用
+     * @param mode              处理方式
+     */
+    void setDuplicateMode(BatchRenamer::DuplicateMode mode);
+
+public slots:
+    /**
+     * @brief 执行批量重命名
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param directory         重命名目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     */
+    void run(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter);
+
+    /**
+     * @brief 只生成计划，不修改文件
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param directory         重命名目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     */
+    void runPreview(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter);
+
+    /**
+     * @brief 递归重命名目录及其所有子文件夹，各文件夹分别编号、并行处理
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param directory         根目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     */
+    void runRecursive(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter);
+
+    /**
+     * @brief 按规则文件重命名整个目录树
+     * @param rulesPath         规则文件（JSON）路径
+     * @param directory         根目录
+     */
+    void runRules(const QString& rulesPath, const QString& directory);
+
+    /**
+     * @brief 撤销目录中最近一个批次
+     * @param directory         重命名目录
+     */
+    void runUndo(const QString& directory);
+
+    /**
+     * @brief 续做目录中被中断的批次
+     * @param directory         重命名目录
+     */
+    void runResume(const QString& directory);
+
+    /**
+     * @brief 重命名目录中已有的文件，之后持续监视并重命名新放入的文件
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param directory         重命名目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     */
+    void runWatch(const QString& format, const QVector<QString> &replacements, const QString& directory, const QString& extensionFilter);
+
+    /**
+     * @brief 停止监视
+     */
+    void stopWatch();
+
+signals:
+    /**
+     * @brief 进度更新（已节流）
+     */
+    void progress(int scanned, int matched, int renamed, int failed);
+
+    /**
+     * @brief 批次结束
+     * @param feedback          操作结果信息
+     */
+    void finished(const QString& feedback);
+
+    /**
+     * @brief 生成或执行了计划，用于预览
+     * @param plan              计划（执行后含各条目的结果）
+     */
+    void planReady(const RenamePlan& plan);
+
+    /**
+     * @brief 监视状态变化或监视中完成一个批次
+     * @param active            是否仍在监视
+     * @param feedback          操作结果信息
+     */
+    void watchChanged(bool active, const QString& feedback);
+
+private:
+    BatchRenamer renamer;
+    TreeRenamer tree;           // 递归模式
+    RenameWatcher *watcher;     // 监视模式，随工作对象移入后台线程
+    QElapsedTimer throttle;     // 进度信号节流计时
+};
+
+#endif // RENAMEWORKER_H
@@ -0,0 +1,154 @@
+#include "ruleset.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "formatpreset.h"
+
+bool RuleSet::load(const QString& filePath, QString* error)
+{
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        *error = "Failed to open rule file: " + filePath;
+        return false;
+    }
+    return parse(file.readAll(), error);
+}
+
+bool RuleSet::parse(const QByteArray& json, QString* error)
+{
+    ruleList.clear();
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if(parseError.error != QJsonParseError::NoError)
+    {
+        *error = "Invalid rule file: " + parseError.errorString();
+        return false;
+    }
+    QJsonArray rules = document.object().value("rules").toArray();
+    if(rules.isEmpty())
+    {
+        *error = "Rule file contains no rules.";
+        return false;
+    }
+    for(int i = 0; i < rules.size(); i++)
+    {
+        QJsonObject object = rules[i].toObject();
+        RenameRule rule;
+        rule.name = "rule " + QString::number(i + 1);
+        // 先取预设，再由单独给出的字段覆盖
+        QString format;
+        QString content;
+        int type = 0;
+        QString customType;
+        if(object.contains("preset"))
+        {
+            QString presetName = object.value("preset").toString();
+            int index = FormatPreset::indexOf(presetName);
+            if(index < 0)
+            {
+                *error = "Unknown preset in " + rule.name + ": " + presetName;
+                ruleList.clear();
+                return false;
+            }
+            format = preset[index].getFormat();
+            content = preset[index].getDefaultContent();
+            type = preset[index].getType();
+            customType = preset[index].getCustomType();
+            rule.name += " (" + presetName + ")";
+        }
+        if(object.contains("format"))
+        { format = object.value("format").toString(); }
+        if(object.contains("content"))
+        { content = object.value("content").toString(); }
+        if(object.contains("type") && !FormatPreset::parseTypes(object.value("type").toString(), &type))
+        {
+            *error = "Unknown file type in " + rule.name + ": " + object.value("type").toString();
+            ruleList.clear();
+            return false;
+        }
+        if(object.contains("extension"))
+        { customType = object.value("extension").toString(); }
+        if(format.isEmpty())
+        {
+            *error = "No format given in " + rule.name;
+            ruleList.clear();
+            return false;
+        }
+        QString path = object.value("path").toString();
+        if(!path.isEmpty())
+        {
+            rule.path.setPattern(globToRegex(path));
+        }
+        rule.format = format;
+        rule.replacements = FormatPreset::parseContent(content, format);
+        rule.extensionFilter = FormatPreset::buildExtensionFilter(type, customType);
+        ruleList.append(rule);
+    }
+    return true;
+}
+
+const QVector<RenameRule>& RuleSet::rules() const
+{
+    return ruleList;
+}
+
+QVector<int> RuleSet::rulesFor(const QString& relativePath) const
+{
+    QVector<int> result;
+    for(int i = 0; i < ruleList.size(); i++)
+    {
+        if(ruleList[i].path.pattern().isEmpty() || ruleList[i].path.match(relativePath).hasMatch())
+        {
+            result.append(i);
+        }
+    }
+    return result;
+}
+
+QString RuleSet::globToRegex(const QString& glob)
+{
+    QString result = "^";
+    int i = 0;
+    while(i < glob.size())
+    {
+        // “/**”位于末尾或后跟“/”时也匹配零级目录，如“活动/**”匹配“活动”本身
+        if(glob.mid(i, 3) == "/**" && (i + 3 == glob.size() || glob[i + 3] == '/'))
+        {
+            result += "(/.*)?";
+            i += 3;
+        }
+        else
+            if(i == 0 && glob.startsWith("**/"))
+            {
+                result += "(.*/)?";
+                i += 3;
+            }
+            else
+                if(glob.mid(i, 2) == "**")
+                {
+                    result += ".*";
+                    i += 2;
+                }
+                else
+                    if(glob[i] == '*')
+                    {
+                        result += "[^/]*";
+                        i++;
+                    }
+                    else
+                        if(glob[i] == '?')
+                        {
+                            result += "[^/]";
+                            i++;
+                        }
+                        else
+                        {
+                            result += QRegularExpression::escape(glob.mid(i, 1));
+                            i++;
+                        }
+    }
+    return result + "$";
+}
@@ -0,0 +1,80 @@
+#ifndef RULESET_H
+#define RULESET_H
+
+/******************************************************************************
+ * @file       ruleset.h
+ * @brief      按目录和文件类型选择预设的规则集
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief 一条规则：目录匹配时，扩展名通过过滤器的文件按该规则的格式命名
+ */
+struct RenameRule
+{
+    QString name;                   // 用于报错的名称，如“rule 2 (activity)”
+    QRegularExpression path;        // 相对根目录的目录路径，模式为空时匹配所有目录
+    QString format;                 // 命名格式
+    QVector<QString> replacements;  // 占位符
+    QString extensionFilter;        // 扩展名过滤器（正则表达式）
+};
+
+/**
+ * @brief 规则集
+ *
+ * 从JSON文件读取，格式如下（完整示例见README）：
+ * {"rules": [{"path": "活动", "preset": "activity", "content": "Date: %{date:MMdd}, Name: 张三"}, ...]}
+ * path为目录相对根目录的路径（根目录本身为空）的通配符，单个星号匹配一级目录名中的任意字符，两个星号可跨越多级，
+ * 缺省时匹配所有目录；preset为内置预设的名称，format、content、type（pic、vid、doc，逗号分隔）、extension单独给出时覆盖预设。
+ * 每个文件按顺序使用第一条目录匹配且扩展名通过过滤器的规则，没有匹配的规则时不重命名。
+ */
+class RuleSet
+{
+public:
+    /**
+     * @brief 从文件读取规则
+     * @param filePath          JSON文件路径
+     * @param error             失败时的错误信息
+     * @return 成功时返回true
+     */
+    bool load(const QString& filePath, QString* error);
+
+    /**
+     * @brief 从JSON文本读取规则
+     * @param json              JSON文本
+     * @param error             失败时的错误信息
+     * @return 成功时返回true
+     */
+    bool parse(const QByteArray& json, QString* error);
+
+    /**
+     * @brief 全部规则
+     */
+    const QVector<RenameRule>& rules() const;
+
+    /**
+     * @brief 目录适用的规则，按规则顺序排列
+     * @param relativePath      目录相对根目录的路径，根目录本身为空
+     * @return 规则下标
+     */
+    QVector<int> rulesFor(const QString& relativePath) const;
+
+    /**
+     * @brief 把路径通配符转换为正则表达式
+     * @param glob              通配符，单个星号和问号不跨越目录分隔符，两个星号可跨越
+     * @return 完整匹配的正则表达式
+     */
+    static QString globToRegex(const QString& glob);
+
+private:
+    QVector<RenameRule> ruleList;
+};
+
+#endif // RULESET_H
@@ -0,0 +1,212 @@
+#include "runstats.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QStringList>
+#include <chrono>
+#include <cstring>
+
+RunStats::Scope::Scope(RunStats* stats, Phase phase)
+    : stats(stats)
+    , phase(phase)
+    , start(RunStats::now())
+{
+}
+
+RunStats::Scope::~Scope()
+{
+    stats->addSpan(phase, start, RunStats::now() - start);
+}
+
+RunStats::RunStats()
+{
+    reset();
+}
+
+qint64 RunStats::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RunStats::addSpan(Phase phase, qint64 start, qint64 nanoseconds)
+{
+    times[int(phase)] += nanoseconds;
+    spans.append({phase, thread, start, nanoseconds, context});
+}
+
+qint64 RunStats::value(Counter counter) const
+{
+    return counters[int(counter)];
+}
+
+qint64 RunStats::time(Phase phase) const
+{
+    return times[int(phase)];
+}
+
+void RunStats::setContext(const QString& directory)
+{
+    context = directory;
+}
+
+void RunStats::setThread(int thread)
+{
+    this->thread = thread;
+}
+
+void RunStats::reset()
+{
+    std::memset(counters, 0, sizeof(counters));
+    std::memset(times, 0, sizeof(times));
+    spans.clear();
+    context.clear();
+}
+
+void RunStats::merge(const RunStats& other)
+{
+    for(int i = 0; i < int(Counter::Count); i++)
+    {
+        counters[i] += other.counters[i];
+    }
+    for(int i = 0; i < int(Phase::Count); i++)
+    {
+        times[i] += other.times[i];
+    }
+    spans += other.spans;
+}
+
+QString RunStats::summary() const
+{
+    // 只列出耗时不少于1毫秒的阶段，按阶段顺序
+    QStringList phases;
+    for(int i = 0; i < int(Phase::Count); i++)
+    {
+        if(times[i] >= 1000000)
+        {
+            phases.append(phaseName(Phase(i)) + " " + QString::number(times[i] / 1000000) + " ms");
+        }
+    }
+    QString result = QString("%1 enumerated, %2 filtered, %3 conforming, %4 to rename, %5 conflict(s), "
+                             "%6 regex compile(s), %7 syscall(s), %8 KiB of names")
+                     .arg(value(Counter::Enumerated)).arg(value(Counter::Filtered))
+                     .arg(value(Counter::Conforming)).arg(value(Counter::Candidates))
+                     .arg(value(Counter::Conflicts)).arg(value(Counter::RegexCompiles))
+                     .arg(value(Counter::Syscalls)).arg(value(Counter::NameBytes) / 1024);
+    if(!phases.isEmpty())
+    {
+        result += "; " + phases.join(", ");
+    }
+    return result;
+}
+
+QJsonObject RunStats::toJson() const
+{
+    QJsonObject result;
+    for(int i = 0; i < int(Counter::Count); i++)
+    {
+        result[counterName(Counter(i))] = counters[i];
+    }
+    QJsonObject phases;
+    for(int i = 0; i < int(Phase::Count); i++)
+    {
+        phases[phaseName(Phase(i))] = times[i] / 1e6;
+    }
+    result["ms"] = phases;
+    return result;
+}
+
+QJsonArray RunStats::traceEvents() const
+{
+    QJsonArray events;
+    for(const Span& span : spans)
+    {
+        QJsonObject event;
+        event["name"] = phaseName(span.phase);
+        event["cat"] = "rename";
+        event["ph"] = "X";
+        event["ts"] = span.start / 1e3;     // 微秒
+        event["dur"] = span.duration / 1e3;
+        event["pid"] = 1;
+        event["tid"] = span.thread;
+        if(!span.directory.isEmpty())
+        {
+            event["args"] = QJsonObject{{"directory", span.directory}};
+        }
+        events.append(event);
+    }
+    return events;
+}
+
+bool RunStats::writeTrace(const QString& filePath, const QJsonArray& events, QString* error)
+{
+    QFile file(filePath);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        *error = "Failed to write trace: " + filePath;
+        return false;
+    }
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+QString RunStats::phaseName(Phase phase)
+{
+    switch(phase)
+    {
+        case Phase::Parse:
+            return "parse";
+        case Phase::Enumerate:
+            return "enumerate";
+        case Phase::Filter:
+            return "filter";
+        case Phase::Match:
+            return "match";
+        case Phase::Sort:
+            return "sort";
+        case Phase::Metadata:
+            return "metadata";
+        case Phase::Duplicates:
+            return "duplicates";
+        case Phase::Generate:
+            return "generate";
+        case Phase::Schedule:
+            return "schedule";
+        case Phase::Journal:
+            return "journal";
+        case Phase::Rename:
+            return "rename";
+        case Phase::Count:
+            break;
+    }
+    return QString();
+}
+
+QString RunStats::counterName(Counter counter)
+{
+    switch(counter)
+    {
+        case Counter::Enumerated:
+            return "enumerated";
+        case Counter::Filtered:
+            return "filtered";
+        case Counter::Conforming:
+            return "conforming";
+        case Counter::Candidates:
+            return "candidates";
+        case Counter::Conflicts:
+            return "conflicts";
+        case Counter::RegexCompiles:
+            return "regexCompiles";
+        case Counter::Syscalls:
+            return "syscalls";
+        case Counter::NameBytes:
+            return "nameBytes";
+        case Counter::Count:
+            break;
+    }
+    return QString();
+}
@@ -0,0 +1,200 @@
+#ifndef RUNSTATS_H
+#define RUNSTATS_H
+
+/******************************************************************************
+ * @file       runstats.h
+ * @brief      重命名各阶段的计数、计时和跟踪记录
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief 一次运行的统计
+ *
+ * 计数和计时都是普通整数累加，逐文件的阶段（扩展名过滤、格式匹配）只累加耗时，不记录跟踪区间；
+ * 其余阶段每次执行记录一个区间，可导出为Chrome跟踪格式（chrome://tracing、Perfetto可直接打开）。
+ * 统计对象不加锁，每个线程使用自己的对象，结束后再合并。
+ */
+class RunStats
+{
+public:
+    /**
+     * @brief 阶段
+     */
+    enum class Phase
+    {
+        Parse,      // 解析、编译格式和扩展名过滤器
+        Enumerate,  // 枚举目录（不含过滤和匹配）
+        Filter,     // 扩展名过滤和按文件头识别
+        Match,      // 格式匹配和提取编号
+        Sort,       // 按编号顺序排序
+        Metadata,   // 读取元数据
+        Duplicates, // 查找重复文件
+        Generate,   // 生成新文件名
+        Schedule,   // 安排执行顺序、检测冲突
+        Journal,    // 写日志
+        Rename,     // 重命名系统调用
+        Count
+    };
+
+    /**
+     * @brief 计数项
+     */
+    enum class Counter
+    {
+        Enumerated,     // 枚举到的目录项
+        Filtered,       // 通过扩展名过滤的文件
+        Conforming,     // 已符合格式的文件
+        Candidates,     // 需要重命名的文件
+        Conflicts,      // 因目标已存在而跳过的文件
+        RegexCompiles,  // 编译的正则表达式
+        Syscalls,       // 重命名相关的系统调用
+        NameBytes,      // 为文件名分配的字节数
+        Count
+    };
+
+    /**
+     * @brief 作用域计时：析构时累加耗时并记录一个区间
+     */
+    class Scope
+    {
+    public:
+        Scope(RunStats* stats, Phase phase);
+        ~Scope();
+
+    private:
+        RunStats* stats;
+        Phase phase;
+        qint64 start;
+    };
+
+    RunStats();
+
+    /**
+     * @brief 当前时间（纳秒，单调时钟）
+     */
+    static qint64 now();
+
+    /**
+     * @brief 累加计数
+     * @param counter           计数项
+     * @param amount            增加量
+     */
+    void add(Counter counter, qint64 amount = 1)
+    {
+        counters[int(counter)] += amount;
+    }
+
+    /**
+     * @brief 累加耗时，不记录区间
+     * @param phase             阶段
+     * @param nanoseconds       耗时（纳秒）
+     */
+    void addTime(Phase phase, qint64 nanoseconds)
+    {
+        times[int(phase)] += nanoseconds;
+    }
+
+    /**
+     * @brief 累加耗时并记录一个区间
+     * @param phase             阶段
+     * @param start             开始时间（now()的返回值）
+     * @param nanoseconds       耗时（纳秒）
+     */
+    void addSpan(Phase phase, qint64 start, qint64 nanoseconds);
+
+    /**
+     * @brief 计数值
+     */
+    qint64 value(Counter counter) const;
+
+    /**
+     * @brief 阶段累计耗时（纳秒）
+     */
+    qint64 time(Phase phase) const;
+
+    /**
+     * @brief 设置之后记录的区间所属的目录
+     * @param directory         目录
+     */
+    void setContext(const QString& directory);
+
+    /**
+     * @brief 设置跟踪中的线程编号
+     * @param thread            线程编号
+     */
+    void setThread(int thread);
+
+    /**
+     * @brief 清空全部统计
+     */
+    void reset();
+
+    /**
+     * @brief 合并另一个对象的统计
+     * @param other             另一个对象
+     */
+    void merge(const RunStats& other);
+
+    /**
+     * @brief 单行摘要，用于界面和日志
+     */
+    QString summary() const;
+
+    /**
+     * @brief 计数和各阶段耗时（毫秒）
+     */
+    QJsonObject toJson() const;
+
+    /**
+     * @brief Chrome跟踪格式的事件
+     */
+    QJsonArray traceEvents() const;
+
+    /**
+     * @brief 写出Chrome跟踪文件
+     * @param filePath          文件路径
+     * @param events            事件
+     * @param error             失败时的错误信息
+     * @return 成功时返回true
+     */
+    static bool writeTrace(const QString& filePath, const QJsonArray& events, QString* error);
+
+    /**
+     * @brief 阶段名称
+     */
+    static QString phaseName(Phase phase);
+
+    /**
+     * @brief 计数项名称
+     */
+    static QString counterName(Counter counter);
+
+private:
+    /**
+     * @brief 跟踪区间
+     */
+    struct Span
+    {
+        Phase phase;
+        int thread;
+        qint64 start;               // 纳秒
+        qint64 duration;            // 纳秒
+        QString directory;
+    };
+
+    qint64 counters[int(Counter::Count)];
+    qint64 times[int(Phase::Count)];
+    QVector<Span> spans;
+    QString context;
+    int thread = 0;
+};
+
+#endif // RUNSTATS_H
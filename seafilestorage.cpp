@@ -0,0 +1,467 @@
+#include "seafilestorage.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QEventLoop>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <cerrno>
+#include <deque>
+
+namespace
+{
+    // QNetworkAccessManager对同一主机最多同时建立6个HTTP/1.1连接，更多的请求只会排队
+    const int maxConcurrency = 6;
+
+    // 等待单个响应完成
+    void waitFor(QNetworkReply* reply)
+    {
+        if(reply->isFinished())
+        {
+            return;
+        }
+        QEventLoop loop;
+        QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    // 在事件循环中等待一段时间
+    void sleepFor(int milliseconds)
+    {
+        QEventLoop loop;
+        QTimer::singleShot(milliseconds, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    int httpStatus(QNetworkReply* reply)
+    {
+        return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    }
+} // namespace
+
+SeafileStorage::SeafileStorage(const Options& options)
+    : options(options)
+{
+}
+
+bool SeafileStorage::list(const QString& directory, QVector<StorageEntry>* entries, QString* error)
+{
+    QNetworkAccessManager manager;
+    int status = 0;
+    QByteArray body;
+    QString message;
+    QString path = normalize(directory);
+    get(manager, endpoint("dir", path.isEmpty() ? "/" : path), &status, &body, &message);
+    if(status == 404)
+    {
+        *error = "Directory does not exist: " + directory;
+        return false;
+    }
+    if(status != 200)
+    {
+        *error = "Failed to list " + directory + ": " + (status == 0 ? message : "HTTP " + QString::number(status));
+        return false;
+    }
+    // v2.1接口返回{"dirent_list": [...]}，旧接口直接返回数组
+    QJsonDocument document = QJsonDocument::fromJson(body);
+    QJsonArray items = document.isArray() ? document.array() : document.object().value("dirent_list").toArray();
+    if(!document.isArray() && !document.object().contains("dirent_list"))
+    {
+        *error = "Failed to list " + directory + ": unexpected response";
+        return false;
+    }
+    entries->clear();
+    entries->reserve(items.size());
+    for(const QJsonValue& value : std::as_const(items))
+    {
+        QJsonObject item = value.toObject();
+        StorageEntry entry;
+        entry.name = item.value("name").toString();
+        entry.isDirectory = item.value("type").toString() == "dir";
+        entry.size = item.value("size").toVariant().toLongLong();
+        entry.modified = item.value("mtime").toVariant().toLongLong();
+        if(!entry.name.isEmpty())
+        {
+            entries->append(entry);
+        }
+    }
+    return true;
+}
+
+qint64 SeafileStorage::renameAll(const QString& directory, QVector<RenamePlan::Entry>* entries, bool caseInsensitive,
+                                 const QAtomicInt& cancel, const std::function<void(int)>& finished, QStringList* stranded)
+{
+    const QString base = normalize(directory);
+    const int count = entries->size();
+    // 依赖关系：remaining为尚未完成的前置条目数，为0时进入就绪队列
+    QVector<QVector<int>> dependents(count);
+    QVector<int> remaining(count, 0);
+    {
+        QVector<QVector<int>> dependencies = RenameScheduler::dependencies(*entries, caseInsensitive);
+        for(int i = 0; i < count; i++)
+        {
+            remaining[i] = dependencies[i].size();
+            for(int dependency : std::as_const(dependencies[i]))
+            {
+                dependents[dependency].append(i);
+            }
+        }
+    }
+    // 环中移入临时名称的条目与把临时名称移到最终名称的条目一一对应
+    QVector<int> closer(count, -1);
+    QVector<int> opener(count, -1);
+    {
+        QHash<QString, int> temporaries;
+        for(int i = 0; i < count; i++)
+        {
+            if(RenameScheduler::isTemporaryName((*entries)[i].newName))
+            {
+                temporaries.insert((*entries)[i].newName, i);
+            }
+        }
+        for(int i = 0; i < count; i++)
+        {
+            int j = temporaries.value((*entries)[i].oldName, -1);
+            if(j >= 0)
+            {
+                closer[j] = i;
+                opener[i] = j;
+            }
+        }
+    }
+    std::deque<int> ready;
+    for(int i = 0; i < count; i++)
+    {
+        if((*entries)[i].status == RenamePlan::Status::Pending && remaining[i] == 0)
+        {
+            ready.push_back(i);
+        }
+    }
+    QVector<bool> held(count, false);       // 已移入临时名称、等环闭合后再报告的条目
+    QNetworkAccessManager manager;
+    QEventLoop loop;
+    int inFlight = 0;                       // 已发出或等待重试的请求数
+    qint64 requests = 0;
+
+    // 重命名请求的结果：最后一次的响应（等待重试时被取消则为空），以及之前是否有请求没有收到响应（可能已经生效）
+    using Done = std::function<void(QNetworkReply*, bool)>;
+    // 发出重命名请求，网络错误、429和5xx按退避重试；recovering为true时取消后仍继续（用于移回临时名称）
+    std::function<void(const QString&, const QString&, int, bool, bool, const Done&)> send =
+        [&](const QString& from, const QString& to, int attempt, bool unanswered, bool recovering, const Done& done)
+    {
+        requests++;
+        QNetworkRequest renameRequest = request(endpoint("file", base + "/" + from));
+        renameRequest.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+        QByteArray form = "operation=rename&newname=" + QUrl::toPercentEncoding(to);
+        QNetworkReply* reply = manager.post(renameRequest, form);
+        QObject::connect(reply, &QNetworkReply::finished, &loop, [&, from, to, attempt, unanswered, recovering, done, reply]()
+        {
+            reply->deleteLater();
+            if(retryable(reply) && attempt < options.maxRetries && (recovering || !cancel.loadRelaxed()))
+            {
+                bool retryUnanswered = unanswered || httpStatus(reply) == 0;
+                QTimer::singleShot(backoff(reply, attempt), &loop, [&, from, to, attempt, retryUnanswered, recovering, done]()
+                {
+                    // 等待期间已取消时不再发出请求
+                    if(!recovering && cancel.loadRelaxed())
+                    {
+                        done(nullptr, retryUnanswered);
+                        return;
+                    }
+                    send(from, to, attempt + 1, retryUnanswered, recovering, done);
+                });
+                return;
+            }
+            done(reply, unanswered);
+        });
+    };
+
+    std::function<void()> pump;
+    std::function<void(int, int)> complete;
+    // 文件无法移回，留在临时名称下：按失败报告，并告知调用者临时名称
+    auto strand = [&](int i, int error)
+    {
+        RenamePlan::Entry& entry = (*entries)[i];
+        qWarning() << "Failed to restore" << entry.newName << "to" << entry.oldName << ", the file remains at" << entry.newName;
+        entry.status = RenamePlan::Status::Failed;
+        entry.error = error;
+        stranded->append(entry.newName);
+        finished(i);
+    };
+    // 把已移入临时名称的条目移回原名称；成功时该条目按失败报告，文件保持原名。
+    // 原名称已被环中下一步移入的文件占用时不再尝试
+    auto restore = [&](int i, int error)
+    {
+        held[i] = false;
+        for(int dependent : std::as_const(dependents[i]))
+        {
+            if(dependent != closer[i] && (*entries)[dependent].status == RenamePlan::Status::Renamed)
+            {
+                strand(i, error);
+                return;
+            }
+        }
+        inFlight++;
+        RenamePlan::Entry& entry = (*entries)[i];
+        send(entry.newName, entry.oldName, 0, false, true, [&, i, error](QNetworkReply* reply, bool)
+        {
+            int status = reply ? httpStatus(reply) : 0;
+            if(status == 200)
+            {
+                (*entries)[i].status = RenamePlan::Status::Failed;
+                (*entries)[i].error = error;
+                finished(i);
+            }
+            else
+            {
+                strand(i, status == 0 ? EIO : errorFromStatus(status));
+            }
+            inFlight--;
+            pump();
+        });
+    };
+    // 条目完成：失败时依赖它的条目随之失败（目标仍被占用或原文件未就位），成功时释放依赖它的条目
+    complete = [&](int i, int error)
+    {
+        RenamePlan::Entry& entry = (*entries)[i];
+        entry.status = error == 0 ? RenamePlan::Status::Renamed : RenamePlan::Status::Failed;
+        entry.error = error;
+        if(error == 0 && closer[i] >= 0)
+        {
+            // 移入临时名称后须等环闭合；环中后面的条目已经失败时立即移回
+            if((*entries)[closer[i]].status == RenamePlan::Status::Pending)
+            {
+                held[i] = true;
+            }
+            else
+            {
+                restore(i, (*entries)[closer[i]].error);
+            }
+        }
+        else
+        {
+            finished(i);
+        }
+        if(opener[i] >= 0 && held[opener[i]])
+        {
+            // 环闭合：成功时一并报告移入临时名称的条目，失败时把它移回原名称
+            if(error == 0)
+            {
+                held[opener[i]] = false;
+                finished(opener[i]);
+            }
+            else
+            {
+                restore(opener[i], error);
+            }
+        }
+        for(int dependent : std::as_const(dependents[i]))
+        {
+            if((*entries)[dependent].status != RenamePlan::Status::Pending)
+            {
+                continue;
+            }
+            if(error != 0)
+            {
+                complete(dependent, (*entries)[dependent].newName == entry.oldName ? EEXIST : ENOENT);
+            }
+            else
+                if(--remaining[dependent] == 0)
+                {
+                    ready.push_back(dependent);
+                }
+        }
+    };
+    auto finish = [&](int i, int error)
+    {
+        inFlight--;
+        complete(i, error);
+        pump();
+    };
+    // 查询新名称是否存在，确认可能已经生效的重命名
+    auto verify = [&](int i)
+    {
+        requests++;
+        QNetworkReply* reply = manager.get(request(endpoint("file", base + "/" + (*entries)[i].newName)));
+        QObject::connect(reply, &QNetworkReply::finished, &loop, [&, i, reply]()
+        {
+            reply->deleteLater();
+            finish(i, httpStatus(reply) == 200 ? 0 : ENOENT);
+        });
+    };
+    // recovering为true时取消后仍照常重试（用于闭合环）
+    auto post = [&](int i, bool recovering)
+    {
+        const RenamePlan::Entry& entry = (*entries)[i];
+        send(entry.oldName, entry.newName, 0, false, recovering, [&, i](QNetworkReply* reply, bool unanswered)
+        {
+            int status = reply ? httpStatus(reply) : 0;
+            if(status == 200)
+            {
+                // 目标已存在时服务器可能自动改名，文件已经移走，按实际名称记录
+                QString actual = QJsonDocument::fromJson(reply->readAll()).object().value("obj_name").toString();
+                if(!actual.isEmpty() && actual != (*entries)[i].newName)
+                {
+                    qWarning() << "Server renamed" << (*entries)[i].oldName << "to" << actual << "instead of" << (*entries)[i].newName;
+                    (*entries)[i].newName = actual;
+                }
+                finish(i, 0);
+                return;
+            }
+            if((status == 404 || !reply) && unanswered)
+            {
+                verify(i);
+                return;
+            }
+            if(status == 0 && reply)
+            {
+                qWarning() << "Request failed:" << reply->errorString();
+            }
+            finish(i, status == 0 ? (cancel.loadRelaxed() ? ECANCELED : EIO) : errorFromStatus(status));
+        });
+    };
+    // 在并发上限内发出就绪的条目，全部完成（或取消后在途的请求都已返回）时退出
+    const int concurrency = qBound(1, options.concurrency, maxConcurrency);
+    pump = [&]()
+    {
+        while(!cancel.loadRelaxed() && inFlight < concurrency && !ready.empty())
+        {
+            int i = ready.front();
+            ready.pop_front();
+            if((*entries)[i].status != RenamePlan::Status::Pending)
+            {
+                continue;
+            }
+            inFlight++;
+            post(i, false);
+        }
+        if(inFlight == 0)
+        {
+            loop.quit();
+        }
+    };
+    pump();
+    if(inFlight > 0)
+    {
+        loop.exec();
+    }
+    // 取消时环还没有闭合的文件留在临时名称下，远程存储没有日志可续做，在这里处理：
+    // 环中其余步骤都已完成时发出最后一步使环闭合，否则移回原名称
+    for(int i = 0; i < count; i++)
+    {
+        if(!held[i])
+        {
+            continue;
+        }
+        int last = closer[i];
+        if((*entries)[last].status == RenamePlan::Status::Pending && remaining[last] == 0)
+        {
+            inFlight++;
+            post(last, true);
+        }
+        else
+        {
+            restore(i, ECANCELED);
+        }
+    }
+    if(inFlight > 0)
+    {
+        loop.exec();
+    }
+    return requests;
+}
+
+int SeafileStorage::errorFromStatus(int status)
+{
+    switch(status)
+    {
+        case 400:
+            return EINVAL;
+        case 401:
+        case 403:
+            return EACCES;
+        case 404:
+            return ENOENT;
+        case 409:
+            return EEXIST;
+        default:
+            return EIO;
+    }
+}
+
+QUrl SeafileStorage::endpoint(const QString& kind, const QString& path) const
+{
+    QUrl url = options.server;
+    QString prefix = url.path();
+    while(prefix.endsWith('/'))
+    {
+        prefix.chop(1);
+    }
+    url.setPath(prefix + "/api/v2.1/repos/" + options.repo + "/" + kind + "/");
+    // 路径中的&、+、#等须编码，只保留/
+    url.setQuery("p=" + QString::fromLatin1(QUrl::toPercentEncoding(path, "/")), QUrl::StrictMode);
+    return url;
+}
+
+QNetworkRequest SeafileStorage::request(const QUrl& url) const
+{
+    QNetworkRequest result(url);
+    result.setRawHeader("Authorization", "Token " + options.token.toUtf8());
+    result.setRawHeader("Accept", "application/json");
+    result.setTransferTimeout(options.timeout);
+    return result;
+}
+
+bool SeafileStorage::retryable(QNetworkReply* reply)
+{
+    int status = httpStatus(reply);
+    return status == 0 || status == 429 || status >= 500;
+}
+
+int SeafileStorage::backoff(QNetworkReply* reply, int attempt) const
+{
+    bool ok = false;
+    int seconds = reply->rawHeader("Retry-After").toInt(&ok);
+    if(ok && seconds >= 0)
+    {
+        return qMin(seconds * 1000, options.maxBackoff);
+    }
+    // 指数退避，随机取后一半，避免同时失败的请求一齐重试
+    qint64 delay = qMin(qint64(options.initialBackoff) << qMin(attempt, 20), qint64(options.maxBackoff));
+    return int(delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1));
+}
+
+qint64 SeafileStorage::get(QNetworkAccessManager& manager, const QUrl& url, int* status, QByteArray* body, QString* message) const
+{
+    qint64 requests = 0;
+    for(int attempt = 0; ; attempt++)
+    {
+        requests++;
+        QNetworkReply* reply = manager.get(request(url));
+        waitFor(reply);
+        *status = httpStatus(reply);
+        *body = reply->readAll();
+        *message = reply->errorString();
+        bool retry = retryable(reply) && attempt < options.maxRetries;
+        int delay = retry ? backoff(reply, attempt) : 0;
+        reply->deleteLater();
+        if(!retry)
+        {
+            return requests;
+        }
+        sleepFor(delay);
+    }
+}
+
+QString SeafileStorage::normalize(const QString& path)
+{
+    QString result = QDir::cleanPath("/" + path);
+    return result == "/" ? QString() : result;
+}
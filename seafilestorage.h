@@ -0,0 +1,114 @@
+#ifndef SEAFILESTORAGE_H
+#define SEAFILESTORAGE_H
+
+/******************************************************************************
+ * @file       seafilestorage.h
+ * @brief      通过Seafile Web API列目录和重命名
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QByteArray>
+#include <QUrl>
+#include "storagebackend.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QNetworkRequest;
+
+/**
+ * @brief Seafile资料库
+ *
+ * 列目录使用GET /api/v2.1/repos/{资料库}/dir/?p=目录，一次取回整个目录；
+ * 重命名使用POST /api/v2.1/repos/{资料库}/file/?p=原路径（operation=rename&newname=新名称）。
+ * Seafile没有批量重命名的接口，一个批次内的请求在同一个连接池中并发发出（最多concurrency个，
+ * 不超过QNetworkAccessManager对同一主机的6个连接），只有按执行顺序存在依赖的条目（链和经过临时名称的环）
+ * 才等待前一个完成。环中某一步失败或被取消时，已移入临时名称的文件移回原名称（远程存储没有日志可续做）。
+ * 服务器为避开同名文件自动改名时，条目的新名称改为实际的名称。
+ * 网络错误、429和5xx按指数退避重试（服务器给出Retry-After时按其等待）；
+ * 没有收到响应的重命名在重试时可能已经生效，此时若返回404，再查询新名称确认。
+ * 每次调用使用自己的QNetworkAccessManager，可以在多个线程中同时调用。
+ */
+class SeafileStorage : public StorageBackend
+{
+public:
+    /**
+     * @brief 连接选项
+     */
+    struct Options
+    {
+        QUrl server;                // 服务器地址，如https://cloud.example.com
+        QString repo;               // 资料库ID
+        QString token;              // API令牌
+        int concurrency = 6;        // 同时进行的请求数，最多6
+        int maxRetries = 5;         // 每个请求的最大重试次数
+        int initialBackoff = 200;   // 第一次重试前的等待（毫秒），之后每次加倍
+        int maxBackoff = 10000;     // 最长等待（毫秒）
+        int timeout = 30000;        // 单个请求的超时（毫秒）
+    };
+
+    /**
+     * @brief 构造函数
+     * @param options           连接选项
+     */
+    explicit SeafileStorage(const Options& options);
+
+    bool list(const QString& directory, QVector<StorageEntry>* entries, QString* error) override;
+    qint64 renameAll(const QString& directory, QVector<RenamePlan::Entry>* entries, bool caseInsensitive,
+                     const QAtomicInt& cancel, const std::function<void(int)>& finished, QStringList* stranded) override;
+
+    /**
+     * @brief HTTP状态码对应的errno
+     * @param status            HTTP状态码
+     * @return errno
+     */
+    static int errorFromStatus(int status);
+
+private:
+    /**
+     * @brief 接口地址
+     * @param kind              dir或file
+     * @param path              资料库中的路径
+     */
+    QUrl endpoint(const QString& kind, const QString& path) const;
+
+    /**
+     * @brief 带认证信息的请求
+     */
+    QNetworkRequest request(const QUrl& url) const;
+
+    /**
+     * @brief 是否应当重试
+     * @param reply             已完成的响应
+     */
+    static bool retryable(QNetworkReply* reply);
+
+    /**
+     * @brief 下一次重试前的等待时间（毫秒）
+     * @param reply             已完成的响应
+     * @param attempt           已重试的次数
+     */
+    int backoff(QNetworkReply* reply, int attempt) const;
+
+    /**
+     * @brief 同步发送GET请求，需要时重试
+     * @param manager           网络访问管理器
+     * @param url               地址
+     * @param status            返回HTTP状态码，没有收到响应时为0
+     * @param body              返回响应内容
+     * @param message           没有收到响应时返回错误信息
+     * @return 发出的请求数
+     */
+    qint64 get(QNetworkAccessManager& manager, const QUrl& url, int* status, QByteArray* body, QString* message) const;
+
+    /**
+     * @brief 规范化的资料库路径（以/开头，不以/结尾，根目录为空字符串）
+     */
+    static QString normalize(const QString& path);
+
+    Options options;
+};
+
+#endif // SEAFILESTORAGE_H
@@ -0,0 +1,72 @@
+#ifndef STORAGEBACKEND_H
+#define STORAGEBACKEND_H
+
+/******************************************************************************
+ * @file       storagebackend.h
+ * @brief      远程存储的接口：列目录和按计划重命名
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QAtomicInt>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include "renameplan.h"
+
+/**
+ * @brief 目录项
+ */
+struct StorageEntry
+{
+    QString name;
+    bool isDirectory = false;
+    qint64 size = -1;           // 字节数，未知时为-1
+    qint64 modified = -1;       // 修改时间（秒），未知时为-1
+};
+
+/**
+ * @brief 远程存储
+ *
+ * 设置给BatchRenamer后，目录枚举和重命名不再经过本地文件系统（如同步客户端的挂载目录），
+ * 而是直接调用存储服务，避免每次重命名都成为一次单独的同步事件。
+ * 实现须允许多个线程同时调用（递归重命名时每个线程各处理一个文件夹）。
+ */
+class StorageBackend
+{
+public:
+    virtual ~StorageBackend() = default;
+
+    /**
+     * @brief 列出目录
+     * @param directory         存储中的目录路径
+     * @param entries           返回目录项
+     * @param error             失败时的错误信息
+     * @return 成功时返回true
+     */
+    virtual bool list(const QString& directory, QVector<StorageEntry>* entries, QString* error) = 0;
+
+    /**
+     * @brief 按计划重命名
+     *
+     * 只执行状态为Pending的条目，完成后把状态改为Renamed或Failed（并设置error为errno）。
+     * 条目之间可以并发执行，但须满足RenameScheduler::dependencies()给出的先后关系；取消后不再发出新的请求，
+     * 未发出的条目保持Pending。取消时环中其余步骤都已完成的，仍须发出最后一步使环闭合；
+     * 环中后面的步骤失败或被取消时，已移入临时名称的文件在原名称仍空闲时移回原名称并按失败报告，
+     * 原名称已被占用或移回失败时按失败报告，并把文件所在的临时名称记入stranded。
+     * @param directory         存储中的目录路径
+     * @param entries           按执行顺序排列的条目
+     * @param caseInsensitive   名称是否按大小写折叠后比较，传给RenameScheduler::dependencies()
+     * @param cancel            非0时取消
+     * @param finished          每个条目完成后在调用线程中回调，参数为条目下标
+     * @param stranded          返回留在临时名称下的文件（临时名称）
+     * @return 发出的请求数（含重试）
+     */
+    virtual qint64 renameAll(const QString& directory, QVector<RenamePlan::Entry>* entries, bool caseInsensitive,
+                             const QAtomicInt& cancel, const std::function<void(int)>& finished, QStringList* stranded) = 0;
+};
+
+#endif // STORAGEBACKEND_H
@@ -0,0 +1,283 @@
+#include "treerenamer.h"
+
+#include <QDir>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <deque>
+#include <memory>
+
+namespace
+{
+    // 空闲线程等待新任务的最长时间（毫秒），防止错过唤醒
+    const unsigned long idleWait = 5;
+
+    /**
+     * @brief 一个线程的任务队列：本线程从尾部存取，其他线程从头部窃取
+     */
+    struct WorkQueue
+    {
+        QMutex mutex;
+        std::deque<QString> directories;
+    };
+
+    BatchRenamer::Progress& operator+=(BatchRenamer::Progress& total, const BatchRenamer::Progress& part)
+    {
+        total.scanned += part.scanned;
+        total.matched += part.matched;
+        total.renamed += part.renamed;
+        total.failed += part.failed;
+        return total;
+    }
+} // namespace
+
+TreeRenamer::TreeRenamer() {}
+
+void TreeRenamer::setMaxThreads(int threads)
+{
+    maxThreads = threads;
+}
+
+void TreeRenamer::setDryRun(bool enabled)
+{
+    dryRun = enabled;
+}
+
+void TreeRenamer::setProgressCallback(std::function<void(const BatchRenamer::Progress&)> callback)
+{
+    progressCallback = std::move(callback);
+}
+
+void TreeRenamer::setResultCallback(std::function<void(const DirectoryResult&)> callback)
+{
+    resultCallback = std::move(callback);
+}
+
+BatchRenamer& TreeRenamer::renamer()
+{
+    return settings;
+}
+
+void TreeRenamer::resetCancel()
+{
+    cancelRequested.storeRelaxed(0);
+}
+
+void TreeRenamer::cancel()
+{
+    cancelRequested.storeRelaxed(1);
+    QMutexLocker locker(&activeMutex);
+    for(BatchRenamer* renamer : std::as_const(active))
+    {
+        renamer->cancel();
+    }
+}
+
+TreeRenamer::Summary TreeRenamer::run(const QString& format, const QVector<QString> &replacements, const QString& root,
+                                      const QString& extensionFilter, bool caseInsensitive)
+{
+    Summary summary;
+    const int threads = maxThreads > 0 ? maxThreads : qMax(1, QThread::idealThreadCount());
+    std::unique_ptr<WorkQueue[]> queues(new WorkQueue[threads]);
+    // 远程存储的路径按资料库中的路径原样使用
+    queues[0].directories.push_back(settings.storageBackend() ? root : QDir(root).absolutePath());
+    // 已入队但尚未处理完的文件夹数，为0时所有线程退出
+    QAtomicInt pending(1);
+    QMutex idleMutex;
+    QWaitCondition idle;
+    // 汇总和回调串行化
+    QMutex reportMutex;
+    QVector<BatchRenamer::Progress> inFlight(threads);  // 各线程正在处理的文件夹的进度
+
+    auto reportLocked = [&]()
+    {
+        if(!progressCallback)
+        {
+            return;
+        }
+        BatchRenamer::Progress total = summary.progress;
+        for(const BatchRenamer::Progress& part : std::as_const(inFlight))
+        {
+            total += part;
+        }
+        progressCallback(total);
+    };
+
+    // 先取本线程最近压入的文件夹，没有时从其他线程窃取最早压入的
+    auto take = [&](int self, QString* directory)
+    {
+        {
+            WorkQueue& own = queues[self];
+            QMutexLocker locker(&own.mutex);
+            if(!own.directories.empty())
+            {
+                *directory = std::move(own.directories.back());
+                own.directories.pop_back();
+                return true;
+            }
+        }
+        for(int k = 1; k < threads; k++)
+        {
+            WorkQueue& victim = queues[(self + k) % threads];
+            QMutexLocker locker(&victim.mutex);
+            if(!victim.directories.empty())
+            {
+                *directory = std::move(victim.directories.front());
+                victim.directories.pop_front();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto work = [&](int self)
+    {
+        BatchRenamer renamer;
+        renamer.copySettings(settings);
+        renamer.stats().setThread(self + 1);
+        // 文件夹之间已经并行，文件夹内不再另开线程分类
+        if(threads > 1)
+        {
+            renamer.setMatchThreads(1);
+        }
+        // 计划阶段的扫描数在执行阶段保留，执行阶段只更新重命名和失败数
+        BatchRenamer::Progress planned;
+        bool applying = false;
+        renamer.setProgressCallback([&](const BatchRenamer::Progress& p)
+        {
+            QMutexLocker locker(&reportMutex);
+            inFlight[self] = applying ? BatchRenamer::Progress{planned.scanned, planned.matched, p.renamed, p.failed} : p;
+            reportLocked();
+        });
+        {
+            QMutexLocker locker(&activeMutex);
+            active.append(&renamer);
+        }
+        while(!cancelRequested.loadRelaxed())
+        {
+            DirectoryResult result;
+            if(!take(self, &result.directory))
+            {
+                QMutexLocker locker(&idleMutex);
+                if(pending.loadAcquire() == 0)
+                {
+                    break;
+                }
+                idle.wait(&idleMutex, idleWait);
+                continue;
+            }
+            // 子文件夹在同一次枚举中得到，先入队再执行本文件夹的重命名，空闲线程可以立即窃取
+            QStringList subdirectories;
+            applying = false;
+            renamer.stats().reset();
+            result.plan = renamer.plan(format, replacements, result.directory, extensionFilter, caseInsensitive, &subdirectories);
+            if(!subdirectories.isEmpty())
+            {
+                pending.fetchAndAddRelaxed(subdirectories.size());
+                {
+                    WorkQueue& own = queues[self];
+                    QMutexLocker locker(&own.mutex);
+                    const QString base = result.directory + "/";
+                    for(const QString& name : std::as_const(subdirectories))
+                    {
+                        own.directories.push_back(base + name);
+                    }
+                }
+                idle.wakeAll();
+            }
+            if(cancelRequested.loadRelaxed())
+            {
+                break;
+            }
+            int pendingEntries = result.plan.count(RenamePlan::Status::Pending);
+            result.feedback = result.plan.error;
+            if(result.plan.error.isEmpty())
+            {
+                if(dryRun)
+                {
+                    result.feedback = "Planned " + QString::number(pendingEntries) + " rename(s).";
+                }
+                else
+                {
+                    {
+                        QMutexLocker locker(&reportMutex);
+                        planned = inFlight[self];
+                        applying = true;
+                    }
+                    result.feedback = renamer.apply(result.plan);
+                }
+            }
+            // 按计划的最终状态汇总，与各文件夹单独运行的结果一致
+            QMutexLocker locker(&reportMutex);
+            BatchRenamer::Progress done = applying ? planned : inFlight[self];
+            done.renamed = result.plan.count(RenamePlan::Status::Renamed);
+            done.failed = result.plan.count(RenamePlan::Status::Conflict) + result.plan.count(RenamePlan::Status::Failed);
+            inFlight[self] = BatchRenamer::Progress();
+            summary.progress += done;
+            summary.stats.merge(renamer.stats());
+            summary.directories++;
+            summary.planned += pendingEntries;
+            bool failed = !result.plan.error.isEmpty() || result.plan.count(RenamePlan::Status::Failed) > 0;
+            if(failed)
+            {
+                summary.failedDirectories++;
+                if(summary.firstError.isEmpty())
+                {
+                    summary.firstError = result.directory + ": " + result.feedback;
+                }
+            }
+            if(!result.plan.entries.isEmpty())
+            {
+                summary.changed++;
+            }
+            if((failed || !result.plan.entries.isEmpty()) && resultCallback)
+            {
+                resultCallback(result);
+            }
+            reportLocked();
+            locker.unlock();
+            // 最后一个文件夹处理完时唤醒等待中的线程退出
+            if(pending.fetchAndSubAcquire(1) == 1)
+            {
+                idle.wakeAll();
+            }
+        }
+        QMutexLocker locker(&activeMutex);
+        active.removeOne(&renamer);
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for(int i = 0; i < threads; i++)
+    {
+        pool.start([&work, i]()
+        {
+            work(i);
+        });
+    }
+    pool.waitForDone();
+    summary.cancelled = cancelRequested.loadRelaxed() != 0;
+    return summary;
+}
+
+QString TreeRenamer::describe(const Summary& summary) const
+{
+    if(summary.cancelled)
+    {
+        return "Cancelled after renaming " + QString::number(summary.progress.renamed) + " file(s).";
+    }
+    // 只有根目录本身出错（如不存在）时直接给出错误
+    if(summary.directories == 1 && summary.failedDirectories == 1 && summary.changed == 0)
+    {
+        return summary.firstError;
+    }
+    QString result = dryRun ? "Planned " + QString::number(summary.planned) + " rename(s)"
+                            : "Successfully renamed " + QString::number(summary.progress.renamed) + " file(s)";
+    result += " in " + QString::number(summary.changed) + " of " + QString::number(summary.directories) + " folder(s)";
+    if(summary.failedDirectories > 0)
+    {
+        result += ", " + QString::number(summary.failedDirectories) + " folder(s) with errors (first: " + summary.firstError + ")";
+    }
+    return result + ".";
+}
@@ -0,0 +1,129 @@
+#ifndef TREERENAMER_H
+#define TREERENAMER_H
+
+/******************************************************************************
+ * @file       treerenamer.h
+ * @brief      递归重命名目录树，每个文件夹作为独立任务并行处理
+ *
+ * @author     czm<chengzm23@mails.tsinghua.edu.cn>
+ * @date       2026/10/17
+ * @history    1.0
+ *****************************************************************************/
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include "batchrenamer.h"
+
+/**
+ * @brief 目录树重命名
+ *
+ * 每个文件夹是一个独立任务，编号在文件夹内连续，各自记录日志，可在对应文件夹中单独撤销、续做。
+ * 任务在工作窃取的线程池中执行：每个线程有自己的任务队列，处理文件夹时顺带枚举出的子文件夹压入本线程队列
+ * 并优先处理（深度优先，目录项仍在缓存中），空闲线程从其他线程队列的另一端取走最早压入的文件夹
+ * （通常位于树的上层，子树较大）。这样很宽的目录树能用满所有核心，网络挂载下各线程的等待也相互重叠。
+ * 每个线程使用各自的BatchRenamer，选项从renamer()复制。
+ */
+class TreeRenamer
+{
+public:
+    /**
+     * @brief 一个文件夹的结果
+     */
+    struct DirectoryResult
+    {
+        QString directory;          // 文件夹路径
+        RenamePlan plan;            // 计划（含执行结果）
+        QString feedback;           // 操作结果信息
+    };
+
+    /**
+     * @brief 整个目录树的汇总
+     */
+    struct Summary
+    {
+        int directories = 0;        // 处理的文件夹数
+        int changed = 0;            // 有文件要处理的文件夹数
+        int failedDirectories = 0;  // 出错或有文件重命名失败的文件夹数
+        int planned = 0;            // 计划重命名的文件数
+        BatchRenamer::Progress progress;    // 各文件夹进度之和
+        QString firstError;         // 第一个出错的文件夹的错误信息
+        RunStats stats;             // 各文件夹的统计之和，跟踪中的线程编号为工作线程序号（从1开始）
+        bool cancelled = false;     // 是否被取消
+    };
+
+    TreeRenamer();
+
+    /**
+     * @brief 设置最大并行文件夹数
+     * @param threads           线程数，小于1时使用QThread::idealThreadCount()
+     */
+    void setMaxThreads(int threads);
+
+    /**
+     * @brief 设置是否只生成计划，不修改文件
+     * @param enabled           是否开启
+     */
+    void setDryRun(bool enabled);
+
+    /**
+     * @brief 设置进度回调，回调在工作线程中调用（已串行化），进度为各文件夹之和
+     * @param callback          回调函数
+     */
+    void setProgressCallback(std::function<void(const BatchRenamer::Progress&)> callback);
+
+    /**
+     * @brief 设置文件夹结果回调，每处理完一个有文件要处理或出错的文件夹调用一次（已串行化）
+     * @param callback          回调函数
+     */
+    void setResultCallback(std::function<void(const DirectoryResult&)> callback);
+
+    /**
+     * @brief 各线程重命名对象的选项来源，可在开始前设置
+     */
+    BatchRenamer& renamer();
+
+    /**
+     * @brief 请求取消，可从其他线程调用；正在处理的文件夹在当前文件之后停止，其余文件夹不再处理
+     */
+    void cancel();
+
+    /**
+     * @brief 清除取消请求，在排队新任务时调用
+     */
+    void resetCancel();
+
+    /**
+     * @brief 递归重命名
+     * @param format            命名格式
+     * @param replacements      占位符
+     * @param root              根目录
+     * @param extensionFilter   扩展名过滤器（正则表达式）
+     * @param caseInsensitive   按不区分大小写的方式检测冲突
+     * @return 汇总
+     */
+    Summary run(const QString& format, const QVector<QString> &replacements, const QString& root,
+                const QString& extensionFilter = ".*", bool caseInsensitive = false);
+
+    /**
+     * @brief 把汇总转换为操作结果信息
+     * @param summary           汇总
+     * @return 操作结果信息
+     */
+    QString describe(const Summary& summary) const;
+
+private:
+    BatchRenamer settings;
+    int maxThreads = 0;
+    bool dryRun = false;
+    std::function<void(const BatchRenamer::Progress&)> progressCallback;
+    std::function<void(const DirectoryResult&)> resultCallback;
+
+    QAtomicInt cancelRequested;
+    QMutex activeMutex;
+    QVector<BatchRenamer*> active;      // 各线程正在使用的重命名对象，取消时逐个通知
+};
+
+#endif // TREERENAMER_H
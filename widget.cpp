@@ -1,14 +1,8 @@
 #include "widget.h"
+#include <QHeaderView>
 #include "formatpreset.h"
 #include "ui_widget.h"
 
-QVector<FormatPreset> preset =
-{
-    FormatPreset("custom", "", ""),
-    FormatPreset("activity", "\\1_\\2_\\d3", "Date: %MMdd, Name: 姓名", TYPE_PIC | TYPE_VID, ""),
-    FormatPreset("artwork", "*\\1_\\2", "Date: %yyMMdd, Catagory: 组名", TYPE_PIC, "")
-};
-
 Widget::Widget(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::Widget)
@@ -19,6 +13,22 @@ Widget::Widget(QWidget *parent)
     {
         ui->presetBox->addItem(ps.getName());
     }
+    // 预览表格：行高固定，视图不必逐行计算尺寸
+    previewModel = new RenamePreviewModel(this);
+    ui->previewTable->setModel(previewModel);
+    ui->previewTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->previewTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    ui->previewTable->horizontalHeader()->setStretchLastSection(true);
+    // 启动重命名线程
+    qRegisterMetaType<RenamePlan>("RenamePlan");
+    worker = new RenameWorker;
+    worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &RenameWorker::progress, this, &Widget::renameProgress);
+    connect(worker, &RenameWorker::finished, this, &Widget::renameFinished);
+    connect(worker, &RenameWorker::watchChanged, this, &Widget::watchChanged);
+    connect(worker, &RenameWorker::planReady, this, &Widget::planReady);
+    workerThread.start();
     // 初始化反馈栏
     ui->time->setText(QTime::currentTime().toString("hh:mm:ss"));
     ui->feedback->setText("Successfully initialized.");
@@ -26,52 +36,236 @@ Widget::Widget(QWidget *parent)
 
 Widget::~Widget()
 {
+    worker->cancel();
+    workerThread.quit();
+    workerThread.wait();
     delete ui;
 }
 
-void Widget::on_rename_clicked()
+void Widget::readInput(QString* format, QVector<QString>* replacements, QString* directory, QString* extensionFilter)
 {
+    // 提取格式和路径
+    *format = ui->formatEdit->text();
+    *directory = ui->pathEdit->text();
     // 提取占位符
-    QString content = ui->contentEdit->text();
-    QVector<QString> replacements = content.split(',');
-    for(int i = 0; i < replacements.length(); i++)
+    *replacements = FormatPreset::parseContent(ui->contentEdit->text(), *format);
+    // 提取扩展名过滤器
+    int type = (ui->pic->isChecked() ? TYPE_PIC : 0)
+               | (ui->vid->isChecked() ? TYPE_VID : 0)
+               | (ui->doc->isChecked() ? TYPE_DOC : 0);
+    *extensionFilter = FormatPreset::buildExtensionFilter(type, ui->typeEdit->text());
+    qDebug() << *extensionFilter;
+}
+
+void Widget::on_rename_clicked()
+{
+    QString format, directory, extensionFilter;
+    QVector<QString> replacements;
+    readInput(&format, &replacements, &directory, &extensionFilter);
+    bool sniff = ui->sniff->isChecked();
+    bool useIndex = ui->useIndex->isChecked();
+    bool recursive = ui->recursive->isChecked();
+    // 下拉框各项与FileOrder::Key的顺序一致
+    FileOrder::Key order = FileOrder::Key(ui->orderBox->currentIndex());
+    BatchRenamer::DuplicateMode duplicateMode = ui->skipDuplicates->isChecked() ? BatchRenamer::DuplicateMode::Skip
+                                                                                : BatchRenamer::DuplicateMode::Off;
+    // 交给重命名线程执行，界面保持响应
+    setBusy(true);
+    ui->feedback->setText("Renaming...");
+    RenameWorker *target = worker;
+    // 在排队时而不是开始执行时清除取消标志，任务开始前点击的取消不会丢失
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [=]()
+    {
+        target->setContentSniffing(sniff);
+        target->setNumberingIndex(useIndex);
+        target->setNumberingOrder(order);
+        target->setDuplicateMode(duplicateMode);
+        if(recursive)
+        {
+            target->runRecursive(format, replacements, directory, extensionFilter);
+        }
+        else
+        {
+            target->run(format, replacements, directory, extensionFilter);
+        }
+    });
+}
+
+void Widget::on_watch_toggled(bool checked)
+{
+    RenameWorker *target = worker;
+    if(!checked)
     {
-        QStringList parts = replacements[i].split(':');
-        if(parts.length() > 1)
-        { replacements[i] = parts.last(); }
-        replacements[i] = replacements[i].trimmed();
+        QMetaObject::invokeMethod(worker, [=]()
+        {
+            target->stopWatch();
+        });
+        return;
     }
-    // 提取格式和路径
-    QString format = ui->formatEdit->text();
-    QString directory = ui->pathEdit->text();
-    // 提取扩展名过滤器
-    QString extensionFilter;
-    extensionFilter += ui->typeEdit->text();
-    if(ui->pic->isChecked())
+    QString format, directory, extensionFilter;
+    QVector<QString> replacements;
+    readInput(&format, &replacements, &directory, &extensionFilter);
+    bool sniff = ui->sniff->isChecked();
+    FileOrder::Key order = FileOrder::Key(ui->orderBox->currentIndex());
+    BatchRenamer::DuplicateMode duplicateMode = ui->skipDuplicates->isChecked() ? BatchRenamer::DuplicateMode::Skip
+                                                                                : BatchRenamer::DuplicateMode::Off;
+    // 监视期间其他操作不可用，再次点击Watch停止
+    setBusy(true);
+    ui->cancel->setEnabled(false);
+    ui->feedback->setText("Renaming existing files...");
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [=]()
     {
-        if(!extensionFilter.isEmpty())
-        { extensionFilter += "|"; }
-        extensionFilter += Extension::Pic;
+        target->setContentSniffing(sniff);
+        target->setNumberingOrder(order);
+        target->setDuplicateMode(duplicateMode);
+        target->runWatch(format, replacements, directory, extensionFilter);
+    });
+}
+
+void Widget::watchChanged(bool active, const QString& feedback)
+{
+    if(!active)
+    {
+        // 监视失败或意外停止时同步按钮状态，不再触发toggled
+        QSignalBlocker blocker(ui->watch);
+        ui->watch->setChecked(false);
+        setBusy(false);
+        ui->feedback->setText(feedback);
+        return;
     }
-    if(ui->vid->isChecked())
+    ui->time->setText(QTime::currentTime().toString("hh:mm:ss"));
+    ui->feedback->setText("Watching. " + feedback);
+}
+
+void Widget::on_cancel_clicked()
+{
+    // 直接设置取消标志，工作线程正忙时排队的调用不会被及时处理
+    worker->cancel();
+    ui->cancel->setEnabled(false);
+}
+
+void Widget::renameProgress(int scanned, int matched, int renamed, int failed)
+{
+    ui->time->setText(QTime::currentTime().toString("hh:mm:ss"));
+    ui->feedback->setText(QString("Scanned %1, matched %2, renamed %3, failed %4...")
+                          .arg(scanned).arg(matched).arg(renamed).arg(failed));
+}
+
+void Widget::on_undo_clicked()
+{
+    QString directory = ui->pathEdit->text();
+    setBusy(true);
+    ui->feedback->setText("Undoing...");
+    RenameWorker *target = worker;
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [=]()
+    {
+        target->runUndo(directory);
+    });
+}
+
+void Widget::on_resume_clicked()
+{
+    QString directory = ui->pathEdit->text();
+    setBusy(true);
+    ui->feedback->setText("Resuming...");
+    RenameWorker *target = worker;
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [=]()
+    {
+        target->runResume(directory);
+    });
+}
+
+void Widget::on_rules_clicked()
+{
+    QString directory = ui->pathEdit->text();
+    QString rulesPath = QFileDialog::getOpenFileName(this, "Select a rule file", QString(), "Rule files (*.json)");
+    if(rulesPath.isEmpty())
     {
-        if(!extensionFilter.isEmpty())
-        { extensionFilter += "|"; }
-        extensionFilter += Extension::Vid;
+        return;
     }
-    if(ui->doc->isChecked())
+    FileOrder::Key order = FileOrder::Key(ui->orderBox->currentIndex());
+    BatchRenamer::DuplicateMode duplicateMode = ui->skipDuplicates->isChecked() ? BatchRenamer::DuplicateMode::Skip
+                                                                                : BatchRenamer::DuplicateMode::Off;
+    // 规则中给出各目录的格式，界面中的格式不参与
+    setBusy(true);
+    ui->feedback->setText("Renaming by rules...");
+    RenameWorker *target = worker;
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [=]()
+    {
+        target->setNumberingOrder(order);
+        target->setDuplicateMode(duplicateMode);
+        target->runRules(rulesPath, directory);
+    });
+}
+
+void Widget::on_preview_clicked()
+{
+    QString format, directory, extensionFilter;
+    QVector<QString> replacements;
+    readInput(&format, &replacements, &directory, &extensionFilter);
+    bool sniff = ui->sniff->isChecked();
+    FileOrder::Key order = FileOrder::Key(ui->orderBox->currentIndex());
+    BatchRenamer::DuplicateMode duplicateMode = ui->skipDuplicates->isChecked() ? BatchRenamer::DuplicateMode::Skip
+                                                                                : BatchRenamer::DuplicateMode::Off;
+    setBusy(true);
+    ui->feedback->setText("Planning...");
+    RenameWorker *target = worker;
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [=]()
     {
-        if(!extensionFilter.isEmpty())
-        { extensionFilter += "|"; }
-        extensionFilter += Extension::Doc;
+        target->setContentSniffing(sniff);
+        target->setNumberingOrder(order);
+        target->setDuplicateMode(duplicateMode);
+        target->runPreview(format, replacements, directory, extensionFilter);
+    });
+}
+
+void Widget::planReady(const RenamePlan& plan)
+{
+    previewModel->setPlan(plan);
+}
+
+void Widget::on_previewFilter_currentIndexChanged(int index)
+{
+    // 下拉框各项：全部、待重命名、跳过（冲突或重复）、冲突、已重命名、失败
+    static const QVector<QVector<RenamePlan::Status>> filters =
+    {
+        {},
+        {RenamePlan::Status::Pending},
+        {RenamePlan::Status::Conflict, RenamePlan::Status::Duplicate},
+        {RenamePlan::Status::Conflict},
+        {RenamePlan::Status::Renamed},
+        {RenamePlan::Status::Failed}
+    };
+    if(index >= 0 && index < filters.size())
+    {
+        previewModel->setStatusFilter(filters[index]);
     }
-    extensionFilter = (extensionFilter.isEmpty()) ? ".*" : extensionFilter;
-    qDebug() << extensionFilter;
-    QString feedback = renamer.renameFiles(format, replacements, directory, extensionFilter);
-    ui->time->setText(QTime::currentTime().toString("hh:mm:ss"));
+}
+
+void Widget::renameFinished(const QString& feedback)
+{
+    setBusy(false);
     ui->feedback->setText(feedback);
 }
 
+void Widget::setBusy(bool busy)
+{
+    ui->rename->setEnabled(!busy);
+    ui->undo->setEnabled(!busy);
+    ui->resume->setEnabled(!busy);
+    ui->rules->setEnabled(!busy);
+    ui->preview->setEnabled(!busy);
+    ui->watch->setEnabled(!busy || ui->watch->isChecked());
+    ui->cancel->setEnabled(busy);
+    ui->time->setText(QTime::currentTime().toString("hh:mm:ss"));
+}
+
 
 void Widget::on_browse_clicked()
 {
@@ -3,7 +3,9 @@
 
 #include <QWidget>
 #include <QFileDialog>
-#include "batchrenamer.h"
+#include <QThread>
+#include "renamepreviewmodel.h"
+#include "renameworker.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui
@@ -27,9 +29,43 @@ private slots:
 
     void on_presetBox_currentIndexChanged(int index);
 
+    void on_cancel_clicked();
+
+    void on_undo_clicked();
+
+    void on_resume_clicked();
+
+    void on_rules_clicked();
+
+    void on_preview_clicked();
+
+    void on_previewFilter_currentIndexChanged(int index);
+
+    void planReady(const RenamePlan& plan);
+
+    void renameProgress(int scanned, int matched, int renamed, int failed);
+
+    void renameFinished(const QString& feedback);
+
+    void on_watch_toggled(bool checked);
+
+    void watchChanged(bool active, const QString& feedback);
+
 private:
+    /**
+     * @brief 读取界面中的命名格式、占位符、目录和扩展名过滤器
+     */
+    void readInput(QString* format, QVector<QString>* replacements, QString* directory, QString* extensionFilter);
+
+    /**
+     * @brief 切换到执行中的界面状态
+     */
+    void setBusy(bool busy);
+
     Ui::Widget *ui;
 
-    BatchRenamer renamer;
+    QThread workerThread;       // 重命名线程
+    RenameWorker *worker;       // 在重命名线程中工作
+    RenamePreviewModel *previewModel;   // 预览表格，随滚动按需加入行
 };
 #endif // WIDGET_H